@@ -0,0 +1,123 @@
+// Replacement operator new & delete that count the program's heap allocations (see allocations.h)
+//   - Add allocations.cpp to a program's build line to count its allocations, e.g. for the bench command to check that
+//     the AI's tree search does not allocate any memory, or for -stats to show the memory that the AI allocates:
+//       g++ draughts.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp allocations.cpp -o draughts.exe -std=c++11 -pthread
+
+#include "allocations.h"
+
+#include <new>
+#include <cstdlib>   // std::malloc, std::free, std::abort
+#include <cstdio>    // std::fputs
+#include <cstddef>   // std::max_align_t
+
+
+// Turns on the counting when the program starts
+static struct CCountingOn
+{
+   CCountingOn() { CAllocations::CountingFlag().store(true, std::memory_order_relaxed); }
+} countingOn;
+
+
+// Each allocation is preceded by its size, so that the bytes that are still allocated can be counted when it is freed
+//   (the header keeps the memory aligned for any type)
+static const std::size_t HEADER_BYTES = sizeof(std::max_align_t);
+
+// Function that all of the allocating forms of operator new use
+void *
+CountedAllocation(std::size_t size)
+{
+   CAllocations::CThreadCounts &counts = CAllocations::Thread();
+   counts.allocations++;
+   if( counts.noAllocationDepth > 0 )
+   {
+      CAllocations::SearchAllocationCount().fetch_add(1, std::memory_order_relaxed);
+      if( CAllocations::FailFlag().load(std::memory_order_relaxed) )
+      {
+         // Nothing that allocates can be used here
+         std::fputs("Heap allocation during the AI's tree search\n", stderr);
+         std::abort();
+      }
+   }
+
+   char *memory = static_cast<char*>( std::malloc(HEADER_BYTES + size) );
+   if( memory == 0 )
+      return 0;
+   *reinterpret_cast<std::size_t*>(memory) = size;
+
+   CAllocations::CTotals &totals = CAllocations::Totals();
+   totals.allocations.fetch_add(1, std::memory_order_relaxed);
+   totals.bytes.fetch_add(size, std::memory_order_relaxed);
+   const long long liveBytes = totals.liveBytes.fetch_add((long long)size, std::memory_order_relaxed) + (long long)size;
+   // Raise the peak of each meter that is measuring
+   for( unsigned int inUse = totals.inUse.load(std::memory_order_relaxed) ; inUse != 0 ; inUse &= inUse-1 )
+   {
+      std::atomic<long long> &peak = totals.peakLiveBytes[__builtin_ctz(inUse)];
+      long long peakBytes = peak.load(std::memory_order_relaxed);
+      while( (liveBytes > peakBytes) && !peak.compare_exchange_weak(peakBytes, liveBytes, std::memory_order_relaxed) )
+         ;
+   }
+   return memory + HEADER_BYTES;
+}
+
+// Function that all of the forms of operator delete use
+void
+CountedFree(void *memory)
+{
+   if( memory == 0 )
+      return;
+   char *block = static_cast<char*>(memory) - HEADER_BYTES;
+   CAllocations::Totals().liveBytes.fetch_sub((long long)*reinterpret_cast<std::size_t*>(block), std::memory_order_relaxed);
+   std::free(block);
+}
+
+
+void *
+operator new(std::size_t size)
+{
+   void *memory = CountedAllocation(size);
+   if( memory == 0 )
+      throw std::bad_alloc();
+   return memory;
+}
+
+void *
+operator new[](std::size_t size)
+{
+   return operator new(size);
+}
+
+void *
+operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+   return CountedAllocation(size);
+}
+
+void *
+operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+   return CountedAllocation(size);
+}
+
+void
+operator delete(void *memory) noexcept
+{
+   CountedFree(memory);
+}
+
+void
+operator delete[](void *memory) noexcept
+{
+   CountedFree(memory);
+}
+
+void
+operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+   CountedFree(memory);
+}
+
+void
+operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+   CountedFree(memory);
+}
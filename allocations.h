@@ -0,0 +1,173 @@
+// Counting of the program's heap allocations, to check that the AI's tree search does not allocate any memory & to measure
+//   how much memory the AI allocates
+//   - The allocations are counted by the replacement operator new & delete in allocations.cpp, so only a program that is
+//     linked with allocations.cpp counts them (in any other program the counts are all 0 & Counting returns false)
+//   - The tree search marks the time that it runs on a thread with a CNoAllocationScope: an allocation that the thread
+//     makes during it is counted as a search allocation, or stops the program if FailOnSearchAllocation has been called
+//     (e.g. by a test, or the bench command)
+//   - A CAllocationMeter measures the allocations that all threads make while it exists (e.g. during a search for a move,
+//     or a whole game): their number & bytes, & the most bytes that were allocated & not yet freed at any one time
+
+#ifndef _ALLOCATIONS_H
+#define _ALLOCATIONS_H
+
+#include <atomic>
+#include <cstddef>   // std::size_t
+
+
+// Allocations made during a measurement (see CAllocationMeter)
+struct CAllocationCounts
+{
+   CAllocationCounts() : allocations(0), bytes(0), peakLiveBytes(0) {}
+
+   unsigned long long allocations;
+   unsigned long long bytes;
+   unsigned long long peakLiveBytes;   // Most bytes allocated during the measurement that were not yet freed at one time
+};
+
+
+class CAllocations
+{
+   public:
+      // Function to check whether the allocations are being counted (i.e. whether allocations.cpp is linked in)
+      static bool Counting() { return CountingFlag().load(std::memory_order_relaxed); }
+
+      // Function to get the number of allocations that the calling thread has made
+      static unsigned long long ThreadAllocations() { return Thread().allocations; }
+      // Function to get the number of allocations that have been made by any thread during a tree search
+      static unsigned long long SearchAllocations() { return SearchAllocationCount().load(std::memory_order_relaxed); }
+
+      // Function to make an allocation during a tree search stop the program (with a message saying so), so that the
+      //   allocation can be found in a debugger
+      static void FailOnSearchAllocation(const bool fail) { FailFlag().store(fail, std::memory_order_relaxed); }
+
+   private:
+      // The scopes & meters below, & the parts of allocations.cpp that do the counting
+      friend class CNoAllocationScope;
+      friend class CAllocationMeter;
+      friend struct CCountingOn;
+      friend void *CountedAllocation(std::size_t size);
+      friend void CountedFree(void *memory);
+
+      // The calling thread's counts (plain data, so they need no construction before the thread's first allocation)
+      struct CThreadCounts
+      {
+         unsigned long long allocations;
+         unsigned int noAllocationDepth;   // Number of CNoAllocationScopes that the thread is in
+      };
+      static CThreadCounts &Thread()
+      {
+         static thread_local CThreadCounts counts;
+         return counts;
+      }
+
+      // The counts of all threads' allocations (plain data for the same reason)
+      struct CTotals
+      {
+         std::atomic<unsigned long long> allocations;
+         std::atomic<unsigned long long> bytes;
+         std::atomic<long long> liveBytes;   // Allocated & not yet freed
+         // The peak of liveBytes for each of the meters that are measuring (a bit of inUse is set for each one)
+         static const unsigned int MAX_METERS = 16;
+         std::atomic<unsigned int> inUse;
+         std::atomic<long long> peakLiveBytes[MAX_METERS];
+      };
+      static CTotals &Totals()
+      {
+         static CTotals totals;
+         return totals;
+      }
+
+      static std::atomic<bool> &CountingFlag()
+      {
+         static std::atomic<bool> counting(false);
+         return counting;
+      }
+      static std::atomic<bool> &FailFlag()
+      {
+         static std::atomic<bool> fail(false);
+         return fail;
+      }
+      static std::atomic<unsigned long long> &SearchAllocationCount()
+      {
+         static std::atomic<unsigned long long> searchAllocations(0);
+         return searchAllocations;
+      }
+};
+
+
+// Part of the calling thread's work (the tree search) that must not allocate any memory, lasting until the end of the
+//   scope that it is declared in
+class CNoAllocationScope
+{
+   public:
+      CNoAllocationScope() { CAllocations::Thread().noAllocationDepth++; }
+      ~CNoAllocationScope() { CAllocations::Thread().noAllocationDepth--; }
+
+   private:
+      CNoAllocationScope(const CNoAllocationScope &);
+      CNoAllocationScope &operator=(const CNoAllocationScope &);
+};
+
+
+// Measurement of the allocations that all threads make from the meter's construction until Counts is called
+//   - Up to MAX_METERS meters can keep track of the peak at once (any more give a peak of 0)
+class CAllocationMeter
+{
+   public:
+      CAllocationMeter()
+      {
+         CAllocations::CTotals &totals = CAllocations::Totals();
+         startAllocations = totals.allocations.load(std::memory_order_relaxed);
+         startBytes = totals.bytes.load(std::memory_order_relaxed);
+         startLiveBytes = totals.liveBytes.load(std::memory_order_relaxed);
+         // Claim one of the peaks (if another meter claims or frees one first, then look again)
+         meter = CAllocations::CTotals::MAX_METERS;
+         unsigned int inUse = totals.inUse.load(std::memory_order_relaxed);
+         for( unsigned int peak = 0 ; peak < CAllocations::CTotals::MAX_METERS ; )
+         {
+            if( inUse & (1u << peak) )
+            {
+               peak++;
+               continue;
+            }
+            totals.peakLiveBytes[peak].store(startLiveBytes, std::memory_order_relaxed);
+            if( totals.inUse.compare_exchange_weak(inUse, inUse | (1u << peak)) )
+            {
+               meter = peak;
+               break;
+            }
+            peak = 0;
+         }
+      }
+      ~CAllocationMeter()
+      {
+         if( meter < CAllocations::CTotals::MAX_METERS )
+            CAllocations::Totals().inUse.fetch_and(~(1u << meter));
+      }
+
+      CAllocationCounts Counts() const
+      {
+         CAllocations::CTotals &totals = CAllocations::Totals();
+         CAllocationCounts counts;
+         counts.allocations = totals.allocations.load(std::memory_order_relaxed) - startAllocations;
+         counts.bytes = totals.bytes.load(std::memory_order_relaxed) - startBytes;
+         if( meter < CAllocations::CTotals::MAX_METERS )
+         {
+            const long long peak = totals.peakLiveBytes[meter].load(std::memory_order_relaxed);
+            counts.peakLiveBytes = ( peak > startLiveBytes ? (unsigned long long)(peak - startLiveBytes) : 0 );
+         }
+         return counts;
+      }
+
+   private:
+      CAllocationMeter(const CAllocationMeter &);
+      CAllocationMeter &operator=(const CAllocationMeter &);
+
+      unsigned long long startAllocations;
+      unsigned long long startBytes;
+      long long startLiveBytes;
+      unsigned int meter;   // Which of the peaks is this meter's (MAX_METERS = none)
+};
+
+#endif
@@ -0,0 +1,68 @@
+// Definition of the functions for looking up the built-in bitbase
+
+#include "bitbase.h"
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the bit of a position (returns false if the position is not in the bitbase)
+// --------------------------------------------------------------------------- //
+
+static bool
+BitbaseWins(const CTbPosition &position, bool &wins)
+{
+   const CTbMaterial material(position);
+   if( material.NumPieces() > BITBASE_MAX_PIECES )
+      return false;
+   // A side with no pieces has no moves
+   if( material.xMen + material.xKings == 0 )
+   {
+      wins = false;
+      return true;
+   }
+   if( material.oMen + material.oKings == 0 )
+      return false;
+
+   const unsigned long long sliceStart = bitbaseSliceStart[BitbaseMaterialKey(material)];
+   if( sliceStart == BITBASE_NO_SLICE )
+      return false;
+   const unsigned long long bit = sliceStart + CTbSlice(material).Index(position);
+   wins = ( (bitbaseBits[bit/64] >> (bit%64)) & 1 ) != 0;
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to look up a position
+// --------------------------------------------------------------------------- //
+
+bool
+BitbaseProbe(const CTbPosition &position, int &result)
+{
+   bool wins = false;
+   if( !BitbaseWins(position, wins) )
+      return false;
+   if( wins )
+   {
+      result = 1;
+      return true;
+   }
+
+   // Not a win, so it is a loss if every turn leads to a win for O (or there are no turns), otherwise a draw
+   //   - The turns are listed on the stack, as the tree search probes the bitbase & must not allocate any memory (a
+   //     position with more turns than fit is treated as not being in the bitbase)
+   CTbTurnList turns;
+   if( !TbGenerateTurns(position, turns) )
+      return false;
+   for( unsigned int turn = 0 ; turn < turns.size() ; turn++ )
+   {
+      // Every turn keeps or reduces the number of pieces, so it is in the bitbase too
+      bool opponentWins = false;
+      if( BitbaseWins(turns[turn], opponentWins) && !opponentWins )
+      {
+         result = 0;
+         return true;
+      }
+   }
+   result = -1;
+   return true;
+}
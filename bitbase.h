@@ -0,0 +1,35 @@
+// Declaration of the bitbase that can be built into the program: every position with up to 4 pieces, one bit each, set if
+// the side to move wins (so the smallest endgames are solved without any files on disk)
+//
+// The bits are in bitbase_data.cpp, which is written by the tbgen program (tbgen.exe -pieces 4 -bitbase bitbase_data.cpp)
+// & compiled in along with bitbase.cpp when the program is built with -DDRAUGHTS_BITBASE
+
+#ifndef _BITBASE_H
+#define _BITBASE_H
+
+#include "tablebase.h"
+
+
+const unsigned int BITBASE_MAX_PIECES = 4;
+// Number of different materials (each piece count 0 to BITBASE_MAX_PIECES)
+const unsigned int BITBASE_NUM_MATERIALS = (BITBASE_MAX_PIECES+1)*(BITBASE_MAX_PIECES+1)*(BITBASE_MAX_PIECES+1)*(BITBASE_MAX_PIECES+1);
+// Start of a material that is not in the bitbase
+const unsigned long long BITBASE_NO_SLICE = ~0ULL;
+
+inline unsigned int BitbaseMaterialKey(const CTbMaterial &material)
+{
+   return ( (material.xMen*(BITBASE_MAX_PIECES+1) + material.xKings)*(BITBASE_MAX_PIECES+1) + material.oMen )*(BITBASE_MAX_PIECES+1) + material.oKings;
+}
+
+// The generated data: the first bit of each material's slice (indexed by BitbaseMaterialKey), & the bits themselves
+//   (bit n is bit n%64 of word n/64), in the same order as the positions of each CTbSlice
+extern const unsigned long long bitbaseSliceStart[BITBASE_NUM_MATERIALS];
+extern const unsigned long long bitbaseBits[];
+
+// Function to look up a position (with X to move): returns false if the position is not in the bitbase, otherwise
+//   result = 1 if X wins, -1 if X loses or 0 if neither side can force a win
+//   - Losses & draws share the same bit, so they are told apart by looking up each of X's turns
+bool BitbaseProbe(const CTbPosition &position, int &result);
+
+
+#endif
@@ -0,0 +1,349 @@
+// Definition of functions for playing batches of random games with bit-sliced boards
+
+#include "bitslice.h"
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the counter-based random number for a move of a game
+//   (a splitmix64 hash of the seed, game number & move number, so no generator state has to be stored)
+// --------------------------------------------------------------------------- //
+
+unsigned int
+PlayoutRandom(const unsigned long long seed, const unsigned long long game, const unsigned int moveNumber)
+{
+   unsigned long long z = seed ^ (game * 0x9E3779B97F4A7C15ULL) ^ ((moveNumber + 1ULL) * 0xD1B54A32D192ED03ULL);
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   return static_cast<unsigned int>((z ^ (z >> 31)) >> 32);
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to play a random game on a CBoard (the reference for the bit-sliced playouts)
+// --------------------------------------------------------------------------- //
+
+int
+ScalarPlayout(CBoard board, const unsigned long long seed, const unsigned long long game, const unsigned int maxMoves)
+{
+   std::vector<CBoard::CMove> moves;
+   for( unsigned int moveNumber = 0 ; moveNumber < maxMoves ; moveNumber++ )
+   {
+      board.GetLegalMoves(moves);
+      // The side whose turn it is has no moves, so it has lost
+      if( moves.empty() )
+         return ( board.IsXTurn() ? -1 : 1 );
+      board.MakeMove( moves[ PlayoutRandom(seed, game, moveNumber) % moves.size() ] );
+   }
+   return 0;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Constructor - builds the geometry tables & the bit-sliced starting position
+// --------------------------------------------------------------------------- //
+
+template<typename W>
+CBitSlicedPlayouts<W>::CBitSlicedPlayouts(const CBoard &startBoard)
+ : width(startBoard.Width()), height(startBoard.Height())
+{
+   typedef CLaneTraits<W> Lanes;
+   CBoard board = startBoard;  // The square query functions are not const
+
+   // Pieces only move diagonally, so they stay on the colour of square that they start on: only those squares are used
+   //   (if pieces have been placed on both colours then all of the squares are used)
+   bool parityUsed[2] = { false, false };
+   for( unsigned int y = 0 ; y < height ; y++ )
+      for( unsigned int x = 0 ; x < width ; x++ )
+         if( !(board.SquareIsEmpty(x,y)) )
+            parityUsed[(x+y)%2] = true;
+
+   const int dx[NUM_DIRECTIONS] = { -1, +1, -1, +1 };
+   const int dy[NUM_DIRECTIONS] = { +1, +1, -1, -1 };
+   for( unsigned int y = 0 ; y < height ; y++ )
+   {
+      for( unsigned int x = 0 ; x < width ; x++ )
+      {
+         const unsigned int square = y*width + x;
+         if( square >= MAX_SQUARES )
+            continue;
+         if( parityUsed[0] != parityUsed[1] && !parityUsed[(x+y)%2] )
+            continue;
+         playableSquares.push_back(square);
+         for( unsigned int direction = 0 ; direction < NUM_DIRECTIONS ; direction++ )
+         {
+            const int nx = int(x) + dx[direction],   ny = int(y) + dy[direction];
+            const int jx = int(x) + 2*dx[direction], jy = int(y) + 2*dy[direction];
+            neighbour[square][direction] = ( (nx >= 0 && nx < int(width) && ny >= 0 && ny < int(height)) ? ny*int(width) + nx : -1 );
+            jump[square][direction]      = ( (jx >= 0 && jx < int(width) && jy >= 0 && jy < int(height)) ? jy*int(width) + jx : -1 );
+         }
+      }
+   }
+
+   // Every game starts from the same position, so each word is either all zeros or all ones
+   const W none = Lanes::Zero();
+   const W all = ~none;
+   for( unsigned int square = 0 ; square < MAX_SQUARES ; square++ )
+   {
+      start.xMen[square] = start.xKings[square] = start.oMen[square] = start.oKings[square] = start.jumping[square] = none;
+      const unsigned int x = square % width, y = square / width;
+      if( y >= height || board.SquareIsEmpty(x,y) )
+         continue;
+      const bool isX = board.SquareContainsXPiece(x,y);
+      const bool isMan = board.SquareContainsManPiece(x,y);
+      if( isX )
+         (isMan ? start.xMen[square] : start.xKings[square]) = all;
+      else
+         (isMan ? start.oMen[square] : start.oKings[square]) = all;
+   }
+   start.xTurn = ( board.IsXTurn() ? all : none );
+   start.inMultiJump = none;
+   if( board.InMultiTurnSequence() )
+   {
+      start.inMultiJump = all;
+      start.jumping[board.QueuedY()*width + board.QueuedX()] = all;
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to play one batch of games
+//   Each step of the loop makes one move in every game that is still in progress:
+//   1) Find the legal moves of every game, in the same order as CBoard::GetLegalMoves
+//   2) Count them (with bit-sliced counters) & pick the index of the move to make in each game from PlayoutRandom
+//   3) Walk the moves in order again, counting the index down, & make each move in the games whose count reaches zero
+// --------------------------------------------------------------------------- //
+
+template<typename W>
+void
+CBitSlicedPlayouts<W>::Run(const unsigned long long seed, const unsigned long long firstGame, const unsigned int maxMoves,
+                           std::vector<int> &results) const
+{
+   typedef CLaneTraits<W> Lanes;
+   const W none = Lanes::Zero();
+
+   CState state = start;
+   W finished = none;
+   W xWon = none;
+   W oWon = none;
+
+   W captures[MAX_SQUARES][NUM_DIRECTIONS];
+   W simpleMoves[MAX_SQUARES][NUM_DIRECTIONS];
+
+   for( unsigned int moveNumber = 0 ; moveNumber < maxMoves ; moveNumber++ )
+   {
+      const W active = ~finished;
+      const W xTurn = state.xTurn;
+      const W oTurn = ~xTurn;
+
+      // ------------------------------------------------------------------
+      // 1) Legal moves: a capture in any direction forces a capture, & a multi-jump only allows the jumping piece to capture
+      // ------------------------------------------------------------------
+      W anyCapture = none;
+      for( unsigned int index = 0 ; index < playableSquares.size() ; index++ )
+      {
+         const unsigned int square = playableSquares[index];
+         const W ownMen   = (state.xMen[square] & xTurn)   | (state.oMen[square] & oTurn);
+         const W ownKings = (state.xKings[square] & xTurn) | (state.oKings[square] & oTurn);
+         const W movers = ( (ownMen | ownKings) & ~state.inMultiJump ) | ( state.jumping[square] & state.inMultiJump );
+         // X men move +ve y, O men move -ve y, kings move both ways
+         const W forwardPlusY  = (ownKings | (ownMen & xTurn)) & movers & active;
+         const W forwardMinusY = (ownKings | (ownMen & oTurn)) & movers & active;
+
+         for( unsigned int direction = 0 ; direction < NUM_DIRECTIONS ; direction++ )
+         {
+            captures[square][direction] = simpleMoves[square][direction] = none;
+            const int next = neighbour[square][direction];
+            if( next < 0 )
+               continue;
+            const W canMove = ( direction < 2 ? forwardPlusY : forwardMinusY );
+            const W xAtNext = state.xMen[next] | state.xKings[next];
+            const W oAtNext = state.oMen[next] | state.oKings[next];
+            const W emptyNext = ~(xAtNext | oAtNext);
+
+            simpleMoves[square][direction] = canMove & emptyNext & ~state.inMultiJump;
+
+            const int landing = jump[square][direction];
+            if( landing >= 0 )
+            {
+               const W emptyLanding = ~(state.xMen[landing] | state.xKings[landing] | state.oMen[landing] | state.oKings[landing]);
+               const W opponentAtNext = (xAtNext & oTurn) | (oAtNext & xTurn);
+               captures[square][direction] = canMove & opponentAtNext & emptyLanding;
+               anyCapture |= captures[square][direction];
+            }
+         }
+      }
+
+      // ------------------------------------------------------------------
+      // 2) Count the legal moves of each game
+      // ------------------------------------------------------------------
+      W count[COUNTER_BITS];
+      for( unsigned int bit = 0 ; bit < COUNTER_BITS ; bit++ )
+         count[bit] = none;
+      for( unsigned int index = 0 ; index < playableSquares.size() ; index++ )
+      {
+         const unsigned int square = playableSquares[index];
+         for( unsigned int direction = 0 ; direction < NUM_DIRECTIONS ; direction++ )
+         {
+            simpleMoves[square][direction] &= ~anyCapture;
+            // Add one to the counters of the games in which this is a legal move (ripple-carry increment)
+            W carry = captures[square][direction] | simpleMoves[square][direction];
+            for( unsigned int bit = 0 ; (bit < COUNTER_BITS) && Lanes::Any(carry) ; bit++ )
+            {
+               const W nextCarry = count[bit] & carry;
+               count[bit] ^= carry;
+               carry = nextCarry;
+            }
+         }
+      }
+
+      // Games with no legal moves are over: the side whose turn it is has lost
+      W hasMoves = none;
+      for( unsigned int bit = 0 ; bit < COUNTER_BITS ; bit++ )
+         hasMoves |= count[bit];
+      const W lost = active & ~hasMoves;
+      xWon |= lost & oTurn;
+      oWon |= lost & xTurn;
+      finished |= lost;
+      const W playing = active & hasMoves;
+      if( !Lanes::Any(playing) )
+         break;
+
+      // Pick the index of the move to make in each game (this is the only per-game step)
+      W choice[COUNTER_BITS];
+      for( unsigned int bit = 0 ; bit < COUNTER_BITS ; bit++ )
+         choice[bit] = none;
+      for( unsigned int lane = 0 ; lane < LANES ; lane++ )
+      {
+         if( !Lanes::Get(playing, lane) )
+            continue;
+         unsigned int numMoves = 0;
+         for( unsigned int bit = 0 ; bit < COUNTER_BITS ; bit++ )
+            numMoves |= (Lanes::Get(count[bit], lane) ? 1u : 0u) << bit;
+         const unsigned int moveIndex = PlayoutRandom(seed, firstGame + lane, moveNumber) % numMoves;
+         for( unsigned int bit = 0 ; bit < COUNTER_BITS ; bit++ )
+            if( (moveIndex >> bit) & 1u )
+               Lanes::Set(choice[bit], lane);
+      }
+
+      // ------------------------------------------------------------------
+      // 3) Make the chosen moves
+      // ------------------------------------------------------------------
+      W pending = playing;
+      for( unsigned int index = 0 ; (index < playableSquares.size()) && Lanes::Any(pending) ; index++ )
+      {
+         const unsigned int square = playableSquares[index];
+         for( unsigned int direction = 0 ; direction < NUM_DIRECTIONS ; direction++ )
+         {
+            // Only one of the two can be a legal move in any one game
+            const bool isCapture = Lanes::Any(captures[square][direction]);
+            const W legal = captures[square][direction] | simpleMoves[square][direction];
+            if( !Lanes::Any(legal) )
+               continue;
+
+            W choiceIsZero = ~none;
+            for( unsigned int bit = 0 ; bit < COUNTER_BITS ; bit++ )
+               choiceIsZero &= ~choice[bit];
+            const W chosen = legal & pending & choiceIsZero;
+            if( Lanes::Any(chosen) )
+            {
+               if( isCapture )
+               {
+                  const W chosenCaptures = chosen & captures[square][direction];
+                  if( Lanes::Any(chosenCaptures) )
+                     ApplyMove(state, square, direction, true, chosenCaptures);
+               }
+               const W chosenSimple = chosen & simpleMoves[square][direction];
+               if( Lanes::Any(chosenSimple) )
+                  ApplyMove(state, square, direction, false, chosenSimple);
+               pending &= ~chosen;
+            }
+
+            // Subtract one from the choice of the games in which this was a legal move (ripple-borrow decrement)
+            W borrow = legal & pending;
+            for( unsigned int bit = 0 ; (bit < COUNTER_BITS) && Lanes::Any(borrow) ; bit++ )
+            {
+               const W nextBorrow = borrow & ~choice[bit];
+               choice[bit] ^= borrow;
+               borrow = nextBorrow;
+            }
+         }
+      }
+   }
+
+   results.resize(LANES);
+   for( unsigned int lane = 0 ; lane < LANES ; lane++ )
+      results[lane] = ( Lanes::Get(xWon, lane) ? 1 : ( Lanes::Get(oWon, lane) ? -1 : 0 ) );
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to make a move in a set of games
+// --------------------------------------------------------------------------- //
+
+template<typename W>
+void
+CBitSlicedPlayouts<W>::ApplyMove(CState &state, const unsigned int square, const unsigned int direction, const bool capture, const W games) const
+{
+   typedef CLaneTraits<W> Lanes;
+   const W none = Lanes::Zero();
+   const unsigned int target = ( capture ? jump[square][direction] : neighbour[square][direction] );
+
+   // Move the piece
+   W *planes[4] = { state.xMen, state.xKings, state.oMen, state.oKings };
+   for( unsigned int plane = 0 ; plane < 4 ; plane++ )
+   {
+      planes[plane][target] |= planes[plane][square] & games;
+      planes[plane][square] &= ~games;
+   }
+   state.jumping[square] &= ~games;
+
+   // Remove the captured piece
+   if( capture )
+   {
+      const unsigned int captured = neighbour[square][direction];
+      for( unsigned int plane = 0 ; plane < 4 ; plane++ )
+         planes[plane][captured] &= ~games;
+   }
+
+   // Crown men that have reached the far row
+   const unsigned int targetY = target / width;
+   const W crownX = ( targetY == height-1 ? state.xMen[target] & games : none );
+   const W crownO = ( targetY == 0        ? state.oMen[target] & games : none );
+   state.xMen[target] &= ~crownX;
+   state.xKings[target] |= crownX;
+   state.oMen[target] &= ~crownO;
+   state.oKings[target] |= crownO;
+
+   // A capture continues as a multi-jump if the (uncrowned) piece can capture again
+   W continues = none;
+   if( capture )
+   {
+      const W candidates = games & ~(crownX | crownO);
+      const W isX = state.xMen[target] | state.xKings[target];
+      const W isO = state.oMen[target] | state.oKings[target];
+      const W kings = state.xKings[target] | state.oKings[target];
+      for( unsigned int nextDirection = 0 ; nextDirection < NUM_DIRECTIONS ; nextDirection++ )
+      {
+         const int next = neighbour[target][nextDirection];
+         const int landing = jump[target][nextDirection];
+         if( next < 0 || landing < 0 )
+            continue;
+         const W canMove = ( nextDirection < 2 ? (kings | state.xMen[target]) : (kings | state.oMen[target]) );
+         const W opponentAtNext = (isX & (state.oMen[next] | state.oKings[next])) | (isO & (state.xMen[next] | state.xKings[next]));
+         const W emptyLanding = ~(state.xMen[landing] | state.xKings[landing] | state.oMen[landing] | state.oKings[landing]);
+         continues |= candidates & canMove & opponentAtNext & emptyLanding;
+      }
+      state.jumping[target] |= continues;
+   }
+
+   // Games that do not continue with a multi-jump pass the turn to the other side
+   state.inMultiJump = (state.inMultiJump & ~games) | continues;
+   state.xTurn ^= games & ~continues;
+}
+
+
+// The word types that the batches can be played with
+template class CBitSlicedPlayouts<unsigned long long>;
+#if defined(__GNUC__) && defined(__AVX2__)
+template class CBitSlicedPlayouts<LaneWord256>;
+#endif
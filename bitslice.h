@@ -0,0 +1,100 @@
+// Declaration of class for playing batches of random games with bit-sliced boards
+
+#ifndef _BITSLICE_H
+#define _BITSLICE_H
+
+#include <vector>
+
+#include "board.h"
+
+
+// Counter-based random number for move "moveNumber" of game "game" in the playouts seeded with "seed"
+//   (the same number is used by the bit-sliced & the scalar playouts, so that they make the same choices)
+unsigned int PlayoutRandom(const unsigned long long seed, const unsigned long long game, const unsigned int moveNumber);
+
+// Result of a playout: +1 = X won, -1 = O won, 0 = draw (the move limit was reached)
+// Plays a random game on a CBoard, choosing move (PlayoutRandom % number of legal moves) from GetLegalMoves each time
+int ScalarPlayout(CBoard board, const unsigned long long seed, const unsigned long long game, const unsigned int maxMoves);
+
+
+// Traits of the word that holds one bit per game (one game per "lane")
+template<typename W> struct CLaneTraits;
+
+template<> struct CLaneTraits<unsigned long long>
+{
+   static const unsigned int LANES = 64;
+   static unsigned long long Zero() { return 0ULL; }
+   static bool Any(const unsigned long long w) { return w != 0ULL; }
+   static bool Get(const unsigned long long w, const unsigned int lane) { return (w >> lane) & 1ULL; }
+   static void Set(unsigned long long &w, const unsigned int lane) { w |= (1ULL << lane); }
+};
+
+#if defined(__GNUC__) && defined(__AVX2__)
+// 256 games per word, using four 64-bit words that the compiler keeps in an AVX2 register
+typedef unsigned long long LaneWord256 __attribute__((vector_size(32)));
+
+template<> struct CLaneTraits<LaneWord256>
+{
+   static const unsigned int LANES = 256;
+   static LaneWord256 Zero() { LaneWord256 w = {0ULL, 0ULL, 0ULL, 0ULL}; return w; }
+   static bool Any(const LaneWord256 w) { return (w[0] | w[1] | w[2] | w[3]) != 0ULL; }
+   static bool Get(const LaneWord256 w, const unsigned int lane) { return (w[lane >> 6] >> (lane & 63)) & 1ULL; }
+   static void Set(LaneWord256 &w, const unsigned int lane) { w[lane >> 6] |= (1ULL << (lane & 63)); }
+};
+#endif
+
+
+// Class for playing a batch of independent random games in lockstep
+//   - Each square of the board is a set of words with one bit per game (bit-slicing), so every step of the rules
+//     (move generation, forced captures, multi-jumps, crowning) is done for all of the games at once with bitwise operations
+//   - Each game makes exactly the same choices as ScalarPlayout, so the results are identical to the scalar rules engine
+template<typename W>
+class CBitSlicedPlayouts
+{
+   public:
+      static const unsigned int LANES = CLaneTraits<W>::LANES;
+
+      // Constructor - every game in a batch starts from the given board (which may be part way through a multi-jump)
+      explicit CBitSlicedPlayouts(const CBoard &start);
+
+      // Function to play one batch of games: games (firstGame) to (firstGame + LANES - 1)
+      //   - results receives one entry per game: +1 = X won, -1 = O won, 0 = draw
+      void Run(const unsigned long long seed, const unsigned long long firstGame, const unsigned int maxMoves,
+               std::vector<int> &results) const;
+
+   private:
+      // Maximum number of squares (the board must fit in this)
+      static const unsigned int MAX_SQUARES = 64;
+      // Directions in the same order as CBoard::PopulateMoves: (-1,+1), (+1,+1), (-1,-1), (+1,-1)
+      static const unsigned int NUM_DIRECTIONS = 4;
+      // Number of bits in the per-game move counters (must be able to count the maximum number of moves)
+      static const unsigned int COUNTER_BITS = 6;
+
+      // Bit-sliced state of the batch
+      struct CState
+      {
+         W xMen[MAX_SQUARES];
+         W xKings[MAX_SQUARES];
+         W oMen[MAX_SQUARES];
+         W oKings[MAX_SQUARES];
+         W jumping[MAX_SQUARES];   // Square of a piece that is part way through a multi-jump
+         W xTurn;                  // Games in which it is X's turn
+         W inMultiJump;            // Games in which a multi-jump is in progress
+      };
+
+      // Board geometry: the dark squares in scan order, & the neighbouring/jump squares in each direction (-1 = off the board)
+      unsigned int width;
+      unsigned int height;
+      std::vector<int> playableSquares;
+      int neighbour[MAX_SQUARES][NUM_DIRECTIONS];
+      int jump[MAX_SQUARES][NUM_DIRECTIONS];
+
+      // Starting position
+      CState start;
+
+      // Function to make the chosen move in the games in "games" (& work out whether each of those games continues with a multi-jump)
+      void ApplyMove(CState &state, const unsigned int square, const unsigned int direction, const bool capture, const W games) const;
+};
+
+
+#endif
@@ -1,8 +1,93 @@
 // Definition of class functions for the draughts board
 
 #include "board.h"
+#include "mcts.h"
+#include "trace.h"
+#include "allocations.h"
+#include "randomrs.h"
+#include "tablebase.h"
+#include "book.h"
+#ifdef DRAUGHTS_BITBASE
+#include "bitbase.h"
+#endif
 
 #include <algorithm> // std::find
+#include <deque>
+#include <limits>    // std::numeric_limits
+#include <thread>    // std::this_thread::sleep_for
+
+// Weights used by the AI's static evaluation (shared by all boards)
+CEvalWeights CBoard::evalWeights;
+// Scores worked out by the AI's tree search (shared by all boards)
+CTranspositionTable CBoard::transpositionTable;
+// Opening book that the AI plays from (shared by all boards)
+COpeningBook CBoard::openingBook;
+// Endgame tablebase probed by the AI's tree search (shared by all boards)
+CTablebase CBoard::tablebase;
+// Statistics of the search for a move that is running (or last ran) on each thread
+static thread_local CSearchStats threadSearchStats;
+
+const CSearchStats &
+CBoard::LastSearchStats()
+{
+   return threadSearchStats;
+}
+
+// Boards that the tree search running on each thread makes its moves on, one for each ply (a deque, so that the boards
+//   stay where they are when more are added)
+static thread_local std::deque<CBoard> threadPlyBoards;
+
+void
+CBoard::ReservePlyBoards(const unsigned int plies)
+{
+   while( threadPlyBoards.size() < plies )
+      threadPlyBoards.emplace_back();
+}
+
+CBoard &
+CBoard::PlyBoard(const unsigned int ply)
+{
+   return threadPlyBoards[ply];
+}
+
+// Function to get the time since the given time in milliseconds
+static double
+MillisecondsSince(const std::chrono::steady_clock::time_point &start)
+{
+   return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Function to fill in the time that a search for a move took & the memory that it used, once it has finished
+static void
+FinishSearchStats(CSearchStats &stats, const std::chrono::steady_clock::time_point &start, const CAllocationMeter &allocations)
+{
+   stats.elapsedMs = MillisecondsSince(start);
+   stats.boardBytes = sizeof(CBoard);
+   stats.plyBoardBytes = threadPlyBoards.size() * sizeof(CBoard);
+   if( CAllocations::Counting() )
+   {
+      const CAllocationCounts counts = allocations.Counts();
+      stats.allocationsCounted = true;
+      stats.allocations = counts.allocations;
+      stats.allocatedBytes = counts.bytes;
+      stats.peakLiveBytes = counts.peakLiveBytes;
+   }
+}
+
+// Function to list the memory that the AI uses
+void
+CBoard::GetMemoryFootprint(std::vector< std::pair<std::string, unsigned long long> > &footprint)
+{
+   footprint.clear();
+   footprint.push_back( std::make_pair(std::string("CBoard"), (unsigned long long)sizeof(CBoard)) );
+   footprint.push_back( std::make_pair(std::string("CBoard::CMoveTable"), (unsigned long long)sizeof(CMoveTable)) );
+   footprint.push_back( std::make_pair(std::string("CBoard::CMoveContainer"), (unsigned long long)sizeof(CMoveContainer)) );
+   footprint.push_back( std::make_pair(std::string("CRandomRS"), (unsigned long long)sizeof(CRandomRS)) );
+   footprint.push_back( std::make_pair(std::string("CSearchStats"), (unsigned long long)sizeof(CSearchStats)) );
+   footprint.push_back( std::make_pair(std::string("CMctsEngine"), (unsigned long long)sizeof(CMctsEngine)) );
+   footprint.push_back( std::make_pair(std::string("ply_boards"), (unsigned long long)(threadPlyBoards.size() * sizeof(CBoard))) );
+   footprint.push_back( std::make_pair(std::string("transposition_table"), transpositionTable.Bytes()) );
+}
 
 //#define _DEBUG
 // --------------------------------------------------------------------------- //
@@ -27,22 +112,19 @@ CBoard::ResetBoard(const bool _IsXTurn)
       {
          GetSquare(x,y).GetPiece() = emptyPiece;
       }
-   // Simply assign each piece to its correct starting square
-   // (the following is only valid for an 8x8 board with 12 pieces per side)
-   // xs
-   for( unsigned int x = (boardLayout?1:0) ; x < width ; x+=2 )
-      GetSquare(x,0).GetPiece() = pieceX;
-   for( unsigned int x = (boardLayout?0:1) ; x < width ; x+=2 )
-      GetSquare(x,1).GetPiece() = pieceX;
-   for( unsigned int x = (boardLayout?1:0) ; x < width ; x+=2 )
-      GetSquare(x,2).GetPiece() = pieceX;
-   // os
-   for( unsigned int x = (boardLayout?0:1) ; x < width ; x+=2 )
-      GetSquare(x,height-1).GetPiece() = pieceO;
-   for( unsigned int x = (boardLayout?1:0) ; x < width ; x+=2 )
-      GetSquare(x,height-2).GetPiece() = pieceO;
-   for( unsigned int x = (boardLayout?0:1) ; x < width ; x+=2 )
-      GetSquare(x,height-3).GetPiece() = pieceO;
+   // Fill the playable squares of the rows at each end of the board, leaving 2 empty rows in the middle (or 3, if the
+   //   height is odd) - 3 rows each of xs & os on an 8x8 board
+   const unsigned int startRows = (height-2)/2;
+   for( unsigned int y = 0 ; y < startRows ; y++ )
+      for( unsigned int x = 0 ; x < width ; x++ )
+      {
+         // xs
+         if( IsPlayableSquare(x,y) )
+            GetSquare(x,y).GetPiece() = pieceX;
+         // os
+         if( IsPlayableSquare(x,height-1-y) )
+            GetSquare(x,height-1-y).GetPiece() = pieceO;
+      }
    
    // Reset the currently-selected square
    SelectSquare(width/2, height/2);
@@ -59,7 +141,8 @@ CBoard::ResetBoard(const bool _IsXTurn)
    
    isXTurn = _IsXTurn;
    
-   // Finally calculate what all the moves are for the current (1st) player
+   // Finally calculate what all the moves are for the current (1st) player (both sides' tables must be rebuilt)
+   changedSquares[0] = changedSquares[1] = ALL_SQUARES;
    CalculateAllMoves();
 }
 
@@ -108,7 +191,7 @@ CBoard::ExecuteSelectedSquare()
    {
       // Try to find the current move/destination square (selectedSquare) in the passive & aggressive moves vectors
       // Note: it should be IMPOSSIBLE for the move to appear in both the passive & aggressive lists
-      std::vector<CSquareLocation>::iterator findPassiveIt , findAggressiveIt;
+      CSquareList::iterator findPassiveIt , findAggressiveIt;
       findPassiveIt = std::find( executionSquareMoves.passiveMoves.begin() , executionSquareMoves.passiveMoves.end() , selectedSquare );
       findAggressiveIt = std::find( executionSquareMoves.aggressiveMoves.begin() , executionSquareMoves.aggressiveMoves.end() , selectedSquare );
       
@@ -125,6 +208,8 @@ CBoard::ExecuteSelectedSquare()
          CPiece pieceToMove = GetSquare(executionSquare).GetPiece();
          GetSquare(selectedSquare).GetPiece() = pieceToMove;
          GetSquare(executionSquare).GetPiece() = emptyPiece;
+         SquareChanged(executionSquare);
+         SquareChanged(selectedSquare);
          
          // Check whether the piece should be transformed into a king (crowned)
          bool pieceCrowned = false;
@@ -140,6 +225,7 @@ CBoard::ExecuteSelectedSquare()
          if( findAggressiveIt != executionSquareMoves.aggressiveMoves.end() )
          {
             GetSquare((selectedSquare.x+executionSquare.x)/2 , (selectedSquare.y+executionSquare.y)/2).GetPiece() = emptyPiece;
+            SquareChanged(CSquareLocation((selectedSquare.x+executionSquare.x)/2 , (selectedSquare.y+executionSquare.y)/2));
 
             // If the move was aggressive, then check whether more aggressive moves are possible for this piece
             executionSquare = selectedSquare;
@@ -204,10 +290,6 @@ CBoard::PopulateMoves(const CPiece &currentPiece, const bool populatePassive, CM
    moves.Clear();
    //ResetMoves();
 
-   const int xm1 = moves.pieceLocation.x-1;
-   const int xp1 = moves.pieceLocation.x+1;
-   const int ym1 = moves.pieceLocation.y-1;
-   const int yp1 = moves.pieceLocation.y+1;
    // Passive moves - only if the square to move into is unoccupied):
    //   If piece is an 'o' then it can move into a square offset by coordinate (+/-1 , -1) (diagonally 'up' the board)
    //   If piece is an 'x' then it can move into a square offset by coordinate (+/-1 , +1) (diagonally 'down' the board)
@@ -216,63 +298,34 @@ CBoard::PopulateMoves(const CPiece &currentPiece, const bool populatePassive, CM
    //   If one of the above passive moves is blocked by an opposing piece, then check to see whether 
    //     the square diagonally behind the opposing piece is empty - if it is, then that square is 
    //     added to the list of aggressive moves
+   //
+   // The neighbouring & jump squares in each direction come from the square's links, so no bounds checks are needed:
+   //   only the directions whose neighbouring square is on the board (the bits of the links' neighbourMask) are walked
+   const CSquareLinks &links = squareLinks[(moves.pieceLocation.y*width) + moves.pieceLocation.x];
+   // Directions 0 (-1,+1) & 1 (+1,+1) move +ve y (a king or an X-man), 2 (-1,-1) & 3 (+1,-1) move -ve y (a king or an O-man)
+   const unsigned int pieceDirections = ( !(currentPiece.IsMan()) ? 0xFu : (currentPiece.IsX() ? 0x3u : 0xCu) );
+   for( unsigned int directions = pieceDirections & links.neighbourMask ; directions != 0 ; directions &= directions-1 )
+      PopulateDirection(currentPiece, populatePassive, links, __builtin_ctz(directions), moves);
+}
 
-   if( !(currentPiece.IsMan()) || currentPiece.IsX() )   // King or X-man can move +ve y
-   {
-      if( xm1>=0 && yp1<int(height) ) //(-1,+1)
-      {
-         // Add (-1,+1) to passive moves if square is empty
-         if( GetSquare(xm1,yp1).GetPiece() == emptyPiece )
-         {
-            if( populatePassive )
-               moves.passiveMoves.push_back(CSquareLocation(xm1,yp1));
-         }
-         // Add (-2,+2) to aggressive moves if (-1,+1) contains an opposition piece, and (-2,+2) is in bounds, and (-2,+2) is empty
-         else if( ( GetSquare(xm1,yp1).GetPiece().IsX() != currentPiece.IsX() ) && (xm1>0 && yp1<(int(height)-1)) && (GetSquare(xm1-1,yp1+1).GetPiece() == emptyPiece) )
-            moves.aggressiveMoves.push_back(CSquareLocation(xm1-1,yp1+1));
-      }
-      if( xp1<width && yp1<int(height) ) //(+1,+1)
-      {
-         // Add (+1,+1) to passive moves if square is empty
-         if( GetSquare(xp1,yp1).GetPiece() == emptyPiece )
-         {
-            if( populatePassive )
-               moves.passiveMoves.push_back(CSquareLocation(xp1,yp1));
-         }
-         // Add (+2,+2) to aggressive moves if (+1,+1) contains an opposition piece, and (+2,+2) is in bounds, and (+2,+2) is empty
-         else if( ( GetSquare(xp1,yp1).GetPiece().IsX() != currentPiece.IsX() ) && (xp1<(int(width)-1) && yp1<(int(height)-1)) && (GetSquare(xp1+1,yp1+1).GetPiece() == emptyPiece) )
-            moves.aggressiveMoves.push_back(CSquareLocation(xp1+1,yp1+1));
-      }
-   }
+inline void
+CBoard::PopulateDirection(const CPiece &currentPiece, const bool populatePassive, const CSquareLinks &links,
+                          const unsigned int direction, CMoveContainer &moves)
+{
+   const int dx = ( (direction & 1) ? 1 : -1 );
+   const int dy = ( (direction & 2) ? -1 : 1 );
 
-   if( !(currentPiece.IsMan()) || !(currentPiece.IsX()) )   // King or O-man can move -ve y
+   const CPiece &neighbour = squares[links.neighbour[direction]].GetPiece();
+   // Add (+/-1,+/-1) to passive moves if square is empty
+   if( neighbour == emptyPiece )
    {
-      if( xm1>=0 && ym1>=0 )     //(-1,-1)
-      {
-         // Add (-1,-1) to passive moves if square is empty
-         if( GetSquare(xm1,ym1).GetPiece() == emptyPiece )
-         {
-            if( populatePassive )
-               moves.passiveMoves.push_back(CSquareLocation(xm1,ym1));
-         }
-         // Add (-2,-2) to aggressive moves if (-1,-1) contains an opposition piece, and (-2,-2) is in bounds, and (-2,2) is empty
-         else if( ( GetSquare(xm1,ym1).GetPiece().IsX() != currentPiece.IsX() ) && (xm1>0 && ym1>0) && (GetSquare(xm1-1,ym1-1).GetPiece() == emptyPiece) )
-            moves.aggressiveMoves.push_back(CSquareLocation(xm1-1,ym1-1));
-      }
-      if( xp1<int(width) && ym1>=0 )     //(+1,-1)
-      {
-         // Add (+1,-1) to passive moves if square is empty
-         if( GetSquare(xp1,ym1).GetPiece() == emptyPiece )
-         {
-            if( populatePassive )
-               moves.passiveMoves.push_back(CSquareLocation(xp1,ym1));
-         }
-         // Add (+2,-2) to aggressive moves if (+1,-1) contains an opposition piece, and (+2,-2) is in bounds, and (+2,-2) is empty
-         else if( ( GetSquare(xp1,ym1).GetPiece().IsX() != currentPiece.IsX() ) && (xp1<(int(width)-1) && ym1>0) && (GetSquare(xp1+1,ym1-1).GetPiece() == emptyPiece) )
-            moves.aggressiveMoves.push_back(CSquareLocation(xp1+1,ym1-1));
-      }
+      if( populatePassive )
+         moves.passiveMoves.push_back(CSquareLocation(moves.pieceLocation.x + dx, moves.pieceLocation.y + dy));
    }
-
+   // Add (+/-2,+/-2) to aggressive moves if (+/-1,+/-1) contains an opposition piece, and (+/-2,+/-2) is in bounds, and (+/-2,+/-2) is empty
+   else if( (neighbour.IsX() != currentPiece.IsX()) && ((links.jumpMask >> direction) & 1u) &&
+            (squares[links.jump[direction]].GetPiece() == emptyPiece) )
+      moves.aggressiveMoves.push_back(CSquareLocation(moves.pieceLocation.x + 2*dx, moves.pieceLocation.y + 2*dy));
 }
 
 
@@ -296,42 +349,66 @@ CBoard::CancelMultiTurn()
 
 
 // --------------------------------------------------------------------------- //
-// Function to populate the currentTurnAllMoves vector
+// Function to bring the current side's table of moves up to date & check whether it has any moves
 // --------------------------------------------------------------------------- //
 
 void
 CBoard::CalculateAllMoves()
 {
-   // Clear all of the existing moves & piece locations in the currentTurnAllMoves vector
-   for( unsigned int pieceIndex = 0 ; pieceIndex < currentTurnAllMoves.size() ; pieceIndex++ )
+   if( changedSquares[isXTurn] == ALL_SQUARES )
+      RebuildSideMoves(isXTurn);
+   else if( changedSquares[isXTurn] != 0 )
+      UpdateSideMoves(isXTurn);
+   changedSquares[isXTurn] = 0;
+
+   const CMoveTable &allMoves = sideMoves[isXTurn];
+   unsigned int passiveMovesAvailable = 0;
+   unsigned int aggressiveMovesAvailable = 0;
+   for( unsigned int pieceIndex = 0 ; pieceIndex < numSidePieces[isXTurn] ; pieceIndex++ )
+   {
+      passiveMovesAvailable += allMoves[pieceIndex].passiveMoves.size();
+      aggressiveMovesAvailable += allMoves[pieceIndex].aggressiveMoves.size();
+   }
+
+   currentSideHasMoves = (passiveMovesAvailable + aggressiveMovesAvailable) > 0;
+   currentSideHasAggressiveMoves = aggressiveMovesAvailable > 0;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to rebuild a side's table of moves from scratch
+// --------------------------------------------------------------------------- //
+
+void
+CBoard::RebuildSideMoves(const bool sideIsX)
+{
+   CMoveTable &allMoves = sideMoves[sideIsX];
+
+   // Clear all of the existing moves & piece locations in the table
+   for( unsigned int pieceIndex = 0 ; pieceIndex < allMoves.size() ; pieceIndex++ )
    {
-      currentTurnAllMoves[pieceIndex].Clear();
-      currentTurnAllMoves[pieceIndex].pieceLocation = CSquareLocation(-1,-1);
+      allMoves[pieceIndex].Clear();
+      allMoves[pieceIndex].pieceLocation = CSquareLocation(-1,-1);
    }
    
    unsigned int pieceIndex = 0;
-   unsigned int passiveMovesAvailable = 0;
-   unsigned int aggressiveMovesAvailable = 0;
    // Loop through all squares in the board
-   // If a square contains a piece whose side is the same as isXTurn, then populate the moves for that piece
+   // If a square contains a piece of the side, then populate the moves for that piece
    
+   unsigned int square = 0;
    for(unsigned int y = 0 ; y < height ; y++)
    {
-      for(unsigned int x = 0 ; x < width ; x++)
+      for(unsigned int x = 0 ; x < width ; x++, square++)
       {
-         const CPiece &currentPiece = GetSquare(x,y).GetPiece();
-         // If the current piece is not empty and it is the turn of the current piece's side, then populate the moves & increment the pieceIndex
+         const CPiece &currentPiece = squares[square].GetPiece();
+         // If the current piece is not empty and belongs to the side, then populate the moves & increment the pieceIndex
          if( (currentPiece != emptyPiece) &&
-             (currentPiece.IsX() == isXTurn) )
+             (currentPiece.IsX() == sideIsX) )
          {
-            currentTurnAllMoves[pieceIndex].pieceLocation.x = x;
-            currentTurnAllMoves[pieceIndex].pieceLocation.y = y;
+            allMoves[pieceIndex].pieceLocation.x = x;
+            allMoves[pieceIndex].pieceLocation.y = y;
 
-            PopulateMoves(currentPiece, true, currentTurnAllMoves[pieceIndex]);
-            
-            // Update the number of available moves
-            passiveMovesAvailable += currentTurnAllMoves[pieceIndex].passiveMoves.size();
-            aggressiveMovesAvailable += currentTurnAllMoves[pieceIndex].aggressiveMoves.size();
+            PopulateMoves(currentPiece, true, allMoves[pieceIndex]);
             
             // Increment the index
             pieceIndex++;
@@ -339,8 +416,87 @@ CBoard::CalculateAllMoves()
       }
    }
 
-   currentSideHasMoves = (passiveMovesAvailable + aggressiveMovesAvailable) > 0;
-   currentSideHasAggressiveMoves = aggressiveMovesAvailable > 0;
+   numSidePieces[sideIsX] = pieceIndex;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to update a side's table of moves for the squares that have changed since it was last brought up to date
+//   - The pieces that have left a changed square (moved or been captured) are taken out of the table, the pieces that
+//     have arrived on one are put into it (keeping the table in scan order), & then only the pieces whose moves depend
+//     on a changed square have their moves worked out again
+// --------------------------------------------------------------------------- //
+
+void
+CBoard::UpdateSideMoves(const bool sideIsX)
+{
+   CMoveTable &allMoves = sideMoves[sideIsX];
+   unsigned int &numPieces = numSidePieces[sideIsX];
+   const unsigned long long changed = changedSquares[sideIsX];
+
+   // Take out the pieces that have left a changed square (the empty entry goes to the end of the table)
+   for( unsigned int pieceIndex = 0 ; pieceIndex < numPieces ; )
+   {
+      const CSquareLocation &location = allMoves[pieceIndex].pieceLocation;
+      const unsigned int square = (location.y*width) + location.x;
+      const CPiece &currentPiece = squares[square].GetPiece();
+      if( ((changed >> square) & 1) && ((currentPiece == emptyPiece) || (currentPiece.IsX() != sideIsX)) )
+      {
+         allMoves[pieceIndex].Clear();
+         allMoves[pieceIndex].pieceLocation = CSquareLocation(-1,-1);
+         std::rotate(allMoves.begin() + pieceIndex, allMoves.begin() + pieceIndex + 1, allMoves.begin() + numPieces);
+         numPieces--;
+      }
+      else
+         pieceIndex++;
+   }
+
+   // Put in the pieces that have arrived on a changed square (in ascending order of square, so the insertion point only
+   //   moves forwards)
+   unsigned int pieceIndex = 0;
+   for( unsigned long long squaresLeft = changed ; squaresLeft != 0 ; squaresLeft &= squaresLeft-1 )
+   {
+      const unsigned int square = __builtin_ctzll(squaresLeft);
+      const CPiece &currentPiece = squares[square].GetPiece();
+      if( (currentPiece == emptyPiece) || (currentPiece.IsX() != sideIsX) )
+         continue;
+
+      while( (pieceIndex < numPieces) &&
+             ((allMoves[pieceIndex].pieceLocation.y*width) + allMoves[pieceIndex].pieceLocation.x < square) )
+         pieceIndex++;
+      // The piece may still be in the table (e.g. a king that has jumped back to the square that it started on)
+      if( (pieceIndex < numPieces) && ((allMoves[pieceIndex].pieceLocation.y*width) + allMoves[pieceIndex].pieceLocation.x == square) )
+         continue;
+      // Neither side can have more pieces than it starts with, so there is always an empty entry at the end
+      std::rotate(allMoves.begin() + pieceIndex, allMoves.begin() + numPieces, allMoves.begin() + numPieces + 1);
+      allMoves[pieceIndex].pieceLocation = CSquareLocation(square % width, square / width);
+      numPieces++;
+   }
+
+   // Work out the moves of the pieces that can be affected by the changes
+   for( pieceIndex = 0 ; pieceIndex < numPieces ; pieceIndex++ )
+   {
+      const CSquareLocation &location = allMoves[pieceIndex].pieceLocation;
+      const unsigned int square = (location.y*width) + location.x;
+      if( squareLinks[square].influenceMask & changed )
+         PopulateMoves(squares[square].GetPiece(), true, allMoves[pieceIndex]);
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the square links for a board size (the supported variants are all square boards)
+// --------------------------------------------------------------------------- //
+
+const CSquareLinks *
+CBoard::SquareLinks(const unsigned int size)
+{
+   switch( size )
+   {
+      case 6:  return CGridLinks<6>::Table();
+      case 7:  return CGridLinks<7>::Table();
+      default: return CGridLinks<8>::Table();
+   }
 }
 
 
@@ -350,141 +506,299 @@ CBoard::CalculateAllMoves()
 
 bool
 CBoard::InvokeAI( int depth )
+{
+   CMove move;
+   const bool aiSuccess = ChooseMove( CSearchLimits(depth), 0, move );
+   if( aiSuccess )
+      QueueMove(move);
+   return aiSuccess;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to start the AI searching for a move on a separate thread
+// --------------------------------------------------------------------------- //
+
+CAIHandle
+CBoard::StartAI(const CSearchLimits &limits) const
+{
+   CAIHandle handle;
+   handle.stop = std::make_shared< std::atomic<bool> >(false);
+
+   // The search works on its own copy of the board, so this board can still be used (e.g. drawn) while the AI thinks
+   //   (the search thread has its own random numbers, so every search from this board makes different random choices)
+   CBoard board = *this;
+   const std::shared_ptr< std::atomic<bool> > stop = handle.stop;
+   const std::shared_ptr<CSearchStats> stats = handle.stats = std::make_shared<CSearchStats>();
+   handle.result = std::async( std::launch::async, [board, limits, stop, stats]() mutable
+                               {
+                                  CMove move;
+                                  board.ChooseMove(limits, stop.get(), move);
+                                  *stats = threadSearchStats;
+                                  return move;
+                               } );
+   return handle;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to start the AI pondering (searching on the opponent's time) on a separate thread
+// --------------------------------------------------------------------------- //
+
+CAIHandle
+CBoard::StartPonder(const CSearchLimits &limits) const
+{
+   CAIHandle handle;
+   handle.stop = std::make_shared< std::atomic<bool> >(false);
+   handle.ponder = std::make_shared<CPonderState>();
+
+   CBoard board = *this;
+   const std::shared_ptr< std::atomic<bool> > stop = handle.stop;
+   const std::shared_ptr<CPonderState> ponder = handle.ponder;
+   const std::shared_ptr<CSearchStats> stats = handle.stats = std::make_shared<CSearchStats>();
+   handle.result = std::async( std::launch::async, [board, limits, stop, ponder, stats]() mutable
+                               {
+                                  const CMove move = board.Ponder(limits, *stop, *ponder);
+                                  *stats = threadSearchStats;
+                                  return move;
+                               } );
+   return handle;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function that a ponder search runs
+//   - Until the opponent moves, the boards that each of the opponent's turns lead to are searched at depth 0, 1, 2, ...
+//     (all of the replies at one depth before any reply at the next depth), which fills the transposition table
+//   - Once the opponent has moved, the AI's move is chosen on the new board as normal, which finds the scores of the
+//     depths that were finished for that reply in the table (the scores for the other replies are simply left there)
+// --------------------------------------------------------------------------- //
+
+CBoard::CMove
+CBoard::Ponder(const CSearchLimits &limits, const std::atomic<bool> &stop, CPonderState &ponder)
+{
+   if( CurrentSideHasMoves() )
+   {
+      TRACE_SPAN("Ponder");
+      if( aiPersonality == MONTE_CARLO )
+      {
+         // Grow the tree from this board - the part below the opponent's actual move is reused by the next search
+         CMove opponentMove;
+         mctsEngine->Search(*this, std::numeric_limits<unsigned int>::max(), 0, opponentMove, &ponder.interrupt);
+      }
+      else
+      {
+         std::vector<CBoard> replies;
+         GetTurnBoards(replies);
+         for( int depth = 0 ; (depth <= limits.depth) && !ponder.interrupt ; depth++ )
+            for( unsigned int reply = 0 ; (reply < replies.size()) && !ponder.interrupt ; reply++ )
+            {
+               CMove move;
+               replies[reply].ChooseMove(CSearchLimits(depth), &ponder.interrupt, move);
+            }
+      }
+   }
+
+   // Nothing more to do until the opponent moves (or the pondering is stopped)
+   {
+      TRACE_SPAN("WaitForOpponent");
+      while( !ponder.interrupt )
+         std::this_thread::sleep_for(std::chrono::milliseconds(5));
+   }
+
+   std::unique_ptr<CBoard> board;
+   {
+      std::lock_guard<std::mutex> lock(ponder.mutex);
+      board.swap(ponder.opponentMoved);
+   }
+   // The statistics are those of the search for the AI's move, not of the pondering
+   threadSearchStats.Clear();
+   CMove move;
+   if( board && !stop )
+      board->ChooseMove(limits, &stop, move);
+   return move;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to list the boards that each of the current side's possible turns leads to
+// --------------------------------------------------------------------------- //
+
+void
+CBoard::GetTurnBoards(std::vector<CBoard> &turnBoards) const
+{
+   std::vector<CMove> moves;
+   GetLegalMoves(moves);
+   for( unsigned int move = 0 ; move < moves.size() ; move++ )
+   {
+      CBoard turnBoard = *this;
+      turnBoard.MakeMove(moves[move]);
+      // A jump that can be followed by another jump is only part of the turn
+      if( turnBoard.multiTurnSequence )
+         turnBoard.GetTurnBoards(turnBoards);
+      else
+         turnBoards.push_back(turnBoard);
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to check whether the current search should finish early (stop requested or time limit reached)
+// --------------------------------------------------------------------------- //
+
+bool
+CBoard::SearchAborted()
+{
+   if( !searchAborted )
+   {
+      if( (searchStop != 0) && searchStop->load(std::memory_order_relaxed) )
+         searchAborted = true;
+      // Only check the clock every 1024 nodes
+      else if( searchHasDeadline && ((searchNodes & 1023) == 0) && (std::chrono::steady_clock::now() >= searchDeadline) )
+         searchAborted = true;
+   }
+   return searchAborted;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function for the AI to choose a move
+//   - With only a depth limit, the moves are scored at that depth
+//   - With a time limit or a stop flag, the moves are scored at depth 0, 1, 2, ... up to the depth limit, and if the
+//     search is cut short then the move is chosen from the scores of the deepest search that finished
+// --------------------------------------------------------------------------- //
+
+bool
+CBoard::ChooseMove(const CSearchLimits &limits, const std::atomic<bool> *stop, CMove &bestMove)
 {
    // Signal for success or failure of the AI routine
    bool aiSuccess = true;
    
+   TRACE_SPAN("ChooseMove");
    // Signal which pieces the AI is controlling, so that the "score" calculation at each AI depth can be estimated
    aiIsX = isXTurn;
+
+   CSearchStats &stats = threadSearchStats;
+   stats.Clear();
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   const CAllocationMeter allocations;
+
+   // A move from the opening book is played straight away (except by the generous personality, which is meant to play
+   //   badly)
+   if( (aiPersonality != GENEROUS) && GetBookMove(bestMove) )
+   {
+      FinishSearchStats(stats, startTime, allocations);
+      return true;
+   }
    
+   // The Monte Carlo personality has its own search, which picks the move from the playouts rather than the tree score
+   if( aiPersonality == MONTE_CARLO )
+   {
+      const int maxTimeMs = ( limits.maxTimeMs > 0 ? limits.maxTimeMs : mctsMaxTimeMs );
+      aiSuccess = mctsEngine->Search(*this, mctsPlayouts, maxTimeMs, bestMove, stop);
+      stats.playouts = mctsEngine->PlayoutsInLastSearch();
+      FinishSearchStats(stats, startTime, allocations);
+      return aiSuccess;
+   }
+
    // We can only decide on a move if there are moves available to make
    if( (!multiTurnSequence && CurrentSideHasMoves()) || (multiTurnSequence && executionSquareMoves.aggressiveMoves.size()>0) )
    {
-      // - If any aggressive moves exist, then the options to explore are only the aggressive moves
-      // - Else only passive moves exist, so the options to explore are only the passive moves
-      // - Now create a vector of scores, the size of which is equal to the number of options that are to be explored
-      unsigned int numMoves = 0;
-      // If we're in a multi-turn sequence then the piece to move is fixed & the possible destination squares are in executionSquareMoves
-      if( multiTurnSequence )
-      {
-         numMoves = executionSquareMoves.aggressiveMoves.size();
-      }
-      else if( currentSideHasAggressiveMoves )
-      {
-         for( unsigned int piece = 0 ; piece < currentTurnAllMoves.size() ; piece++ )
-            numMoves += currentTurnAllMoves[piece].aggressiveMoves.size();
-      }
-      else
-      {
-         for( unsigned int piece = 0 ; piece < currentTurnAllMoves.size() ; piece++ )
-            numMoves += currentTurnAllMoves[piece].passiveMoves.size();
-      }
-      std::vector<int> scores(numMoves);
-      // - Create a vector of CBoards of the same size (each of which is a copy of this CBoard), and set the executionSquare 
-      //     to the piece that is to be moved and the selectedSquare to the move that is to be made
-      std::vector<CBoard> boards(numMoves, *this);
-      if( multiTurnSequence )
+      // - List the options to explore: in a multi-turn sequence only the further jumps of the moving piece, otherwise
+      //     the aggressive moves if any exist, else the passive moves
+      // - The scores & the indices of the best options are kept in arrays of the same size, & each option's move is
+      //     made on the thread's board for the first ply (see GetMoveScore), so the search does not allocate any memory
+      CMove moves[MAX_MOVES];
+      const unsigned int numMoves = ListLegalMoves(moves);
+      int scores[MAX_MOVES];
+      ReservePlyBoards(limits.depth+1);
+
+      // Set up the checks for finishing the search early
+      searchStop = stop;
+      searchHasDeadline = (limits.maxTimeMs > 0);
+      searchDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.maxTimeMs);
+      searchNodes = 0;
+      searchAborted = false;
+      const bool canFinishEarly = (stop != 0) || searchHasDeadline;
+
+      // Indices of the options with the highest score in the deepest search that has finished
+      unsigned int maxScoreIndex[MAX_MOVES];
+      unsigned int numMaxScores = 0;
+
       {
-         unsigned int boardIndex = 0;
-         for( unsigned int move = 0 ; move < executionSquareMoves.aggressiveMoves.size() ; move++ )
+         CNoAllocationScope noAllocations;
+         for( int searchDepth = (canFinishEarly ? 0 : limits.depth) ; searchDepth <= limits.depth ; searchDepth++ )
          {
-            boards[boardIndex].selectedSquare = executionSquareMoves.aggressiveMoves[move];
-            boardIndex++;
-         }
-      }
-      else if( currentSideHasAggressiveMoves )
-      {
-         //std::cout << "(InvokeAI, aggressive board pop.) numMoves = " << numMoves << ", " << std::endl;
-         unsigned int boardIndex = 0;
-         for( unsigned int piece = 0 ; piece < currentTurnAllMoves.size() ; piece++ )
-            for( unsigned int move = 0 ; move < currentTurnAllMoves[piece].aggressiveMoves.size() ; move++ )
-            {
-               boards[boardIndex].selectedSquare = currentTurnAllMoves[piece].pieceLocation;
-               boards[boardIndex].ExecuteSelectedSquare();
-               boards[boardIndex].selectedSquare = currentTurnAllMoves[piece].aggressiveMoves[move];
-               boardIndex++;
-            }
-      }
-      else
-      {
-         unsigned int boardIndex = 0;
-         for( unsigned int piece = 0 ; piece < currentTurnAllMoves.size() ; piece++ )
-            for( unsigned int move = 0 ; move < currentTurnAllMoves[piece].passiveMoves.size() ; move++ )
+            // - For each option, pass the move into the GetMoveScore function, and assign the function's return value to
+            //     the relevant score entry
+            int maxScore = std::numeric_limits<int>::min();
+            unsigned int depthMaxScoreIndex[MAX_MOVES];
+            unsigned int numDepthMaxScores = 0;
+            SEARCH_STATS( stats.iterationDepth = searchDepth; )
+            TRACE_SPAN_ARG("Iteration", "depth", searchDepth);
+
+            for( unsigned int option = 0 ; option < numMoves ; option++ )
             {
-               boards[boardIndex].selectedSquare = currentTurnAllMoves[piece].pieceLocation;
-               boards[boardIndex].ExecuteSelectedSquare();
-               boards[boardIndex].selectedSquare = currentTurnAllMoves[piece].passiveMoves[move];
-               boardIndex++;
+               TRACE_SPAN_ARG("RootMove", "move", option);
+#ifdef _DEBUG
+               std::cout << "(InvokeAI) Evaluating option " << option << std::endl;
+#endif
+               scores[option] = GetMoveScore( *this , moves[option] , searchDepth , 0 );
+               if( scores[option] > maxScore )
+               {
+                  // Clear any previous max scores (needed in case there were multiple options with the same max score)
+                  numDepthMaxScores = 0;
+                  // Update the max score & index
+                  maxScore = scores[option];
+                  depthMaxScoreIndex[numDepthMaxScores++] = option;
+               }
+               else if( scores[option] == maxScore )  // multiple options with the same max score
+               {
+                  depthMaxScoreIndex[numDepthMaxScores++] = option;
+               }
             }
+            // The scores of a search that was cut short are incomplete, so they are not used
+            if( SearchAborted() )
+               break;
+            std::copy(depthMaxScoreIndex, depthMaxScoreIndex + numDepthMaxScores, maxScoreIndex);
+            numMaxScores = numDepthMaxScores;
+            stats.depth = searchDepth;
+         }
       }
-      // - For each option, pass the CBoard into the GetTreeScore function, and assign the function's return value to the 
-      //     relevant score vector entry
-      std::vector<int> maxScore;
-      maxScore.reserve(numMoves);
-      maxScore.push_back(-1024);
+      searchStop = 0;
+      searchHasDeadline = false;
 
-      std::vector<unsigned int> maxScoreIndex;
-      maxScoreIndex.reserve(numMoves);
-      maxScoreIndex.push_back(0);
-
-      for( unsigned int option = 0 ; option < numMoves ; option++ )
+      // If even the depth 0 search was cut short, then any of the options will do
+      if( numMaxScores == 0 )
       {
-#ifdef _DEBUG
-         std::cout << "(InvokeAI) Evaluating option " << option << std::endl;
-         boards[option].Draw();
-#endif
-         scores[option] = GetTreeScore( boards[option] , /*isXTurn ,*/ depth );
-         //exit(0);
-         if( scores[option] > maxScore[0] )
-         {
-            // Clear any previous max scores (needed in case there were multiple options with the same max score)
-            maxScore.clear();
-            maxScoreIndex.clear();
-            // Update the max score & index
-            maxScore.push_back(scores[option]);
-            maxScoreIndex.push_back(option);
-         }
-         else if( scores[option] == maxScore[0] )  // multiple options with the same max score
-         {
-            maxScore.push_back(scores[option]);
-            maxScoreIndex.push_back(option);
-         }
+         for( unsigned int option = 0 ; option < numMoves ; option++ )
+            maxScoreIndex[numMaxScores++] = option;
       }
+
       // Test which score is the highest - in the case of a draw, select a random one from amongst the best.
       unsigned int optionToSelect = 0;
-      if( maxScore.size() == 0 ) // Something has gone very wrong...
+      if( numMaxScores == 0 ) // Something has gone very wrong...
       {
          aiSuccess = false;
       }
-      else if( maxScore.size() > 1 )   // Need to randomly pick an option
+      else if( numMaxScores > 1 )   // Need to randomly pick an option
       {
-         // Set the range of the random number generator
-         rng.SetRange(0,maxScore.size()-1);
-         // Select a random index
-         optionToSelect = maxScoreIndex[rng.GetNumber()];
+         // Select a random index (with the thread's random number generator)
+         optionToSelect = maxScoreIndex[CRandomRS::Thread().Below(numMaxScores)];
       }
       else
       {
          optionToSelect = maxScoreIndex[0];
       }
-      // Set this version of the CBoard's executionSquare & selectedSquare to those of the highest score, and call 
-      //   ExecuteSelectedSquare( isXTurn )
+      // The chosen move is the chosen option's move
       if( aiSuccess )
       {
 #ifdef _DEBUG
          std::cout << "(InvokeAI) Selected option " << optionToSelect << ": ("
-                   <<boards[optionToSelect].executionSquare.x<<","<<boards[optionToSelect].executionSquare.y<<") -> ("
-                   <<boards[optionToSelect].selectedSquare.x <<","<<boards[optionToSelect].selectedSquare.y <<")" << std::endl;
+                   << moves[optionToSelect].fromX << "," << moves[optionToSelect].fromY << ") -> ("
+                   << moves[optionToSelect].toX   << "," << moves[optionToSelect].toY   << ")" << std::endl;
 #endif
-
-         // Only need to select the piece to move if we are not in a multi-turn sequence
-         if( !multiTurnSequence )
-         {
-            selectedSquare = boards[optionToSelect].executionSquare;
-            ExecuteSelectedSquare( /*isXTurn*/ );
-         }
-         selectedSquare = boards[optionToSelect].selectedSquare;
-         //ExecuteSelectedSquare( /*isXTurn*/ );
+         bestMove = moves[optionToSelect];
       }
       
    }
@@ -493,19 +807,20 @@ CBoard::InvokeAI( int depth )
    {
       aiSuccess = false;
    }
+   FinishSearchStats(stats, startTime, allocations);
    
    return aiSuccess;
    
    // This function will replace InvokeAI
 
    // This function wants to look at all the possible moves for the current board configuration & choose one of them to execute
-   // It does this by calling GetTreeScore for all of either the aggressive or passive moves in the currentTurnAllMoves vector
+   // It does this by calling GetTreeScore for all of either the aggressive or passive moves in the CurrentTurnAllMoves() vector
    //   and then setting the executionSquare and selectSquare of the move with the best resultant score & executing
    
    // The aim is to create a list of CMoveContainers, each of which contains the CSquareLocation of the piece to move & 
    //   either a list of aggressiveMoves or a list of passiveMoves (the other list must be empty)
 
-   // The number of possible options can be obtained by iterating through currentTurnAllMoves & summing the size of the 
+   // The number of possible options can be obtained by iterating through CurrentTurnAllMoves() & summing the size of the 
    //   aggressiveMoves & passiveMoves vectors for each piece
    // If any aggressive moves exist, then the options to explore are only the aggressive moves
    // Else If any passive moves exist, then the options to explore are only the passive moves
@@ -522,20 +837,137 @@ CBoard::InvokeAI( int depth )
 }
 
 
+// --------------------------------------------------------------------------- //
+// Function for the AI to score each of the moves that are currently allowed
+// --------------------------------------------------------------------------- //
+
+bool
+CBoard::ScoreMoves(const CSearchLimits &limits, std::vector<CMove> &moves, std::vector<int> &scores)
+{
+   aiIsX = isXTurn;
+   GetLegalMoves(moves);
+   scores.clear();
+
+   CSearchStats &stats = threadSearchStats;
+   stats.Clear();
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   const CAllocationMeter allocations;
+
+   searchStop = 0;
+   searchHasDeadline = (limits.maxTimeMs > 0);
+   searchDeadline = startTime + std::chrono::milliseconds(limits.maxTimeMs);
+   searchNodes = 0;
+   searchAborted = false;
+
+   // All of the memory that the search needs is set aside before it starts
+   std::vector<int> depthScores(moves.size());
+   scores.reserve(moves.size());
+   ReservePlyBoards(limits.depth+1);
+   {
+      CNoAllocationScope noAllocations;
+      for( int searchDepth = (searchHasDeadline ? 0 : limits.depth) ; searchDepth <= limits.depth ; searchDepth++ )
+      {
+         SEARCH_STATS( stats.iterationDepth = searchDepth; )
+         TRACE_SPAN_ARG("Iteration", "depth", searchDepth);
+         for( unsigned int move = 0 ; move < moves.size() ; move++ )
+         {
+            TRACE_SPAN_ARG("RootMove", "move", move);
+            depthScores[move] = GetMoveScore( *this , moves[move] , searchDepth , 0 );
+         }
+         if( SearchAborted() )
+            break;
+         scores = depthScores;
+         stats.depth = searchDepth;
+      }
+   }
+   searchHasDeadline = false;
+   FinishSearchStats(stats, startTime, allocations);
+
+   return !moves.empty() && (scores.size() == moves.size());
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to score the board that a move leads to, making the move on the thread's board for the given ply
+// --------------------------------------------------------------------------- //
+
+int
+CBoard::GetMoveScore( const CBoard &board , const CMove &move , const int depth , const unsigned int ply )
+{
+   CBoard &moveBoard = PlyBoard(ply);
+   moveBoard = board;
+   moveBoard.QueueMove(move);
+   return GetTreeScore( moveBoard , depth , ply );
+}
+
+
 // --------------------------------------------------------------------------- //
 // Function to evaluate all of the possible moves for the input board configuration
 // and return the score of
 // --------------------------------------------------------------------------- //
 
 int
-CBoard::GetTreeScore( CBoard src_board , int depth )
+CBoard::GetTreeScore( const CBoard &board , int depth , const unsigned int ply )
 {
    //std::cout << "(GetTreeScore, depth " << depth << ") Executing move (" 
    //          << src_board.executionSquare.x << "," << src_board.executionSquare.y << ") -> ("
    //          << src_boardsrc_board.selectedSquare.x  << "," << src_board.selectedSquare.y  << ")"<< std::endl;
+   // If the search is being cut short, then the score does not matter (the search's results will be discarded)
+   if( SearchAborted() )
+      return 0;
+   searchNodes++;
+   // The boards that the AI's moves lead to are at ply 1 in the statistics
+   SEARCH_STATS( CSearchStats &stats = threadSearchStats;
+                 const unsigned int statsPly = std::min(ply+1, (unsigned int)CSearchStats::MAX_PLIES);
+                 stats.nodes++;
+                 stats.plyNodes[statsPly]++;
+                 stats.maxPly = std::max(stats.maxPly, statsPly); )
+
+   // The move is made on the thread's board for this ply (which the board already is, unless the search starts here)
+   if( ply == 0 )
+      ReservePlyBoards(depth+1);
+   CBoard &src_board = PlyBoard(ply);
+   if( &src_board != &board )
+      src_board = board;
+
    // src_board will have the executionSquare and selectedSquare already set
    // Call src_board.ExecuteSelectedSquare(isXTurn) on the src_board
    src_board.ExecuteSelectedSquare();
+   // If there are few enough pieces left to be in the endgame tablebase, then the result of the game is already known,
+   //   so score it like a won/lost game without searching any further (a win that is further away scores a little less)
+   unsigned char tablebaseValue = TbValue::DRAW;
+   if( src_board.ProbeTablebase(tablebaseValue) )
+   {
+      int score = 0;
+      if( tablebaseValue != TbValue::DRAW )
+      {
+         score = evalWeights.winScore - std::min( int(TbValue::Distance(tablebaseValue)), evalWeights.winScore-1 );
+         if( TbValue::IsLoss(tablebaseValue) )
+            score = -score;
+         // The value is for the side to move, so +ve if it is the AI's turn
+         if( src_board.IsXTurn() != aiIsX )
+            score = -score;
+      }
+      if( aiPersonality == GENEROUS )
+         score = -score;
+      SEARCH_STATS( stats.cutoffs++; )
+      return score;
+   }
+   // The built-in bitbase only knows who wins, not how far away the win is, so the evaluation is added to it to make
+   //   the AI take the opponent's pieces rather than shuffle its kings around
+   int bitbaseResult = 0;
+   if( src_board.ProbeBitbase(bitbaseResult) )
+   {
+      // The result is for the side to move, so +ve if it is the AI's turn
+      int score = bitbaseResult * (evalWeights.winScore/2) * ( src_board.IsXTurn() == aiIsX ? 1 : -1 );
+      int features[NUM_EVAL_FEATURES];
+      src_board.GetEvalFeatures(aiIsX, features);
+      score += evalWeights.Score(features);
+      if( aiPersonality == GENEROUS )
+         score = -score;
+      SEARCH_STATS( stats.cutoffs++; )
+      return score;
+   }
    // If we've entered into a multi-turn sequence with the above move, then don't calculate all moves (it's already been done)
    //if( !src_board.multiTurnSequence )
    //{
@@ -547,98 +979,49 @@ CBoard::GetTreeScore( CBoard src_board , int depth )
    if( (--depth < 0) || !(src_board.CurrentSideHasMoves()) )
    {
       int score = 0;
-      // If src_board.CurrentSideHasMoves() == false, then +/- 100 depending on which side has won
+      // If src_board.CurrentSideHasMoves() == false, then +/- the win score depending on which side has won
       if( !(src_board.CurrentSideHasMoves()) )
       {
-         // If it is the AI's turn & there are no moves left, then this is a bad move, so -100
-         score = ( (src_board.IsXTurn() == aiIsX) ? -100 : 100 );
+         // If it is the AI's turn & there are no moves left, then this is a bad move, so -ve
+         score = ( (src_board.IsXTurn() == aiIsX) ? -evalWeights.winScore : evalWeights.winScore );
       }
       else
       {
-         // Go through all of the squares in the src_board & +1 if it is the ai's piece, & -1 if it is the opponent's piece (& +0 if it is empty)
-         for(unsigned int y = 0 ; y < height ; y++)
-         {
-            for(unsigned int x = 0 ; x < width ; x++)
-            {
-               const CPiece currentPiece = src_board.GetSquare(x,y).GetPiece();
-               if( currentPiece != emptyPiece )
-               {
-                  if( (currentPiece.IsX() && aiIsX) || (!(currentPiece.IsX()) && !aiIsX) )
-                     score += 1;
-                  else
-                     score -= 1;
-               }
-            }
-         }
+         // Weighted sum of the board's features, measured from the AI's point of view
+         // (with the default weights this is +1 for each of the AI's pieces & -1 for each of the opponent's pieces)
+         int features[NUM_EVAL_FEATURES];
+         src_board.GetEvalFeatures(aiIsX, features);
+         score = evalWeights.Score(features);
       }
       // If the AI personality type is generous, then invert the score, so that the AI makes the worst possible move...
       if( aiPersonality == GENEROUS )
          score = -score;
 
+      SEARCH_STATS( stats.leaves++; )
       return score;
    }
    // The src_board has some moves available & we have not reached the final depth
    else
    {
-      // - If any aggressive moves exist, then the options to explore are only the aggressive moves
-      // - Else only passive moves exist, so the options to explore are only the passive moves
-      // - Now create a vector of scores, the size of which is equal to the number of options that are to be explored
-      unsigned int numMoves = 0;
-      // If we're in a multi-turn sequence then the piece to move is fixed & the possible destination squares are in executionSquareMoves
-      if( src_board.multiTurnSequence )
-      {
-         numMoves = src_board.executionSquareMoves.aggressiveMoves.size();
-      }
-      else if( src_board.currentSideHasAggressiveMoves )
-      {
-         for( unsigned int piece = 0 ; piece < src_board.currentTurnAllMoves.size() ; piece++ )
-            numMoves += src_board.currentTurnAllMoves[piece].aggressiveMoves.size();
-      }
-      else
+      // If this board has already been searched to this depth (by this search, an earlier one, or pondering), then
+      //   the score is already known
+      const unsigned long long key = src_board.Hash() ^ SearchKey();
+      int treeScore = 0;
+      SEARCH_STATS( stats.ttProbes++; )
+      if( transpositionTable.Probe(key, depth, treeScore) )
       {
-         for( unsigned int piece = 0 ; piece < src_board.currentTurnAllMoves.size() ; piece++ )
-            numMoves += src_board.currentTurnAllMoves[piece].passiveMoves.size();
-      }
-      //std::vector<int> scores(numMoves);
-      // - Create a vector of CBoards of the same size (one for each move, each of which is a copy of this CBoard), and set
-      //     the executionSquare to the piece that is to be moved and the selectedSquare to the move that is to be made
-      std::vector<CBoard> boards(numMoves, src_board);
-      if( src_board.multiTurnSequence )
-      {
-         // Multi-turn sequence means that the piece to move is already selected & only the square to move to needs to be set
-         unsigned int boardIndex = 0;
-         for( unsigned int move = 0 ; move < src_board.executionSquareMoves.aggressiveMoves.size() ; move++ )
-         {
-            boards[boardIndex].selectedSquare = src_board.executionSquareMoves.aggressiveMoves[move];
-            boardIndex++;
-         }
-      }
-      else if( src_board.currentSideHasAggressiveMoves )
-      {
-         unsigned int boardIndex = 0;
-         for( unsigned int piece = 0 ; piece < src_board.currentTurnAllMoves.size() ; piece++ )
-            for( unsigned int move = 0 ; move < src_board.currentTurnAllMoves[piece].aggressiveMoves.size() ; move++ )
-            {
-               boards[boardIndex].selectedSquare = src_board.currentTurnAllMoves[piece].pieceLocation;
-               boards[boardIndex].ExecuteSelectedSquare();
-               boards[boardIndex].selectedSquare = src_board.currentTurnAllMoves[piece].aggressiveMoves[move];
-               boardIndex++;
-            }
-      }
-      else
-      {
-         unsigned int boardIndex = 0;
-         for( unsigned int piece = 0 ; piece < src_board.currentTurnAllMoves.size() ; piece++ )
-            for( unsigned int move = 0 ; move < src_board.currentTurnAllMoves[piece].passiveMoves.size() ; move++ )
-            {
-               boards[boardIndex].selectedSquare = src_board.currentTurnAllMoves[piece].pieceLocation;
-               boards[boardIndex].ExecuteSelectedSquare();
-               boards[boardIndex].selectedSquare = src_board.currentTurnAllMoves[piece].passiveMoves[move];
-               boardIndex++;
-            }
+         SEARCH_STATS( stats.ttHits++;
+                       stats.cutoffs++; )
+         return treeScore;
       }
+
+      // - List the options to explore: in a multi-turn sequence only the further jumps of the moving piece, otherwise
+      //     the aggressive moves if any exist, else the passive moves
+      // - Each option's move is made on the thread's board for the next ply (see GetMoveScore)
+      CMove moves[MAX_MOVES];
+      const unsigned int numMoves = src_board.ListLegalMoves(moves);
       
-      // - For each option, pass the CBoard into the GetTreeScore function, and assign the function's return value to the 
+      // - For each option, pass the move into the GetMoveScore function, and assign the function's return value to the 
       //     relevant score vector entry
       
       // Evaluate the board & come up with a score based on the AI's personality type: MODERATE, GENEROUS, AGGRESSIVE, CAUTIOUS
@@ -647,32 +1030,31 @@ CBoard::GetTreeScore( CBoard src_board , int depth )
          int minScore = 1024;
          for( unsigned int option = 0 ; option < numMoves ; option++ )
          {
-            int score = GetTreeScore( boards[option] , depth );
+            int score = GetMoveScore( src_board , moves[option] , depth , ply+1 );
             if( score > minScore )
                minScore = score;
          }
          // - Return the lowest score (it does not matter which move it came from)
-         return minScore;
+         treeScore = minScore;
       }
       else if( aiPersonality == AGGRESSIVE )
       {
          // Return the sum of the scores (i.e. overall quality of this path)
          int sumOfScores = 0;
          for( unsigned int option = 0 ; option < numMoves ; option++ )
-            sumOfScores += GetTreeScore( boards[option] , depth );
+            sumOfScores += GetMoveScore( src_board , moves[option] , depth , ply+1 );
    
-         return sumOfScores; //sumOfScores/numMoves;
+         treeScore = sumOfScores; //sumOfScores/numMoves;
       }
       else //if( aiPersonality == MODERATE ) // || (aiPersonality == GENEROUS)
       {
-         int maxScore = -1024;
+         int maxScore = std::numeric_limits<int>::min();
          for( unsigned int option = 0 ; option < numMoves ; option++ )
          {
 #ifdef _DEBUG
             std::cout << "(GetTreeScore, depth " << depth << ") evaluating option " << option << std::endl;
-            boards[option].Draw();
 #endif
-            int score = GetTreeScore( boards[option] , depth );
+            int score = GetMoveScore( src_board , moves[option] , depth , ply+1 );
 #ifdef _DEBUG
             std::cout << " ^^ score = " << score << std::endl;
 #endif
@@ -680,8 +1062,13 @@ CBoard::GetTreeScore( CBoard src_board , int depth )
                maxScore = score;
          }
          // - Return the highest score (it does not matter which move it came from)
-         return maxScore;
+         treeScore = maxScore;
       }
+
+      // The score of a search that was cut short is not complete, so it must not be reused
+      if( !SearchAborted() )
+         transpositionTable.Store(key, depth, treeScore);
+      return treeScore;
    }
    
    // src_board will have the executionSquare and selectedSquare already set
@@ -704,5 +1091,446 @@ CBoard::GetTreeScore( CBoard src_board , int depth )
 }
 
 
+// --------------------------------------------------------------------------- //
+// Function to set the whole board from a position string
+// --------------------------------------------------------------------------- //
+
+bool
+CBoard::SetPosition(const std::string &position)
+{
+   std::vector<CPiece> pieces;
+   pieces.reserve(width*height);
+
+   // Read the squares (skipping any row separators) until the space before the side to move
+   std::string::size_type index = 0;
+   for( ; (index < position.size()) && (position[index] != ' ') ; index++ )
+   {
+      CPiece piece;
+      switch( position[index] )
+      {
+         case 'x': piece.SetSideX(); piece.SetTypeMan();  break;
+         case 'X': piece.SetSideX(); piece.SetTypeKing(); break;
+         case 'o': piece.SetSideO(); piece.SetTypeMan();  break;
+         case 'O': piece.SetSideO(); piece.SetTypeKing(); break;
+         case '.': break;
+         case '/': continue;
+         default: return false;
+      }
+      pieces.push_back(piece);
+   }
+   if( (pieces.size() != width*height) || (index+1 >= position.size()) )
+      return false;
+
+   const char sideToMove = position[index+1];
+   if( (sideToMove != 'x') && (sideToMove != 'o') )
+      return false;
+
+   // Neither side can have more pieces than it starts with (there is room for the moves of that many pieces)
+   unsigned int numX = 0, numO = 0;
+   for( unsigned int piece = 0 ; piece < pieces.size() ; piece++ )
+      if( pieces[piece] != emptyPiece )
+         (pieces[piece].IsX() ? numX : numO)++;
+   if( (numX > maxPieces) || (numO > maxPieces) )
+      return false;
+
+   for( unsigned int y = 0 ; y < height ; y++ )
+      for( unsigned int x = 0 ; x < width ; x++ )
+         GetSquare(x,y).GetPiece() = pieces[(y*width) + x];
+
+   // Reset the selection & move state in the same way as ResetBoard
+   SelectSquare(width/2, height/2);
+   executionSquare.x = -1;
+   executionSquare.y = -1;
+   ResetMoves();
+   multiTurnSequence = false;
+   isXTurn = (sideToMove == 'x');
+   changedSquares[0] = changedSquares[1] = ALL_SQUARES;
+   CalculateAllMoves();
+
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the whole board as a position string (in the format read by SetPosition)
+// --------------------------------------------------------------------------- //
+
+std::string
+CBoard::GetPosition() const
+{
+   std::string position;
+   position.reserve((width+1)*height + 2);
+
+   for( unsigned int y = 0 ; y < height ; y++ )
+   {
+      if( y > 0 )
+         position += '/';
+      for( unsigned int x = 0 ; x < width ; x++ )
+      {
+         const CPiece &piece = squares[(y*width) + x].GetPiece();
+         if( piece == emptyPiece )
+            position += '.';
+         else if( piece.IsMan() )
+            position += (piece.IsX()?'x':'o');
+         else
+            position += (piece.IsX()?'X':'O');
+      }
+   }
+   position += ' ';
+   position += (isXTurn?'x':'o');
+
+   return position;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to measure the evaluation features of the board from one side's point of view
+// --------------------------------------------------------------------------- //
+
+void
+CBoard::GetEvalFeatures(const bool forX, int features[NUM_EVAL_FEATURES]) const
+{
+   for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+      features[feature] = 0;
+
+   for(unsigned int y = 0 ; y < height ; y++)
+   {
+      for(unsigned int x = 0 ; x < width ; x++)
+      {
+         const CPiece &currentPiece = squares[(y*width) + x].GetPiece();
+         if( currentPiece == emptyPiece )
+            continue;
+
+         // +1 for the side being evaluated, -1 for the other side
+         const int sign = ( (currentPiece.IsX() == forX) ? 1 : -1 );
+         // Number of rows from the piece's own back row (x starts at y=0, o starts at y=height-1)
+         const unsigned int rowsAdvanced = ( currentPiece.IsX() ? y : (height-1-y) );
+
+         if( currentPiece.IsMan() )
+         {
+            features[EVAL_MEN] += sign;
+            features[EVAL_ADVANCEMENT] += sign*int(rowsAdvanced);
+            if( rowsAdvanced == 0 )
+               features[EVAL_BACK_ROW] += sign;
+         }
+         else
+         {
+            features[EVAL_KINGS] += sign;
+         }
+
+         if( (x >= width/2-2) && (x < width/2+2) && (y >= height/2-1) && (y < height/2+1) )
+            features[EVAL_CENTRE] += sign;
+         if( (x == 0) || (x == width-1) )
+            features[EVAL_EDGE] += sign;
+      }
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to switch the AI to the Monte Carlo personality
+// --------------------------------------------------------------------------- //
+
+void
+CBoard::SetAIMonteCarlo(const unsigned int playouts, const int maxTimeMs, const unsigned int threads,
+                        const int rollout, const int selection)
+{
+   aiPersonality = MONTE_CARLO;
+   mctsPlayouts = playouts;
+   mctsMaxTimeMs = maxTimeMs;
+   if( !mctsEngine )
+      mctsEngine = std::make_shared<CMctsEngine>();
+   // (hardware_concurrency gives 0 if it cannot tell, which the engine takes as 1 thread)
+   mctsEngine->SetThreads( threads > 0 ? threads : std::thread::hardware_concurrency() );
+   mctsEngine->SetRollout( rollout >= 0 ? rollout : int(CMctsEngine::LIGHT_ROLLOUT) );
+   mctsEngine->SetSelection( selection >= 0 ? selection : int(CMctsEngine::UCT) );
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to list the moves that are currently allowed
+//   - In a multi-turn sequence only the further jumps of the moving piece are allowed
+//   - Otherwise, if any aggressive moves exist then only the aggressive moves are allowed, else the passive moves
+// --------------------------------------------------------------------------- //
+
+void
+CBoard::GetLegalMoves(std::vector<CMove> &moves) const
+{
+   CMove legalMoves[MAX_MOVES];
+   moves.assign( legalMoves, legalMoves + ListLegalMoves(legalMoves) );
+}
+
+unsigned int
+CBoard::ListLegalMoves(CMove moves[MAX_MOVES]) const
+{
+   unsigned int numMoves = 0;
+
+   if( multiTurnSequence )
+   {
+      for( unsigned int move = 0 ; move < executionSquareMoves.aggressiveMoves.size() ; move++ )
+         moves[numMoves++] = CMove( executionSquare.x, executionSquare.y,
+                                    executionSquareMoves.aggressiveMoves[move].x, executionSquareMoves.aggressiveMoves[move].y );
+      return numMoves;
+   }
+
+   for( unsigned int piece = 0 ; piece < CurrentTurnAllMoves().size() ; piece++ )
+   {
+      const CMoveContainer &pieceMoves = CurrentTurnAllMoves()[piece];
+      const CSquareList &destinations = ( currentSideHasAggressiveMoves ? pieceMoves.aggressiveMoves : pieceMoves.passiveMoves );
+      for( unsigned int move = 0 ; move < destinations.size() ; move++ )
+         moves[numMoves++] = CMove( pieceMoves.pieceLocation.x, pieceMoves.pieceLocation.y, destinations[move].x, destinations[move].y );
+   }
+   return numMoves;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to make a move
+// --------------------------------------------------------------------------- //
+
+bool
+CBoard::MakeMove(const CMove &move)
+{
+   // Queue the piece to move (unless it is already queued because we are in a multi-turn sequence)
+   if( !multiTurnSequence )
+   {
+      if( executionSquare != CSquareLocation(move.fromX, move.fromY) )
+      {
+         selectedSquare = CSquareLocation(move.fromX, move.fromY);
+         if( ExecuteSelectedSquare() != 0 )
+            return false;
+      }
+   }
+   else if( executionSquare != CSquareLocation(move.fromX, move.fromY) )
+   {
+      return false;
+   }
+
+   // Move the queued piece to the destination square
+   selectedSquare = CSquareLocation(move.toX, move.toY);
+   return ExecuteSelectedSquare() == 0;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to queue a move, ready for ExecuteSelectedSquare to be called
+// --------------------------------------------------------------------------- //
+
+void
+CBoard::QueueMove(const CMove &move)
+{
+   // Only need to select the piece to move if we are not in a multi-turn sequence
+   if( !multiTurnSequence )
+   {
+      selectedSquare = CSquareLocation(move.fromX, move.fromY);
+      ExecuteSelectedSquare();
+   }
+   selectedSquare = CSquareLocation(move.toX, move.toY);
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to get a (Zobrist) hash of the position
+// --------------------------------------------------------------------------- //
+
+namespace
+{
+   // Random keys for each (square, piece) combination, for the side to move & for the square of a piece that is part way
+   //   through a multi-turn sequence. The keys are fixed so that hashes are the same in every run of the program.
+   struct CZobristKeys
+   {
+      static const unsigned int MAX_SQUARES = 256;
+
+      CZobristKeys()
+      {
+         unsigned long long state = 0x9E3779B97F4A7C15ULL;
+         for( unsigned int square = 0 ; square < MAX_SQUARES ; square++ )
+         {
+            for( unsigned int piece = 0 ; piece < 4 ; piece++ )
+               pieceKeys[square][piece] = Next(state);
+            multiTurnKeys[square] = Next(state);
+         }
+         xTurnKey = Next(state);
+      }
+
+      // splitmix64 generator
+      static unsigned long long Next(unsigned long long &state)
+      {
+         unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+         z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+         z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+         return z ^ (z >> 31);
+      }
+
+      unsigned long long pieceKeys[MAX_SQUARES][4];
+      unsigned long long multiTurnKeys[MAX_SQUARES];
+      unsigned long long xTurnKey;
+   };
+
+   const CZobristKeys &ZobristKeys()
+   {
+      static const CZobristKeys keys;
+      return keys;
+   }
+}
+
+unsigned long long
+CBoard::Hash(const bool mirrored) const
+{
+   const CZobristKeys &keys = ZobristKeys();
+
+   unsigned long long hash = ( isXTurn ? keys.xTurnKey : 0 );
+   for( unsigned int square = 0 ; (square < width*height) && (square < CZobristKeys::MAX_SQUARES) ; square++ )
+   {
+      const CPiece &piece = squares[square].GetPiece();
+      // The mirror image has the piece on the square at the other end of the same row
+      const unsigned int keySquare = ( mirrored ? square - square%width + (width-1 - square%width) : square );
+      if( (piece != emptyPiece) && (keySquare < CZobristKeys::MAX_SQUARES) )
+         hash ^= keys.pieceKeys[keySquare][ (piece.IsX()?0:2) + (piece.IsMan()?0:1) ];
+   }
+   if( multiTurnSequence )
+   {
+      const int keyX = ( mirrored ? int(width)-1 - executionSquare.x : executionSquare.x );
+      hash ^= keys.multiTurnKeys[ (executionSquare.y*width + keyX) % CZobristKeys::MAX_SQUARES ];
+   }
+
+   return hash;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the part of the transposition table key that depends on the search rather than the position
+//   (the scores are from the AI's point of view & depend on its personality, & the board size changes the square indices)
+// --------------------------------------------------------------------------- //
+
+unsigned long long
+CBoard::SearchKey() const
+{
+   unsigned long long state = ( (unsigned long long)(width) << 40 ) ^ ( (unsigned long long)(height) << 24 ) ^
+                              ( (unsigned long long)(aiPersonality) << 1 ) ^ ( aiIsX ? 1ULL : 0ULL );
+   return CZobristKeys::Next(state);
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the board as a tablebase position
+//   - The tablebase is for the layout where Layout() is true, so the other layout is looked up as its mirror image
+//   - The tablebase always has X to move, so with O to move the position is looked up with the sides swapped
+// --------------------------------------------------------------------------- //
+
+bool
+CBoard::GetTablebasePosition(const unsigned int maxPieces, CTbPosition &position) const
+{
+   if( (width != 8) || (height != 8) || multiTurnSequence )
+      return false;
+
+   position = CTbPosition();
+   unsigned int numPieces = 0;
+   for( unsigned int y = 0 ; y < height ; y++ )
+      for( unsigned int x = 0 ; x < width ; x++ )
+      {
+         const CPiece &piece = squares[y*width + x].GetPiece();
+         if( piece == emptyPiece )
+            continue;
+         const unsigned int tablebaseX = ( boardLayout ? x : width-1 - x );
+         // Too many pieces, or a piece that cannot be in the tablebase (off the playable squares, or a man on the row
+         //   that crowns it - e.g. in a position string that was set up by hand)
+         if( (++numPieces > maxPieces) || (((tablebaseX + y) & 1) == 0) ||
+             (piece.IsMan() && (y == (piece.IsX() ? height-1 : 0))) )
+            return false;
+         const unsigned int bit = 1u << (y*4 + tablebaseX/2);
+         if( piece.IsX() )
+            ( piece.IsMan() ? position.xMen : position.xKings ) |= bit;
+         else
+            ( piece.IsMan() ? position.oMen : position.oKings ) |= bit;
+      }
+
+   if( !isXTurn )
+      position = position.Flip();
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions to load the endgame tablebase, & to look up the board in it & in the built-in bitbase
+// --------------------------------------------------------------------------- //
+
+bool
+CBoard::LoadTablebase(const std::string &filename)
+{
+   transpositionTable.Clear();
+   return tablebase.Open(filename);
+}
+
+bool
+CBoard::ProbeTablebase(unsigned char &value) const
+{
+   CTbPosition position;
+   return tablebase.IsOpen() && GetTablebasePosition(tablebase.MaxPieces(), position) && tablebase.Probe(position, value);
+}
+
+bool
+CBoard::ProbeBitbase(int &result) const
+{
+#ifdef DRAUGHTS_BITBASE
+   CTbPosition position;
+   return GetTablebasePosition(BITBASE_MAX_PIECES, position) && BitbaseProbe(position, result);
+#else
+   (void)(result);
+   return false;
+#endif
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions to load the opening book, & to pick a move from it
+//   - The book is for the layout where Layout() is true, so the other layout is looked up as its mirror image
+//   - Each of the position's moves is picked with a chance in proportion to its weight, so the AI does not always
+//     play the same opening
+// --------------------------------------------------------------------------- //
+
+bool
+CBoard::LoadOpeningBook(const std::string &filename)
+{
+   return openingBook.Open(filename);
+}
 
+bool
+CBoard::GetBookMove(CMove &move)
+{
+   if( !openingBook.IsOpen() || (openingBook.Width() != width) || (openingBook.Height() != height) )
+      return false;
 
+   std::vector<CBookEntry> entries;
+   if( openingBook.Find(Hash(!boardLayout), entries) == 0 )
+      return false;
+
+   // Only the moves that are allowed are used (in case another position has the same hash)
+   std::vector<CMove> legalMoves;
+   GetLegalMoves(legalMoves);
+   std::vector<CMove> bookMoves;
+   std::vector<unsigned int> weights;
+   unsigned long long totalWeight = 0;
+   for( unsigned int entry = 0 ; entry < entries.size() ; entry++ )
+   {
+      const int fromX = ( boardLayout ? entries[entry].fromX : int(width)-1 - entries[entry].fromX );
+      const int toX   = ( boardLayout ? entries[entry].toX   : int(width)-1 - entries[entry].toX );
+      const CMove bookMove(fromX, entries[entry].fromY, toX, entries[entry].toY);
+      if( (entries[entry].weight > 0) && (std::find(legalMoves.begin(), legalMoves.end(), bookMove) != legalMoves.end()) )
+      {
+         bookMoves.push_back(bookMove);
+         weights.push_back(entries[entry].weight);
+         totalWeight += entries[entry].weight;
+      }
+   }
+   if( totalWeight == 0 )
+      return false;
+
+   // Pick a point in the total weight, & play the move whose share of the weight it falls in
+   unsigned long long pick = CRandomRS::Thread().Below(totalWeight);
+   unsigned int choice = 0;
+   while( (choice+1 < bookMoves.size()) && (pick >= weights[choice]) )
+      pick -= weights[choice++];
+   move = bookMoves[choice];
+   return true;
+}
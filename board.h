@@ -4,17 +4,80 @@
 #define _BOARD_H
 
 #include <vector>
+#include <string>
+#include <utility>   // std::pair
+#include <memory>    // std::shared_ptr
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <mutex>
 
-#include "randomrs.h"
 #include "piece.h"
+#include "geometry.h"
+#include "evaluation.h"
+#include "transposition.h"
+#include "searchstats.h"
+
+// (the tablebase & the opening book are only declared here, so that the users of the board do not include the platform
+//   headers for mapping their files)
+class CTbPosition;
+class CTablebase;
+class COpeningBook;
+class CMctsEngine;
+class CAIHandle;
+class CPonderState;
+
+
+// Limits on how long the AI can search for
+class CSearchLimits
+{
+   public:
+      CSearchLimits(const int _depth = 5, const int _maxTimeMs = 0) : depth(_depth), maxTimeMs(_maxTimeMs) {}
+
+      int depth;       // Depth of the search tree
+      int maxTimeMs;   // Time limit in milliseconds (0 = no time limit)
+};
 
 
 // Class for describing & controlling the board
 class CBoard
 {
    public:
+      // Simple class to describe a single move of a piece from one square to another
+      // (each jump of a multi-jump sequence is a separate move)
+      class CMove
+      {
+         public:
+            CMove() : CMove(-1,-1,-1,-1) {}
+            CMove(const int _fromX, const int _fromY, const int _toX, const int _toY)
+             : fromX(_fromX), fromY(_fromY), toX(_toX), toY(_toY) {}
+
+            bool operator==(const CMove &rhs) const
+            {
+               return (fromX == rhs.fromX) && (fromY == rhs.fromY) && (toX == rhs.toX) && (toY == rhs.toY);
+            }
+            bool operator!=(const CMove &rhs) const { return !(*this == rhs); }
+
+            // A default-constructed move is not valid (e.g. the result of an AI search that found no moves)
+            bool IsValid() const { return fromX >= 0; }
+
+            int fromX;
+            int fromY;
+            int toX;
+            int toY;
+      };
+
+      // Board variants: the standard 8x8 board with 12 pieces per side, & smaller boards with fewer pieces (which are
+      //   small enough to be solved exactly - see varsolve.cpp)
+      //   - Each side starts with its men on the playable squares of the rows at its end of the board, leaving 2 empty rows
+      //     in the middle (3 on the 7x7 board)
+      enum Variants { VARIANT_8X8, VARIANT_7X7, VARIANT_6X6 };
+      static unsigned int VariantSize(const Variants variant) { return ( variant == VARIANT_6X6 ? 6 : variant == VARIANT_7X7 ? 7 : 8 ); }
+      static unsigned int VariantPieces(const Variants variant) { return ( variant == VARIANT_6X6 ? 6 : variant == VARIANT_7X7 ? 7 : 12 ); }
+
       // Constructors
       CBoard() : CBoard(8, 8, 12) {}
+      explicit CBoard(const Variants variant) : CBoard(VariantSize(variant), VariantSize(variant), VariantPieces(variant)) {}
       
       // Member Functions
       void ResetBoard(const bool _IsXTurn);
@@ -35,6 +98,19 @@ class CBoard
       
       // Function to invoke the AI to take a relevant action (returns a success bool in case the AI fails for some reason)
       bool InvokeAI( int depth );
+
+      // Function to start the AI searching for a move on its own thread, so that the caller is not blocked
+      //   - The returned handle can be polled, stopped, & waited on for the move (pass the move to QueueMove to use it)
+      //   - The search works on a copy of this board, so this board is free to be used (e.g. drawn) during the search
+      CAIHandle StartAI(const CSearchLimits &limits) const;
+
+      // Function to start the AI thinking on the opponent's time ("pondering") while it is the opponent's turn
+      //   - Each of the opponent's possible replies is searched in turn, one depth at a time up to the depth limit, so the
+      //     time is split between the replies & their scores are kept in the transposition table (the Monte Carlo
+      //     personality instead grows its tree from this board, ready to be reused)
+      //   - Once the opponent has moved, pass the new board to the handle's OpponentMoved function: the pondering then
+      //     becomes the search for the AI's move on that board, reusing everything that has been worked out so far
+      CAIHandle StartPonder(const CSearchLimits &limits) const;
       
       // Functions to query whose turn it is & the force a turnover (which results in a reset of the board)
       bool IsXTurn() const { return isXTurn; }
@@ -47,6 +123,12 @@ class CBoard
       void SetAIGenerous()   { aiPersonality = GENEROUS; }
       void SetAIAggressive() { aiPersonality = AGGRESSIVE; }
       void SetAICautious()   { aiPersonality = CAUTIOUS; }
+      // The Monte Carlo personality searches with a fixed budget of random playouts (and optionally a time limit in ms)
+      // rather than a fixed depth, so the "depth" argument of InvokeAI is ignored for it
+      //   - threads = the number of threads that search the tree together (0 = one for each of the processor's threads)
+      //   - rollout & selection are a CMctsEngine::RolloutTypes & SelectionTypes (-1 = the engine's default, LIGHT_ROLLOUT & UCT)
+      void SetAIMonteCarlo(const unsigned int playouts, const int maxTimeMs = 0, const unsigned int threads = 0,
+                           const int rollout = -1, const int selection = -1);
       
       // Functions to get information about the piece at a given square location (GetSquare will handle x or y being out of bounds)
       bool SquareIsEmpty(unsigned int x, unsigned int y)
@@ -73,6 +155,70 @@ class CBoard
       int SelectedY() const { return selectedSquare.y; }
       int QueuedX() const { return executionSquare.x; }
       int QueuedY() const { return executionSquare.y; }
+      bool InMultiTurnSequence() const { return multiTurnSequence; }
+
+      // Function to list the moves that are currently allowed (the same moves, in the same order, that the AI chooses from)
+      void GetLegalMoves(std::vector<CMove> &moves) const;
+      // Function for the AI to score each of the moves that are currently allowed (in the same order as GetLegalMoves),
+      //   from the point of view of the side to move, in the same way as InvokeAI does before it picks the best one
+      //   - With a time limit, the scores are from the deepest search that finished (returns false if there are no moves
+      //     or even the depth 0 search did not finish). The Monte Carlo personality scores with the tree search instead
+      bool ScoreMoves(const CSearchLimits &limits, std::vector<CMove> &moves, std::vector<int> &scores);
+      // Function to get the number of boards that the last tree search from this board (ScoreMoves or InvokeAI) scored
+      unsigned long long SearchNodes() const { return searchNodes; }
+      // Function to get the statistics of the last search for a move (InvokeAI or ScoreMoves) that was run on the calling
+      //   thread (for a search started by StartAI or StartPonder, use the handle's Stats instead)
+      static const CSearchStats &LastSearchStats();
+      // Function to list the memory that the AI uses (the name & bytes of each item): the size of a board & of the parts
+      //   of it that are copied with it, the size of the search's structures, & the memory taken by the transposition
+      //   table & the calling thread's boards for the plies of the tree search
+      static void GetMemoryFootprint(std::vector< std::pair<std::string, unsigned long long> > &footprint);
+      // Function to make a move (returns false if the move is not allowed, in which case no piece is moved)
+      bool MakeMove(const CMove &move);
+      // Function to queue a move in the same way as InvokeAI (the piece is queued & the destination selected, ready
+      //   for ExecuteSelectedSquare to be called)
+      void QueueMove(const CMove &move);
+
+      // Function to get a hash of the position (pieces, side to move & any multi-turn sequence in progress)
+      //   - mirrored = the hash of the board's mirror image in x (i.e. the same position in the other layout)
+      unsigned long long Hash(const bool mirrored = false) const;
+
+      // Functions to set/get the whole board as a position string:
+      //   one character per square ('x'/'o' = man, 'X'/'O' = king, '.' = empty), row by row starting at y=0,
+      //   with optional '/' separators between the rows, followed by a space & the side to move ('x' or 'o')
+      // SetPosition returns false (& leaves the board unchanged) if the string is not valid for this board
+      bool SetPosition(const std::string &position);
+      std::string GetPosition() const;
+
+      // Function to measure each of the evaluation features of the board, from the point of view of one side
+      void GetEvalFeatures(const bool forX, int features[NUM_EVAL_FEATURES]) const;
+
+      // Functions to set/get the evaluation weights that the AI uses to score a board (shared by all boards)
+      //   (the transposition table is cleared, as the scores in it were worked out with the old weights)
+      static void SetEvalWeights(const CEvalWeights &weights) { evalWeights = weights; transpositionTable.Clear(); }
+      static const CEvalWeights &GetEvalWeights() { return evalWeights; }
+      static bool LoadEvalWeights(const std::string &filename) { transpositionTable.Clear(); return evalWeights.Load(filename); }
+
+      // Functions to size/clear the transposition table that the AI's tree search keeps its scores in (shared by all boards)
+      //   - The table is kept between searches, so that later searches (& pondering) can reuse the scores
+      //   - No search may be running while the table is resized or cleared
+      static void SetTranspositionTableSize(const unsigned int numEntries) { transpositionTable.Resize(numEntries); }
+      static void ClearTranspositionTable() { transpositionTable.Clear(); }
+
+      // Function to load the endgame tablebase (written by the tbgen program) that the AI's tree search probes (shared by
+      //   all boards) - returns false if the file is not a tablebase. No search may be running while it is loaded
+      static bool LoadTablebase(const std::string &filename);
+      // Function to look up the board in the endgame tablebase: returns false if the board is not in it (too many pieces,
+      //   not 8x8, or a multi-turn sequence in progress), otherwise the value (see TbValue) for the side to move
+      bool ProbeTablebase(unsigned char &value) const;
+      // Function to look up the board in the bitbase that is built into the program when it is compiled with
+      //   -DDRAUGHTS_BITBASE (see bitbase.h): returns false if the board is not in it (or there is no built-in bitbase),
+      //   otherwise result = 1 if the side to move wins, -1 if it loses or 0 if neither side can force a win
+      bool ProbeBitbase(int &result) const;
+
+      // Function to load the opening book that the AI plays its moves from while the position is in it (shared by all
+      //   boards) - returns false if the file is not an opening book. No search may be running while it is loaded
+      static bool LoadOpeningBook(const std::string &filename);
 
 
    private:
@@ -88,6 +234,7 @@ class CBoard
             CSquare(CPiece &piece) : currentPiece(piece) {}
 
             CPiece &GetPiece() { return currentPiece; }
+            const CPiece &GetPiece() const { return currentPiece; }
 
          private:
 
@@ -115,17 +262,37 @@ class CBoard
             int y;
       };
 
+      // Class for holding a list of up to 4 squares (a piece has at most 4 moves of each kind), with the parts of the
+      //   std::vector interface that the move lists use - the squares are stored in the list itself, so the move lists
+      //   are copied with the board without allocating any memory
+      class CSquareList
+      {
+         public:
+            typedef CSquareLocation *iterator;
+            typedef const CSquareLocation *const_iterator;
+
+            CSquareList() : count(0) {}
+
+            void push_back(const CSquareLocation &location) { locations[count++] = location; }
+            void clear() { count = 0; }
+            unsigned int size() const { return count; }
+            bool empty() const { return count == 0; }
+
+            iterator begin() { return locations; }
+            iterator end() { return locations + count; }
+            const_iterator begin() const { return locations; }
+            const_iterator end() const { return locations + count; }
+            const CSquareLocation &operator[](const unsigned int index) const { return locations[index]; }
+
+         private:
+            CSquareLocation locations[4];
+            unsigned int count;
+      };
+
       // Class for holding a list of passive moves, a list of aggressive moves, & the location of the moving piece
       class CMoveContainer
       {
          public:
-            CMoveContainer()
-            {
-               // Reserve space for the passiveMoves & aggressiveMoves vectors (max = 4 moves for each)
-               passiveMoves.reserve(4);
-               aggressiveMoves.reserve(4);
-            }
-
             void Clear()
             {
                //pieceLocation.x = pieceLocation.y = -1;
@@ -134,8 +301,39 @@ class CBoard
             }
 
             CSquareLocation pieceLocation;
-            std::vector<CSquareLocation> passiveMoves;
-            std::vector<CSquareLocation> aggressiveMoves;
+            CSquareList passiveMoves;
+            CSquareList aggressiveMoves;
+      };
+
+      // Largest board & number of pieces per side of any variant, & the most moves that a side can have (4 per piece)
+      static const unsigned int MAX_SQUARES = 64;
+      static const unsigned int MAX_PIECES = 12;
+      static const unsigned int MAX_MOVES = MAX_PIECES*4;
+
+      // Class for holding a side's table of moves (one CMoveContainer for each of up to MAX_PIECES pieces), with the parts
+      //   of the std::vector interface that the tables use - like CSquareList, the table is copied with the board without
+      //   allocating any memory
+      class CMoveTable
+      {
+         public:
+            typedef CMoveContainer *iterator;
+            typedef const CMoveContainer *const_iterator;
+
+            CMoveTable() : count(0) {}
+
+            void resize(const unsigned int size) { count = size; }
+            unsigned int size() const { return count; }
+
+            iterator begin() { return containers; }
+            iterator end() { return containers + count; }
+            const_iterator begin() const { return containers; }
+            const_iterator end() const { return containers + count; }
+            CMoveContainer &operator[](const unsigned int index) { return containers[index]; }
+            const CMoveContainer &operator[](const unsigned int index) const { return containers[index]; }
+
+         private:
+            CMoveContainer containers[MAX_PIECES];
+            unsigned int count;
       };
 
 
@@ -144,18 +342,27 @@ class CBoard
       // --------------------------------------------------------
       // CBoard private data and functions
       // --------------------------------------------------------
-      // For now, this constructor is private so that you can only have a 8x8 board with 12 pieces on each side
+      // The microbenchmarks (see microbench.cpp) time the private parts of the board directly
+      friend class CMicrobench;
+      // The Monte Carlo engine keeps a copy of the board without its pointer to the engine (see CMctsEngine::Search)
+      friend class CMctsEngine;
+
+      // This constructor is private so that only the supported variants can be made (maxPieces = the number of pieces
+      //   that each side starts with)
       CBoard(unsigned int _width,
              unsigned int _height,
              unsigned int _maxPieces)
        : width(_width), height(_height),
          maxPieces(_maxPieces),
          boardLayout(1),
-         squares(_width*_height),
-         currentTurnAllMoves(_maxPieces),
-         aiPersonality(MODERATE)
+         squareLinks(SquareLinks(_width)),
+         aiPersonality(MODERATE),
+         mctsPlayouts(0), mctsMaxTimeMs(0),
+         searchStop(0), searchHasDeadline(false), searchNodes(0), searchAborted(false)
       {
          emptySquare.GetPiece() = emptyPiece;
+         sideMoves[0].resize(_maxPieces);
+         sideMoves[1].resize(_maxPieces);
          ResetBoard(false);
       }
 
@@ -164,10 +371,20 @@ class CBoard
       unsigned int maxPieces;
       bool boardLayout;
 
+      // The pieces stand on the squares where (x+y) is odd when boardLayout is true, & on their mirror images in x otherwise
+      bool IsPlayableSquare(const unsigned int x, const unsigned int y) const
+      {
+         return ( ((boardLayout ? x : width-1-x) + y) & 1 ) == 1;
+      }
+
       /*const */CPiece emptyPiece;   // default constructor will make this as an empty piece (type = NONE)
       
-      std::vector<CSquare> squares;
+      CSquare squares[MAX_SQUARES];   // The first width*height are used
       CSquare emptySquare; // Used for out-of-bounds access attempt of GetSquare
+
+      // The neighbour & jump squares of each square (see CGridLinks), in the same order as squares
+      const CSquareLinks *squareLinks;
+      static const CSquareLinks *SquareLinks(const unsigned int size);
       
       CSquare &GetSquare(unsigned int x, unsigned int y)
       {
@@ -197,17 +414,42 @@ class CBoard
       void ResetMoves() { executionSquareMoves.Clear(); }
       // Function to populate the list of moves for the currently-selected piece
       void PopulateMoves(const CPiece &currentPiece, const bool populatePassive, CMoveContainer &moves);
+      // Function to add the move (if any) of the piece in one direction, using the square links (the direction's neighbouring
+      //   square must be on the board)
+      void PopulateDirection(const CPiece &currentPiece, const bool populatePassive, const CSquareLinks &links,
+                             const unsigned int direction, CMoveContainer &moves);
       // Indicates whether a multi-turn sequence is in action (i.e. an aggressive move has been made & further aggressive moves are available)
       bool multiTurnSequence;
       
       // Function to cancel a multi-turn sequence (reset execution square, reset moves lists, turnover, set mutliTurnSequence to false)
       void CancelMultiTurn();
       
-      // Vector of all of the moves for each of the current side's pieces
-      std::vector<CMoveContainer> currentTurnAllMoves;
-      
-      // Function to populate the currentTurnAllMoves vector
+      // Vectors of all of the moves for each of o's pieces ([0]) & x's pieces ([1]), in scan order of the pieces' squares
+      //   - The first numSidePieces entries hold the side's pieces & the rest are empty
+      //   - The tables are kept from turn to turn: changedSquares has a bit (numbered y*width + x) for each square whose
+      //     contents have changed since the side's table was last brought up to date (ALL_SQUARES = rebuild the table)
+      CMoveTable sideMoves[2];
+      unsigned int numSidePieces[2];
+      unsigned long long changedSquares[2];
+      static const unsigned long long ALL_SQUARES = ~0ULL;
+
+      CMoveTable &CurrentTurnAllMoves() { return sideMoves[isXTurn]; }
+      const CMoveTable &CurrentTurnAllMoves() const { return sideMoves[isXTurn]; }
+
+      // Function to record that the contents of a square have changed (for both sides' tables)
+      void SquareChanged(const CSquareLocation &location)
+      {
+         const unsigned long long bit = 1ULL << ((location.y*width) + location.x);
+         changedSquares[0] |= bit;
+         changedSquares[1] |= bit;
+      }
+
+      // Function to bring the current side's table of moves up to date
+      //   - Only the pieces that have moved, been captured or are near a changed square (see CSquareLinks::influenceMask)
+      //     have their moves worked out again, unless the whole table has to be rebuilt
       void CalculateAllMoves();
+      void RebuildSideMoves(const bool sideIsX);
+      void UpdateSideMoves(const bool sideIsX);
       
       // Bools to signal whether the current side has any moves left (if not, then the game is over)
       // & whether the current side has any aggressive moves available (if so, then they must make an aggressive move)
@@ -217,14 +459,67 @@ class CBoard
       // Control variables for the AI
       bool aiIsX;
       
-      enum PersonlityTypes { MODERATE, GENEROUS, AGGRESSIVE, CAUTIOUS };
+      enum PersonlityTypes { MODERATE, GENEROUS, AGGRESSIVE, CAUTIOUS, MONTE_CARLO };
       int aiPersonality;
+
+      // Monte Carlo tree search engine (shared between copies of a board, so that its tree can be reused between moves)
+      std::shared_ptr<CMctsEngine> mctsEngine;
+      unsigned int mctsPlayouts;
+      int mctsMaxTimeMs;
       
-      // Random number generator
-      CRandomRS rng;
+      // (The AI's random choices use the searching thread's random number generator - see CRandomRS::Thread - so a board
+      //   has no random numbers of its own to copy)
       
-      // Recursive function that the AI uses for working out what the best of the available moves is
-      int GetTreeScore( CBoard src_board, int depth );
+      // Function for the AI to choose a move (returns false if there are no moves), finishing early if the stop flag is set
+      bool ChooseMove(const CSearchLimits &limits, const std::atomic<bool> *stop, CMove &bestMove);
+
+      // Function that a ponder search runs on its own thread (see StartPonder)
+      CMove Ponder(const CSearchLimits &limits, const std::atomic<bool> &stop, CPonderState &ponder);
+      // Function to list the boards that the current side's possible turns lead to (a multi-jump is followed to its end)
+      void GetTurnBoards(std::vector<CBoard> &turnBoards) const;
+      // Function to list the moves that are currently allowed into an array, in the same order as GetLegalMoves (returns
+      //   the number of moves)
+      unsigned int ListLegalMoves(CMove moves[MAX_MOVES]) const;
+
+      // Recursive function that the AI uses for working out what the best of the available moves is: scores a board that
+      //   has its move queued (ply = the number of moves that the board is into the search, starting at 0)
+      //   - The move is made on the thread's board for the ply, & each of the moves after it on the boards for the later
+      //     plies, so the search does not allocate any memory once there are enough boards (see ReservePlyBoards)
+      int GetTreeScore( const CBoard &board, int depth, const unsigned int ply = 0 );
+      // Function to score the board that a move leads to (using the thread's board for the ply)
+      int GetMoveScore( const CBoard &board, const CMove &move, const int depth, const unsigned int ply );
+      // Functions to make sure that the calling thread has boards for the given number of plies (a search to depth N
+      //   needs N+1), & to get its board for a ply
+      static void ReservePlyBoards(const unsigned int plies);
+      static CBoard &PlyBoard(const unsigned int ply);
+
+      // Scores that the tree search has worked out, & the function to get the part of their key that depends on the
+      //   search (the AI's side & personality, & the size of the board) rather than on the position
+      static CTranspositionTable transpositionTable;
+      unsigned long long SearchKey() const;
+
+      // Moves for the AI to play in the opening without searching, & the function to pick one of them for the board
+      //   (returns false if the board is not in the book)
+      static COpeningBook openingBook;
+      bool GetBookMove(CMove &move);
+
+      // Solved endgames that the tree search scores exactly instead of searching them
+      static CTablebase tablebase;
+      // Function to get the board as a tablebase/bitbase position with X to move (returns false if the board cannot be
+      //   one, or has more than the given number of pieces)
+      bool GetTablebasePosition(const unsigned int maxPieces, CTbPosition &position) const;
+
+      // Control variables for finishing a search early (only used by the board that the search was started on)
+      const std::atomic<bool> *searchStop;
+      bool searchHasDeadline;
+      std::chrono::steady_clock::time_point searchDeadline;
+      unsigned long long searchNodes;   // Boards scored by GetTreeScore so far
+      bool searchAborted;
+      // Function to check whether the search should finish early
+      bool SearchAborted();
+
+      // Weights used to score the boards at the leaves of the AI's search tree
+      static CEvalWeights evalWeights;
       
       // bool to denote which side's turn is active
       bool isXTurn;
@@ -232,4 +527,81 @@ class CBoard
 };
 
 
+// State shared between a ponder search & its handle: the board to search once the opponent has moved
+class CPonderState
+{
+   public:
+      CPonderState() : interrupt(false) {}
+
+      std::atomic<bool> interrupt;      // Set when the pondering should finish (the opponent has moved, or the search is stopped)
+      std::mutex mutex;                 // Guards opponentMoved
+      std::unique_ptr<CBoard> opponentMoved;
+};
+
+
+// Handle to an AI search that is running on its own thread (created by CBoard::StartAI or CBoard::StartPonder)
+class CAIHandle
+{
+   public:
+      CAIHandle() {}
+      CAIHandle(CAIHandle &&rhs)
+       : stop(std::move(rhs.stop)), ponder(std::move(rhs.ponder)), stats(std::move(rhs.stats)), result(std::move(rhs.result)) {}
+      CAIHandle &operator=(CAIHandle &&rhs)
+      {
+         Stop();
+         stop = std::move(rhs.stop);
+         ponder = std::move(rhs.ponder);
+         stats = std::move(rhs.stats);
+         result = std::move(rhs.result);
+         return *this;
+      }
+      // Destroying the handle stops the search (& waits for the search thread to finish)
+      ~CAIHandle() { Stop(); }
+
+      // Function to check whether there is a search whose move has not yet been collected
+      bool IsActive() const { return result.valid(); }
+      // Function to check whether the search has finished (without waiting)
+      bool Poll() const
+      {
+         return result.valid() && (result.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+      }
+      // Function to ask the search to finish as soon as possible (it still produces a move, from the deepest finished search)
+      void Stop()
+      {
+         if( stop )
+            *stop = true;
+         if( ponder )
+            ponder->interrupt = true;
+      }
+      // Function to tell a ponder search that the opponent has finished their turn, so that it searches for the AI's move
+      //   on the given board (the handle then behaves in the same way as one from StartAI)
+      void OpponentMoved(const CBoard &board)
+      {
+         if( !ponder )
+            return;
+         {
+            std::lock_guard<std::mutex> lock(ponder->mutex);
+            ponder->opponentMoved.reset( new CBoard(board) );
+         }
+         ponder->interrupt = true;
+      }
+      // Function to wait for the search to finish & collect its move (the move is not valid if there were no moves)
+      CBoard::CMove Get() { return result.get(); }
+      // Function to get the statistics of the search (only filled in once Get has returned the move)
+      const CSearchStats &Stats() const
+      {
+         static const CSearchStats noStats;
+         return ( stats ? *stats : noStats );
+      }
+
+   private:
+      friend class CBoard;
+
+      std::shared_ptr< std::atomic<bool> > stop;
+      std::shared_ptr<CPonderState> ponder;   // Only for ponder searches
+      std::shared_ptr<CSearchStats> stats;
+      std::future<CBoard::CMove> result;
+};
+
+
 #endif
@@ -0,0 +1,130 @@
+// Definition of class functions for the opening book
+
+#include "book.h"
+
+#include <algorithm> // std::sort
+#include <fstream>
+#include <cstring>   // std::memcmp, std::memcpy
+
+// The entries are read & written directly, so the struct must be laid out exactly as in the file
+static_assert( sizeof(CBookEntry) == COpeningBook::ENTRY_SIZE, "CBookEntry does not match the book file layout" );
+
+
+// --------------------------------------------------------------------------- //
+// Function to map a book file & check its header
+// --------------------------------------------------------------------------- //
+
+bool
+COpeningBook::Open(const std::string &filename)
+{
+   Close();
+   if( !file.Open(filename) )
+      return false;
+
+   const char *data = file.Data();
+   unsigned int header[3];   // version, board width, board height
+   if( (file.Size() < HEADER_SIZE) || (std::memcmp(data, "DBK1", 4) != 0) )
+   {
+      Close();
+      return false;
+   }
+   std::memcpy(header, data + 4, sizeof(header));
+   std::memcpy(&numEntries, data + 16, sizeof(numEntries));
+   if( (header[0] != VERSION) || (file.Size() != HEADER_SIZE + numEntries*ENTRY_SIZE) )
+   {
+      Close();
+      return false;
+   }
+   width = header[1];
+   height = header[2];
+   return true;
+}
+
+void
+COpeningBook::Close()
+{
+   file.Close();
+   width = 0;
+   height = 0;
+   numEntries = 0;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to get an entry
+// --------------------------------------------------------------------------- //
+
+CBookEntry
+COpeningBook::Entry(const unsigned long long index) const
+{
+   CBookEntry entry;
+   std::memcpy(&entry, file.Data() + HEADER_SIZE + index*ENTRY_SIZE, sizeof(entry));
+   return entry;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to find the entries for a position
+//   - The keys are hashes, so they are spread evenly & the place to look for a key can be worked out from the keys at
+//     each end of the range that is left (interpolation search), which usually finds it in two or three reads
+//   - In case the keys are not spread evenly, every other step halves the range instead (binary search)
+// --------------------------------------------------------------------------- //
+
+unsigned int
+COpeningBook::Find(const unsigned long long key, std::vector<CBookEntry> &entries) const
+{
+   entries.clear();
+   unsigned long long low = 0;            // The key is in [low, high) if it is in the book at all
+   unsigned long long high = numEntries;
+   for( unsigned int step = 0 ; low < high ; step++ )
+   {
+      const unsigned long long lowKey = Entry(low).key;
+      const unsigned long long highKey = Entry(high-1).key;
+      if( (key < lowKey) || (key > highKey) )
+         break;
+
+      unsigned long long probe = low + (high - low)/2;
+      if( (step % 2 == 0) && (highKey != lowKey) )
+         probe = low + (unsigned long long)( (long double)(key - lowKey) / (long double)(highKey - lowKey) * (high-1 - low) );
+
+      const unsigned long long probeKey = Entry(probe).key;
+      if( probeKey < key )
+         low = probe + 1;
+      else if( probeKey > key )
+         high = probe;
+      else
+      {
+         // Found - the position's moves are next to each other, so collect them from the first one
+         while( (probe > low) && (Entry(probe-1).key == key) )
+            probe--;
+         for( ; (probe < high) && (Entry(probe).key == key) ; probe++ )
+            entries.push_back( Entry(probe) );
+         break;
+      }
+   }
+   return entries.size();
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to write a book file
+// --------------------------------------------------------------------------- //
+
+bool
+COpeningBook::Write(const std::string &filename, const unsigned int width, const unsigned int height,
+                    std::vector<CBookEntry> &entries)
+{
+   std::sort(entries.begin(), entries.end());
+
+   std::ofstream file(filename.c_str(), std::ios::binary);
+   if( !file )
+      return false;
+   const unsigned int header[3] = { VERSION, width, height };
+   const unsigned long long numEntries = entries.size();
+   file.write("DBK1", 4);
+   file.write(reinterpret_cast<const char*>(header), sizeof(header));
+   file.write(reinterpret_cast<const char*>(&numEntries), sizeof(numEntries));
+   for( unsigned int entry = 0 ; entry < entries.size() ; entry++ )
+      file.write(reinterpret_cast<const char*>(&entries[entry]), ENTRY_SIZE);
+   return bool(file);
+}
@@ -0,0 +1,86 @@
+// Declaration of classes for the opening book (moves to play straight away in positions that have been searched in advance)
+
+#ifndef _BOOK_H
+#define _BOOK_H
+
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+
+// One move of one position in the opening book
+//   - The key is CBoard::Hash() of the position in the layout where CBoard::Layout() is true (the other layout is looked
+//     up as its mirror image), & the move is a single step, as given to CBoard::MakeMove
+//   - The weight is the relative chance of the move being played (0 = never), & the score & depth are what the search
+//     that added the move found
+struct CBookEntry
+{
+   unsigned long long key;
+   unsigned char fromX;
+   unsigned char fromY;
+   unsigned char toX;
+   unsigned char toY;
+   unsigned int weight;
+   int score;
+   unsigned int depth;
+
+   bool operator<(const CBookEntry &rhs) const
+   {
+      if( key != rhs.key )
+         return key < rhs.key;
+      if( fromY != rhs.fromY )  return fromY < rhs.fromY;
+      if( fromX != rhs.fromX )  return fromX < rhs.fromX;
+      if( toY != rhs.toY )      return toY < rhs.toY;
+      return toX < rhs.toX;
+   }
+};
+
+
+// Class for looking up positions in an opening book file (which is memory-mapped read-only, so several games running at
+//   once share the same copy of it in memory)
+//
+// File layout (numbers are in the machine's byte order, which is little-endian on every platform that the game runs on):
+//   - Header: "DBK1", then 32-bit version, board width & board height, & the 64-bit number of entries
+//   - The entries, each laid out as CBookEntry (24 bytes), sorted by key (then by move)
+class COpeningBook
+{
+   public:
+      static const unsigned int VERSION = 1;
+      static const unsigned int HEADER_SIZE = 24;
+      static const unsigned int ENTRY_SIZE = 24;
+
+      COpeningBook() : width(0), height(0), numEntries(0) {}
+
+      // Function to map a book file (returns false if it could not be opened or is not an opening book)
+      bool Open(const std::string &filename);
+      void Close();
+      bool IsOpen() const { return file.IsOpen(); }
+
+      // Size of board that the book is for
+      unsigned int Width() const { return width; }
+      unsigned int Height() const { return height; }
+      unsigned long long NumEntries() const { return numEntries; }
+
+      // Function to get the entry with the given index (from 0 to NumEntries()-1)
+      CBookEntry Entry(const unsigned long long index) const;
+      // Function to find all of the entries for a position (returns the number found)
+      unsigned int Find(const unsigned long long key, std::vector<CBookEntry> &entries) const;
+
+      // Function to write a book file from a list of entries (which are sorted first) - returns false if it could not be written
+      static bool Write(const std::string &filename, const unsigned int width, const unsigned int height,
+                        std::vector<CBookEntry> &entries);
+
+   private:
+      CMappedFile file;
+      unsigned int width;
+      unsigned int height;
+      unsigned long long numEntries;
+
+      // The mapping cannot be shared, so copying is not allowed
+      COpeningBook(const COpeningBook &);
+      COpeningBook &operator=(const COpeningBook &);
+};
+
+
+#endif
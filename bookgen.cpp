@@ -0,0 +1,447 @@
+// Builder for the opening book: grows a tree of positions from the start position by drop-out expansion, scoring every
+// move of each position with the AI's search, & writes the moves to a book file that the game can play from
+// g++ bookgen.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp -o bookgen.exe -std=c++11 -pthread -O2
+//
+// Usage: bookgen.exe [-positions N] [-depth N] [-time ms] [-threads N] [-dropout D] [-margin M]
+//                    [-o book file] [-checkpoint file] [-interval seconds]
+//   -positions  number of positions to expand (default 1000)
+//   -depth      search depth for scoring the moves (default 6), -time: time limit per position in ms (default none)
+//   -dropout    cost of each extra turn from the start position, compared to a move that scores 1 less than the best
+//   -margin     moves that score up to this much less than the best move are also put in the book (with lower weights)
+//   -checkpoint file to save the tree in every -interval seconds (default 60), & to carry on from if it already exists
+//
+// Drop-out expansion: every position that has been reached but not expanded has a priority, which is the number of turns
+// from the start position times the drop-out cost, plus how much worse than the best move each move on the way to it was.
+// The position with the lowest priority is always expanded next, so the book goes deep along the good lines & only
+// a little way along the bad ones. Each thread expands a different position at once, & they share the transposition table.
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>   // std::atoi, std::atof
+#include <cstdio>    // std::remove, std::rename
+#include <string>
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <algorithm> // std::max_element
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include "board.h"
+#include "book.h"
+
+
+// A position in the tree (the key is its hash)
+struct CBookNode
+{
+   CBookNode() : priority(0.0), expanded(false), scored(false), depth(0) {}
+
+   std::string position;   // Position string (see CBoard::SetPosition)
+   double priority;
+   bool expanded;          // Taken off the frontier by a thread
+   bool scored;            // The thread has finished scoring the moves
+   // The position's moves & their scores, once it has been expanded
+   int depth;
+   std::vector<CBoard::CMove> moves;
+   std::vector<int> scores;
+};
+
+// Position waiting to be expanded, ordered so that the lowest priority comes first
+struct CFrontierEntry
+{
+   CFrontierEntry(const double _priority, const unsigned long long _key) : priority(_priority), key(_key) {}
+
+   bool operator<(const CFrontierEntry &rhs) const { return priority > rhs.priority; }
+
+   double priority;
+   unsigned long long key;
+};
+
+
+// Class holding the tree, which the threads share
+class CBookBuilder
+{
+   public:
+      CBookBuilder(const CSearchLimits &_limits, const double _dropOut, const int _margin)
+       : limits(_limits), dropOut(_dropOut), margin(_margin), numExpanding(0), numExpanded(0) {}
+
+      // Function to start from the start position
+      void AddStartPosition();
+      // Functions to save the expanded positions to a checkpoint file, & to load them again (returns false if the file
+      //   could not be read)
+      bool SaveCheckpoint(const std::string &filename);
+      bool LoadCheckpoint(const std::string &filename);
+      // Function that each thread runs, until the given number of positions have been expanded or there are none left
+      void Expand(const unsigned int maxPositions);
+      // Function to write the book file
+      bool WriteBook(const std::string &filename);
+
+      unsigned int NumExpanded()
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         return numExpanded;
+      }
+
+   private:
+      CSearchLimits limits;
+      double dropOut;
+      int margin;
+
+      std::mutex mutex;   // Must be held while using anything below
+      std::unordered_map<unsigned long long, CBookNode> nodes;
+      std::priority_queue<CFrontierEntry> frontier;
+      unsigned int numExpanding;   // Number of positions that threads are expanding at the moment
+      unsigned int numExpanded;
+
+      // Function to add each position that an expanded position's moves lead to, to the frontier
+      void AddChildren(const CBookNode &node);
+      // Function to add a position to the frontier (or lower its priority if it is already there)
+      void AddPosition(const CBoard &board, const double priority);
+};
+
+
+// --------------------------------------------------------------------------- //
+// Functions to add positions to the tree
+// --------------------------------------------------------------------------- //
+
+void
+CBookBuilder::AddStartPosition()
+{
+   std::lock_guard<std::mutex> lock(mutex);
+   CBoard board;
+   board.ForceTurn(true);
+   AddPosition(board, 0.0);
+}
+
+void
+CBookBuilder::AddPosition(const CBoard &board, const double priority)
+{
+   CBookNode &node = nodes[board.Hash()];
+   if( node.position.empty() )
+   {
+      node.position = board.GetPosition();
+      node.priority = priority;
+   }
+   else if( node.expanded || (priority >= node.priority) )
+      return;
+   node.priority = priority;
+   frontier.push( CFrontierEntry(priority, board.Hash()) );
+}
+
+// Function to follow a move to the end of the turn (a multi-jump can end in more than one position)
+static void
+GetTurnEnds(const CBoard &board, const CBoard::CMove &move, std::vector<CBoard> &turnEnds)
+{
+   CBoard moved = board;
+   moved.MakeMove(move);
+   if( moved.IsXTurn() != board.IsXTurn() )
+   {
+      turnEnds.push_back(moved);
+      return;
+   }
+   std::vector<CBoard::CMove> nextMoves;
+   moved.GetLegalMoves(nextMoves);
+   for( unsigned int next = 0 ; next < nextMoves.size() ; next++ )
+      GetTurnEnds(moved, nextMoves[next], turnEnds);
+}
+
+void
+CBookBuilder::AddChildren(const CBookNode &node)
+{
+   if( node.scores.empty() )
+      return;
+   CBoard board;
+   board.SetPosition(node.position);
+   const int bestScore = *std::max_element(node.scores.begin(), node.scores.end());
+   for( unsigned int move = 0 ; move < node.moves.size() ; move++ )
+   {
+      std::vector<CBoard> turnEnds;
+      GetTurnEnds(board, node.moves[move], turnEnds);
+      const double priority = node.priority + dropOut + (bestScore - node.scores[move]);
+      for( unsigned int end = 0 ; end < turnEnds.size() ; end++ )
+         AddPosition(turnEnds[end], priority);
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function that each thread runs: take the position with the lowest priority, score its moves, & add its children
+// --------------------------------------------------------------------------- //
+
+void
+CBookBuilder::Expand(const unsigned int maxPositions)
+{
+   CBoard board;
+   for( ;; )
+   {
+      CBookNode node;
+      unsigned long long key = 0;
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         // Skip entries that have been expanded, or replaced by the same position with a lower priority
+         while( !frontier.empty() && ( nodes[frontier.top().key].expanded ||
+                                       (nodes[frontier.top().key].priority < frontier.top().priority) ) )
+            frontier.pop();
+         if( numExpanded + numExpanding >= maxPositions )
+            return;
+         if( frontier.empty() )
+         {
+            // Another thread's position may still add to the frontier
+            if( numExpanding == 0 )
+               return;
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+         }
+         key = frontier.top().key;
+         frontier.pop();
+         CBookNode &frontierNode = nodes[key];
+         frontierNode.expanded = true;
+         node = frontierNode;
+         numExpanding++;
+      }
+
+      board.SetPosition(node.position);
+      board.ScoreMoves(limits, node.moves, node.scores);
+      // With a time limit the search goes as deep as it can, so the depth is the one that it reached
+      node.depth = (unsigned int)CBoard::LastSearchStats().depth;
+      node.scored = true;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      nodes[key] = node;
+      numExpanding--;
+      numExpanded++;
+      AddChildren(node);
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions to save & load a checkpoint
+//   - One line per expanded position: position string, priority, search depth, number of moves, then for each move
+//     "fromX fromY toX toY score"
+//   - The frontier is not saved, as it is rebuilt from the moves of the expanded positions
+// --------------------------------------------------------------------------- //
+
+bool
+CBookBuilder::SaveCheckpoint(const std::string &filename)
+{
+   std::ostringstream checkpoint;
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      for( std::unordered_map<unsigned long long, CBookNode>::const_iterator node = nodes.begin() ; node != nodes.end() ; ++node )
+      {
+         if( !node->second.scored || (node->second.scores.size() != node->second.moves.size()) )
+            continue;   // Not expanded yet, or the search did not finish
+         checkpoint << node->second.position << " " << node->second.priority << " " << node->second.depth << " "
+                    << node->second.moves.size();
+         for( unsigned int move = 0 ; move < node->second.moves.size() ; move++ )
+         {
+            const CBoard::CMove &bookMove = node->second.moves[move];
+            checkpoint << " " << bookMove.fromX << " " << bookMove.fromY << " " << bookMove.toX << " " << bookMove.toY
+                       << " " << node->second.scores[move];
+         }
+         checkpoint << "\n";
+      }
+   }
+
+   // Write to a temporary file first, so that the old checkpoint is kept if the program is stopped part way through
+   const std::string tempFilename = filename + ".tmp";
+   {
+      std::ofstream file(tempFilename.c_str());
+      if( !(file << checkpoint.str()) )
+         return false;
+   }
+   std::remove(filename.c_str());
+   return std::rename(tempFilename.c_str(), filename.c_str()) == 0;
+}
+
+bool
+CBookBuilder::LoadCheckpoint(const std::string &filename)
+{
+   std::ifstream file(filename.c_str());
+   if( !file )
+      return false;
+
+   std::lock_guard<std::mutex> lock(mutex);
+   std::vector<unsigned long long> keys;
+   std::string line;
+   CBoard board;
+   while( std::getline(file, line) )
+   {
+      std::istringstream words(line);
+      std::string squares, side;
+      CBookNode node;
+      unsigned int numMoves = 0;
+      words >> squares >> side >> node.priority >> node.depth >> numMoves;
+      node.position = squares + " " + side;
+      node.expanded = true;
+      node.scored = true;
+      for( unsigned int move = 0 ; (move < numMoves) && words ; move++ )
+      {
+         CBoard::CMove bookMove;
+         int score = 0;
+         words >> bookMove.fromX >> bookMove.fromY >> bookMove.toX >> bookMove.toY >> score;
+         node.moves.push_back(bookMove);
+         node.scores.push_back(score);
+      }
+      if( !words || !board.SetPosition(node.position) )
+      {
+         std::cout << "Could not read the checkpoint line \"" << line << "\"\n";
+         return false;
+      }
+      nodes[board.Hash()] = node;
+      keys.push_back(board.Hash());
+   }
+   numExpanded = keys.size();
+
+   for( unsigned int key = 0 ; key < keys.size() ; key++ )
+      AddChildren(nodes[keys[key]]);
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to write the book file
+//   - The best moves of each expanded position get the highest weight, & moves within the margin of the best get less
+//   - The other moves are also written (with a weight of 0, so that they are never played) to keep their scores
+// --------------------------------------------------------------------------- //
+
+bool
+CBookBuilder::WriteBook(const std::string &filename)
+{
+   std::vector<CBookEntry> entries;
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      for( std::unordered_map<unsigned long long, CBookNode>::const_iterator node = nodes.begin() ; node != nodes.end() ; ++node )
+      {
+         if( !node->second.scored || node->second.scores.empty() || (node->second.scores.size() != node->second.moves.size()) )
+            continue;
+         const int bestScore = *std::max_element(node->second.scores.begin(), node->second.scores.end());
+         for( unsigned int move = 0 ; move < node->second.moves.size() ; move++ )
+         {
+            const CBoard::CMove &bookMove = node->second.moves[move];
+            const int shortfall = bestScore - node->second.scores[move];
+            CBookEntry entry;
+            entry.key = node->first;
+            entry.fromX = (unsigned char)(bookMove.fromX);
+            entry.fromY = (unsigned char)(bookMove.fromY);
+            entry.toX = (unsigned char)(bookMove.toX);
+            entry.toY = (unsigned char)(bookMove.toY);
+            entry.weight = ( shortfall <= margin ? (unsigned int)(margin + 1 - shortfall) : 0 );
+            entry.score = node->second.scores[move];
+            entry.depth = (unsigned int)(node->second.depth);
+            entries.push_back(entry);
+         }
+      }
+   }
+
+   CBoard board;
+   if( !COpeningBook::Write(filename, board.Width(), board.Height(), entries) )
+      return false;
+   std::cout << "Wrote " << entries.size() << " moves to \"" << filename << "\"\n";
+   return true;
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned int maxPositions = 1000;
+   int depth = 6;
+   int maxTimeMs = 0;
+   unsigned int numThreads = std::thread::hardware_concurrency();
+   double dropOut = 1.0;
+   int margin = 0;
+   std::string outputFilename = "draughts.book";
+   std::string checkpointFilename;
+   double checkpointInterval = 60.0;
+
+   for( int arg = 1 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      const char *value = argv[arg+1];
+      if( option == "-positions" )         maxPositions = std::atoi(value);
+      else if( option == "-depth" )        depth = std::atoi(value);
+      else if( option == "-time" )         maxTimeMs = std::atoi(value);
+      else if( option == "-threads" )      numThreads = std::atoi(value);
+      else if( option == "-dropout" )      dropOut = std::atof(value);
+      else if( option == "-margin" )       margin = std::atoi(value);
+      else if( option == "-o" )            outputFilename = value;
+      else if( option == "-checkpoint" )   checkpointFilename = value;
+      else if( option == "-interval" )     checkpointInterval = std::atof(value);
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+   if( numThreads == 0 )
+      numThreads = 1;
+
+   CBookBuilder builder(CSearchLimits(depth, maxTimeMs), dropOut, margin);
+   if( !checkpointFilename.empty() && std::ifstream(checkpointFilename.c_str()) )
+   {
+      if( !builder.LoadCheckpoint(checkpointFilename) )
+         return 1;
+      std::cout << "Carrying on from " << builder.NumExpanded() << " positions in \"" << checkpointFilename << "\"\n";
+   }
+   else
+      builder.AddStartPosition();
+
+   const unsigned int startExpanded = builder.NumExpanded();
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   std::atomic<unsigned int> numFinished(0);
+   std::vector<std::thread> threads;
+   for( unsigned int thread = 0 ; thread < numThreads ; thread++ )
+      threads.push_back( std::thread( [&builder, &numFinished, maxPositions]()
+                                      {
+                                         builder.Expand(maxPositions);
+                                         numFinished++;
+                                      } ) );
+
+   // Report progress & save checkpoints until the threads have finished
+   double lastCheckpoint = 0.0;
+   double lastReport = 0.0;
+   while( numFinished < numThreads )
+   {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+      if( seconds - lastReport >= 10.0 )
+      {
+         lastReport = seconds;
+         const unsigned int numExpanded = builder.NumExpanded();
+         std::cout << numExpanded << " positions expanded (" << (numExpanded - startExpanded)/seconds << " positions/s)\n";
+      }
+      if( !checkpointFilename.empty() && (seconds - lastCheckpoint >= checkpointInterval) )
+      {
+         lastCheckpoint = seconds;
+         if( !builder.SaveCheckpoint(checkpointFilename) )
+            std::cout << "Could not write the checkpoint \"" << checkpointFilename << "\"\n";
+      }
+   }
+   for( unsigned int thread = 0 ; thread < threads.size() ; thread++ )
+      threads[thread].join();
+
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+   const unsigned int numExpanded = builder.NumExpanded();
+   std::cout << numExpanded << " positions expanded in " << seconds << "s ("
+             << (seconds > 0.0 ? (numExpanded - startExpanded)/seconds : 0.0) << " positions/s)\n";
+
+   if( !checkpointFilename.empty() && !builder.SaveCheckpoint(checkpointFilename) )
+      std::cout << "Could not write the checkpoint \"" << checkpointFilename << "\"\n";
+   if( !builder.WriteBook(outputFilename) )
+   {
+      std::cout << "Could not write \"" << outputFilename << "\"\n";
+      return 1;
+   }
+   return 0;
+}
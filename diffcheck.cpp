@@ -0,0 +1,329 @@
+// Differential check of the bitboard rules engine (rules.h) against CBoard: plays random games with both side by side,
+// & stops at the first position where they disagree, printing it & the smallest position that it can be cut down to
+// that still shows the difference
+// g++ diffcheck.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp -o diffcheck.exe -std=c++11 -pthread -O2
+//
+// Usage: diffcheck.exe [-games N] [-plies N] [-seed N] [-threads N]
+//   -games     number of random games to play (default 100000), -plies: maximum number of turns per game (default 200)
+//   -seed      seed of the random games (default 1) - game g of a seed is always the same game, however many threads
+//              there are, so a failure can be replayed
+//   -threads   number of threads (default: one per core)
+//
+// At every turn, each engine lists its turns in full: CBoard's by making the moves of each multi-jump one at a time (so
+// the end of a turn is where ExecuteSelectedSquare ends the multi-turn sequence). Each turn is compared by its starting
+// & finishing squares, the squares of the pieces it captures & the position after it (which shows any crowning), so any
+// difference in the moves, forced captures, crowning or multi-jump continuation is found. The games alternate between
+// the two board layouts (the bitboard engine always works in layout 1, so layout 0 positions are mirrored).
+// Exits with code 1 if a difference was found.
+
+
+#include <iostream>
+#include <cstdlib>   // std::atoi, std::strtoull
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm> // std::sort, std::reverse, std::set_difference
+#include <iterator>  // std::back_inserter
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <random>
+#include "board.h"
+#include "rules.h"
+
+typedef CCheckersRules<CGeometry8x8> CRules;
+
+
+// --------------------------------------------------------------------------- //
+// Functions to describe the turns of each engine in the same way (in layout 1 coordinates)
+// --------------------------------------------------------------------------- //
+
+// Function to convert a position string between the layouts (each row is mirrored in x)
+static std::string
+MirrorPosition(const std::string &position, const unsigned int width)
+{
+   std::string mirrored = position;
+   for( std::string::size_type row = 0 ; row + width <= mirrored.size() && mirrored[row] != ' ' ; row += width + 1 )
+      std::reverse(mirrored.begin() + row, mirrored.begin() + row + width);
+   return mirrored;
+}
+
+static std::string
+TurnDescription(const int fromX, const int fromY, const int toX, const int toY, std::vector<int> captured,
+                const std::string &result)
+{
+   std::sort(captured.begin(), captured.end());
+   std::ostringstream description;
+   description << "(" << fromX << "," << fromY << ")-(" << toX << "," << toY << ") captures";
+   for( unsigned int square = 0 ; square < captured.size() ; square++ )
+      description << " (" << captured[square] % 8 << "," << captured[square] / 8 << ")";
+   description << " -> " << result;
+   return description.str();
+}
+
+// Function to list CBoard's turns, following each multi-jump one move at a time until the turn passes to the other side
+static void
+GetBoardTurns(const CBoard &start, const CBoard &board, const CBoard::CMove &first, std::vector<int> &captured,
+              std::vector<std::string> &turns, std::vector<CBoard> *results)
+{
+   std::vector<CBoard::CMove> moves;
+   board.GetLegalMoves(moves);
+   for( unsigned int move = 0 ; move < moves.size() ; move++ )
+   {
+      const CBoard::CMove &step = moves[move];
+      CBoard moved = board;
+      moved.MakeMove(step);
+
+      // Squares in layout 1 coordinates
+      const bool mirror = !board.Layout();
+      const int x = ( mirror ? 7 - (step.fromX + step.toX)/2 : (step.fromX + step.toX)/2 );
+      const bool isJump = (std::abs(step.toX - step.fromX) == 2);
+      if( isJump )
+         captured.push_back( ((step.fromY + step.toY)/2)*8 + x );
+      const CBoard::CMove &turnStart = ( first.IsValid() ? first : step );
+
+      if( moved.IsXTurn() == start.IsXTurn() )
+         GetBoardTurns(start, moved, turnStart, captured, turns, results);
+      else
+      {
+         const std::string result = ( mirror ? MirrorPosition(moved.GetPosition(), 8) : moved.GetPosition() );
+         turns.push_back( TurnDescription(mirror ? 7 - turnStart.fromX : turnStart.fromX, turnStart.fromY,
+                                          mirror ? 7 - step.toX : step.toX, step.toY, captured, result) );
+         if( results != nullptr )
+            results->push_back(moved);
+      }
+      if( isJump )
+         captured.pop_back();
+   }
+}
+
+static void
+GetRulesTurns(const CRules::Position &position, std::vector<std::string> &turns)
+{
+   std::vector<CRules::CTurn> generated;
+   CRules::GenerateTurns(position, generated);
+   for( unsigned int turn = 0 ; turn < generated.size() ; turn++ )
+   {
+      const CRules::CTurn &made = generated[turn];
+      std::vector<int> captured;
+      for( unsigned int square = 0 ; square < CGeometry8x8::NUM_SQUARES ; square++ )
+         if( made.captured & CGeometry8x8::Bit(square) )
+            captured.push_back( CGeometry8x8::Y(square)*8 + CGeometry8x8::X(square) );
+      turns.push_back( TurnDescription(CGeometry8x8::X(made.from), CGeometry8x8::Y(made.from),
+                                       CGeometry8x8::X(made.to), CGeometry8x8::Y(made.to), captured,
+                                       CRules::ToString(made.result)) );
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to compare the engines on a position (given in layout 1): returns true if they disagree, with the turns
+//   that only one of them has in "report"
+// --------------------------------------------------------------------------- //
+
+static bool
+Disagree(const CBoard &empty, const std::string &position, const bool layout, std::string &report)
+{
+   CBoard board = empty;
+   board.SetLayoutAndReset(layout);
+   CRules::Position rulesPosition;
+   if( !board.SetPosition(layout ? position : MirrorPosition(position, 8)) || !CRules::FromString(position, rulesPosition) )
+      return false;
+
+   std::vector<std::string> boardTurns, rulesTurns;
+   std::vector<int> captured;
+   GetBoardTurns(board, board, CBoard::CMove(), captured, boardTurns, nullptr);
+   GetRulesTurns(rulesPosition, rulesTurns);
+   std::sort(boardTurns.begin(), boardTurns.end());
+   std::sort(rulesTurns.begin(), rulesTurns.end());
+   if( boardTurns == rulesTurns )
+      return false;
+
+   std::ostringstream differences;
+   std::vector<std::string> onlyBoard, onlyRules;
+   std::set_difference(boardTurns.begin(), boardTurns.end(), rulesTurns.begin(), rulesTurns.end(), std::back_inserter(onlyBoard));
+   std::set_difference(rulesTurns.begin(), rulesTurns.end(), boardTurns.begin(), boardTurns.end(), std::back_inserter(onlyRules));
+   differences << "   CBoard has " << boardTurns.size() << " turns, the bitboard engine " << rulesTurns.size() << "\n";
+   for( unsigned int turn = 0 ; turn < onlyBoard.size() ; turn++ )
+      differences << "   only CBoard:  " << onlyBoard[turn] << "\n";
+   for( unsigned int turn = 0 ; turn < onlyRules.size() ; turn++ )
+      differences << "   only bitboard: " << onlyRules[turn] << "\n";
+   report = differences.str();
+   return true;
+}
+
+// Function to cut a position down while the engines still disagree: each piece in turn is taken off (or a king is made
+//   a man), & the change is kept if the difference is still there, until no single change keeps it
+static std::string
+Minimise(const CBoard &empty, std::string position, const bool layout)
+{
+   std::string report;
+   bool changed = true;
+   while( changed )
+   {
+      changed = false;
+      for( std::string::size_type square = 0 ; square < position.size() && position[square] != ' ' ; square++ )
+      {
+         const char piece = position[square];
+         if( (piece == '.') || (piece == '/') )
+            continue;
+         const char simpler[2] = { '.', char( piece == 'X' ? 'x' : piece == 'O' ? 'o' : '.' ) };
+         for( unsigned int option = 0 ; option < 2 ; option++ )
+         {
+            std::string tried = position;
+            tried[square] = simpler[option];
+            if( (tried != position) && Disagree(empty, tried, layout, report) )
+            {
+               position = tried;
+               changed = true;
+               break;
+            }
+         }
+      }
+   }
+   return position;
+}
+
+
+// Function to count the pieces (or just the kings) in a position string
+static unsigned int
+CountPieces(const std::string &position, const bool kingsOnly)
+{
+   unsigned int count = 0;
+   for( std::string::size_type square = 0 ; square < position.size() && position[square] != ' ' ; square++ )
+      if( (position[square] == 'X') || (position[square] == 'O') ||
+          (!kingsOnly && ((position[square] == 'x') || (position[square] == 'o'))) )
+         count++;
+   return count;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Random games, shared between the threads
+// --------------------------------------------------------------------------- //
+
+class CDiffCheck
+{
+   public:
+      CDiffCheck(const unsigned long long _numGames, const unsigned int _maxPlies, const unsigned long long _seed)
+       : numGames(_numGames), maxPlies(_maxPlies), seed(_seed), nextGame(0), numTurns(0), numCaptures(0),
+         numMultiJumps(0), numCrownings(0), failed(false) {}
+
+      void Run(const CBoard &empty);
+      bool Failed() const { return failed; }
+
+      const unsigned long long numGames;
+      const unsigned int maxPlies;
+      const unsigned long long seed;
+      std::atomic<unsigned long long> nextGame;
+      std::atomic<unsigned long long> numTurns;
+      std::atomic<unsigned long long> numCaptures;
+      std::atomic<unsigned long long> numMultiJumps;
+      std::atomic<unsigned long long> numCrownings;
+
+   private:
+      std::atomic<bool> failed;
+      std::mutex reportMutex;
+};
+
+void
+CDiffCheck::Run(const CBoard &empty)
+{
+   for( unsigned long long game = nextGame++ ; (game < numGames) && !failed ; game = nextGame++ )
+   {
+      std::mt19937_64 random(seed * 0x9E3779B97F4A7C15ULL + game);
+      const bool layout = (game & 1) == 0;
+      CBoard board = empty;
+      board.SetLayoutAndReset(layout);
+
+      for( unsigned int ply = 0 ; ply < maxPlies ; ply++ )
+      {
+         const std::string position = ( layout ? board.GetPosition() : MirrorPosition(board.GetPosition(), 8) );
+         std::string report;
+         if( Disagree(empty, position, layout, report) )
+         {
+            std::lock_guard<std::mutex> lock(reportMutex);
+            if( !failed )
+            {
+               failed = true;
+               std::cout << "Difference in game " << game << " (seed " << seed << "), turn " << ply << ", layout "
+                         << layout << ":\n   " << position << "\n" << report;
+               const std::string minimised = Minimise(empty, position, layout);
+               Disagree(empty, minimised, layout, report);
+               std::cout << "Smallest position with the difference:\n   " << minimised << "\n" << report;
+            }
+            return;
+         }
+
+         // Play one of CBoard's turns at random
+         std::vector<std::string> turns;
+         std::vector<CBoard> results;
+         std::vector<int> captured;
+         GetBoardTurns(board, board, CBoard::CMove(), captured, turns, &results);
+         if( results.empty() )
+            break;
+         const unsigned int turn = std::uniform_int_distribution<unsigned int>(0, results.size()-1)(random);
+
+         numTurns++;
+         const std::string next = results[turn].GetPosition();
+         if( CountPieces(next, false) < CountPieces(position, false) )
+            numCaptures++;
+         if( CountPieces(next, false) + 1 < CountPieces(position, false) )
+            numMultiJumps++;
+         if( CountPieces(next, true) > CountPieces(position, true) )
+            numCrownings++;
+         board = results[turn];
+      }
+   }
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned long long numGames = 100000;
+   unsigned int maxPlies = 200;
+   unsigned long long seed = 1;
+   unsigned int numThreads = std::thread::hardware_concurrency();
+
+   for( int arg = 1 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      const char *value = argv[arg+1];
+      if( option == "-games" )             numGames = std::strtoull(value, nullptr, 10);
+      else if( option == "-plies" )        maxPlies = std::atoi(value);
+      else if( option == "-seed" )         seed = std::strtoull(value, nullptr, 10);
+      else if( option == "-threads" )      numThreads = std::atoi(value);
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+   if( numThreads == 0 )
+      numThreads = 1;
+
+   const CBoard empty;
+   CDiffCheck check(numGames, maxPlies, seed);
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   std::vector<std::thread> threads;
+   for( unsigned int thread = 1 ; thread < numThreads ; thread++ )
+      threads.push_back( std::thread(&CDiffCheck::Run, &check, std::cref(empty)) );
+   check.Run(empty);
+   for( unsigned int thread = 0 ; thread < threads.size() ; thread++ )
+      threads[thread].join();
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+   if( check.Failed() )
+      return 1;
+   std::cout << "No differences in " << numGames << " games (" << check.numTurns << " turns, " << check.numCaptures
+             << " captures, " << check.numMultiJumps << " multi-jumps, " << check.numCrownings << " crownings) in "
+             << seconds << "s\n";
+   return 0;
+}
@@ -1,10 +1,41 @@
 // Console-based game of Draughts
-// g++ draughts.cpp board.cpp -o draughts.exe -std=c++11
+// g++ draughts.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp -o draughts.exe -std=c++11 -pthread
+//   (add -DDRAUGHTS_BITBASE bitbase.cpp bitbase_data.cpp to build in the bitbase of the smallest endgames - see bitbase.h,
+//   & allocations.cpp for bench to check that the AI's search does not allocate any memory)
+//
+// Usage: draughts.exe [-weights <weights file>] [-tablebase <tablebase file>] [-book <book file>] [-noponder]
+//                     [-variant 8x8/7x7/6x6] [-threads N] [-stats] [-trace <trace file>]
+//        draughts.exe bench [-depth N]
+//   -weights   evaluation weights for the AI (the weights file is written by the tune program)
+//   -tablebase endgame tablebase for the AI (the tablebase file is written by the tbgen program)
+//   -book      opening book for the AI
+//   -noponder  stop the AI from thinking during the user's turn
+//   -variant   size of board to play on (default 8x8 - the smaller boards start with fewer pieces)
+//   -threads   number of threads that the Monte Carlo AI searches with (default one for each of the processor's threads)
+//   -stats     print the statistics of the AI's search (nodes, time, branching factor, etc.) after each of its moves
+//              (& the memory allocated by the AI's search & by the whole game, if linked with allocations.cpp)
+//   -trace     record a timeline of the AI's searches & add it to the file (as Chrome Trace Event JSON, for
+//              chrome://tracing or Perfetto) after each of its moves - only if compiled with -DDRAUGHTS_TRACE
+//   bench      search each of a fixed set of 8x8 positions to the given depth (default 6) & print the number of boards
+//              searched, a signature of the searches' node counts & scores (which only changes if the search does),
+//              the time taken & the nodes per second
 
 
 #include <iostream>
+#include <cstdlib>   // std::atoi
+#include <cstdio>    // std::snprintf
 #include <limits>
+#include <string>
+#include <deque>
+#include <memory>    // std::unique_ptr
+#include <algorithm> // std::max_element
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "board.h"
+#include "mcts.h"
+#include "trace.h"
+#include "allocations.h"
 #include "randomrs.h"   // Random number generator for deciding who goes first
 
 enum commands
@@ -22,13 +53,47 @@ enum commands
 };
 
 
+// Lines entered by the user are read on their own thread & queued, so that the game does not have to wait on the
+//   keyboard (e.g. the AI can think while still letting the user cut its search short)
+std::mutex inputMutex;
+std::condition_variable inputAvailable;
+std::deque<std::string> inputLines;
+bool inputClosed = false;
+
+void ReadUserInput()
+{
+   std::string line;
+   while( std::getline(std::cin, line) )
+   {
+      std::lock_guard<std::mutex> lock(inputMutex);
+      inputLines.push_back(line);
+      inputAvailable.notify_one();
+   }
+   std::lock_guard<std::mutex> lock(inputMutex);
+   inputClosed = true;
+   inputAvailable.notify_one();
+}
+
 char GetUserInput()
 {
-   char userChar;
-   userChar = std::cin.get();
-   std::cin.ignore( std::numeric_limits<std::streamsize>::max(), '\n' );
-   //std::cin >> userChar;
-   return userChar;
+   std::unique_lock<std::mutex> lock(inputMutex);
+   inputAvailable.wait( lock, []{ return !inputLines.empty() || inputClosed; } );
+   if( inputLines.empty() )
+      return std::char_traits<char>::eof();
+   // Only the first character of the line is used
+   const std::string line = inputLines.front();
+   inputLines.pop_front();
+   return ( line.empty() ? '\n' : line[0] );
+}
+
+// Function to wait for up to the given time for the user to enter a line (returns true, & discards the line, if they did)
+bool UserInputWithin(const int timeMs)
+{
+   std::unique_lock<std::mutex> lock(inputMutex);
+   if( !inputAvailable.wait_for( lock, std::chrono::milliseconds(timeMs), []{ return !inputLines.empty(); } ) )
+      return false;
+   inputLines.pop_front();
+   return true;
 }
 
 void
@@ -78,8 +143,222 @@ Draw(CBoard &board)
 }
 
 
-int main()
+// Positions searched by the bench command: the start position, openings, middlegames & endgames (with & without kings),
+//   taken from random games
+static const char *BENCH_POSITIONS[] =
 {
+      ".x.x.x.x/x...x.x./.x.x.x.x/x.o...../......../o.o.o.o./...o.o.o/o.o.o.o. x",
+      ".x.x.x.x/x.x.x.x./...x.x.x/..x...../...o..../o...o.o./.o.o.o.o/o.o.o.o. o",
+      ".x.x.x.x/x.x.x.x./...x.x.x/x...o.../......../o.o...o./.o.o.o.o/o.o.o.o. x",
+      ".x.x.x.x/x.x.x.x./.x...x.x/....x.../...o..../o.o.o.o./.o.o...o/o.o.o.o. x",
+      ".x.x.x.x/x.x.x.x./.x.x.x.x/......../......../o.o.o.o./.o.o.o.o/o.o.o.o. o",
+      ".x.x.x.x/x.x.x.x./.x.x.x.x/......../.o....../..o.o.o./.o.o.o.o/o.o.o.o. x",
+      ".x.x.x.x/x.x.x.x./...x.x../......x./...o..../o.x.o.o./.o.o.o.o/o...o.o. x",
+      ".x.x.x.x/x.x.x.x./.x...x../......x./.....x../o.o...o./.o.o.o.o/o.o.o.o. o",
+      ".x.x.x.x/....x.x./.x...x.x/x...x.../......../o.o.o.o./.o.o.o.o/o.o...o. o",
+      ".x.x.x.x/x.x.x.../.x.x...x/....x.../......../o...o.o./.o.o.o.o/o.o.o.o. o",
+      ".x.x.x.x/..x.x.x./.....x../x.o...o./.......o/o.o...../.o.....o/o.o.o.o. x",
+      ".x.x.x.x/x.x.x.x./.x.....x/......../.o....../o.o...o./.o...o.o/o.o...o. x",
+      ".x.x.x../x.x.x.x./.....x.o/..x...../.o.o..../o.o...../.....o.o/o...o.o. o",
+      ".x...x.x/....x.x./.....x.o/....x.../.x.....o/o...o.../...o.o../..o.o.o. o",
+      ".x.x.x../x.x...../...x.x.x/......../...o..../o...o.o./...o...o/o.o.o... x",
+      ".....x.x/x...x.x./...x...x/......../.....x../o......./.o.o.x.o/o.o...o. o",
+      ".x.x.x../x......./...o...x/....x.x./.....x../o.o...o./...o.o.o/......o. x",
+      ".x.x.x.O/x.x...../.......x/......../.x...o../x...o.../.o.o...o/o.o..... x",
+      ".......x/x.....x./.x.....x/......x./.o.....x/o...o.x./.o.o..../o.....o. o",
+      ".....x../x.x...x./.x...x.x/......../.....o../x.o...o./.o.....o/o.....X. x",
+      ".x...x.x/......x./.o...x../x.o...x./......../o.o...../.......o/o.X...o. x",
+      ".x.x..../..x...x./.....x.x/....x.x./.......o/..X.o.o./.....o.o/..X..... o",
+      ".x.....x/x.....x./...o...x/..o...x./.x....../....o.../.....o.o/o...o... x",
+      "...x.O../x.x...../.x.x...x/......../.o.o..../......../.....x.o/o.X.o... o",
+      "...x...x/x.x...x./.....o../....x.../......../......../.o...o.x/o.o.X... o",
+      ".x....../......x./......../....x.../.O....../o.....o./...o...x/o.o.o... o",
+      ".....O.x/..O...../.....x../......../...o.o../x.x.o.o./......../o....... o",
+      "......../x......./.x.x.x../X......./.....o.x/o.o...../......../o....... x",
+      ".O.....x/......../.x....../....x.../......../o.o...o./.o.....o/o....... x",
+      ".O...x../....x.../...x..../x......./.....x../o...o.../.o....../o....... x",
+      ".x.x...x/..x.x.../.x...X../......../.......x/......../.......o/o....... x",
+      ".......x/......../...x.x../x......./......../o...o.../.......o/..o.o... x",
+      ".x.O..../x......./.....o../......../......../......o./.o...x.o/o....... o",
+      "......../x......./...x.o../..x...../......../x.x...../.....x../X....... x",
+      "......../x...O.../...o..../..o...../......../....x.o./.o.....o/........ o",
+      ".......x/x......./...x..../......../......../o.....o./.x.....x/..X..... x",
+      "......../x.O...x./......../..o...../.....x../......../.o...X../o....... o",
+      "...O.x../......../...x..../......../......../o.....X./.o.o..../o....... x",
+      ".x....../..x...../.......O/..x...o./.X....../x......./......../........ o",
+      "......../......../.x....../..x...../...x...O/......../.x.....o/........ o",
+      ".O.....x/......../......../..x...x./......../....o.o./......../........ o",
+      ".O.O...x/......../......../......../......../....x.../.....x../o....... o",
+      "......../..O...O./.......o/..O...../.......o/......../.X....../........ x",
+      "...O...O/....O.../......../......O./......../......../......../X...X... x",
+      "......../..O...../......../......../...x...x/X......./.......x/........ o",
+      "......../..o.O.../.......o/......../.......o/......../.X....../........ o",
+      ".......O/..X...../......../......../.....o../......../.....x../........ x",
+      ".....O../......../......../....x.../.o....../......../......../......X. x",
+      "......../......../...o..../......../......../..O...../......../....X... x",
+      "......../......o./......../......../......../......../.......X/....X... o"
+};
+
+// Function to run the bench command: each position is searched from an empty transposition table, so that its node count
+//   does not depend on the positions before it
+//   - If the program is linked with allocations.cpp, the searches are also checked not to allocate any memory (the
+//     program stops at the first allocation that one makes)
+int
+RunBench(int argc, char **argv)
+{
+   int depth = 6;
+   for( int arg = 2 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      if( option == "-depth" )
+         depth = std::atoi(argv[arg+1]);
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+
+   const unsigned int numPositions = sizeof(BENCH_POSITIONS) / sizeof(BENCH_POSITIONS[0]);
+   unsigned long long totalNodes = 0;
+   unsigned long long signature = 0xCBF29CE484222325ULL;
+   std::chrono::steady_clock::duration elapsed(0);
+   std::vector<CBoard::CMove> moves;
+   std::vector<int> scores;
+   CAllocations::FailOnSearchAllocation(true);
+   for( unsigned int position = 0 ; position < numPositions ; position++ )
+   {
+      CBoard board;
+      if( !board.SetPosition(BENCH_POSITIONS[position]) )
+      {
+         std::cout << "Bench position " << position+1 << " is not valid\n";
+         return 1;
+      }
+      CBoard::ClearTranspositionTable();
+
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      board.ScoreMoves(CSearchLimits(depth), moves, scores);
+      elapsed += std::chrono::steady_clock::now() - start;
+
+      const int bestScore = ( scores.empty() ? 0 : *std::max_element(scores.begin(), scores.end()) );
+      std::cout << "Position " << position+1 << "/" << numPositions << ": " << board.SearchNodes() << " nodes, score "
+                << bestScore << "\n";
+      totalNodes += board.SearchNodes();
+      // FNV-1a hash of each position's node count & scores
+      signature = (signature ^ board.SearchNodes()) * 0x100000001B3ULL;
+      for( unsigned int move = 0 ; move < scores.size() ; move++ )
+         signature = (signature ^ (unsigned int)scores[move]) * 0x100000001B3ULL;
+   }
+
+   const long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+   char signatureText[32];
+   std::snprintf(signatureText, sizeof(signatureText), "%016llx", signature);
+   std::cout << "\nDepth:          " << depth
+             << "\nNodes searched: " << totalNodes
+             << "\nSignature:      " << signatureText
+             << "\nTime (ms):      " << elapsedMs
+             << "\nNodes/second:   " << totalNodes * 1000 / (unsigned long long)std::max(elapsedMs, 1LL) << "\n";
+   if( CAllocations::Counting() )
+      std::cout << "Search allocations: " << CAllocations::SearchAllocations() << "\n";
+   return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+   // The bench command is run instead of the game
+   if( (argc > 1) && (std::string(argv[1]) == "bench") )
+      return RunBench(argc, argv);
+
+   // The AI thinks during the user's turn ("pondering") unless told not to
+   bool ponder = true;
+   bool showStats = false;
+   std::string traceFilename;
+   unsigned int mctsThreads = 0;   // 0 = one for each of the processor's threads
+   CBoard::Variants variant = CBoard::VARIANT_8X8;
+   for( int arg = 1 ; arg < argc ; arg++ )
+   {
+      const std::string option = argv[arg];
+      // Load the AI's evaluation weights, if a weights file has been given
+      if( (option == "-weights") && (arg+1 < argc) )
+      {
+         if( !CBoard::LoadEvalWeights(argv[++arg]) )
+         {
+            std::cout << "Could not load the evaluation weights from \"" << argv[arg] << "\"\n";
+            return 1;
+         }
+      }
+      // Load the endgame tablebase, if a tablebase file has been given
+      else if( (option == "-tablebase") && (arg+1 < argc) )
+      {
+         if( !CBoard::LoadTablebase(argv[++arg]) )
+         {
+            std::cout << "Could not load the endgame tablebase from \"" << argv[arg] << "\"\n";
+            return 1;
+         }
+      }
+      // Load the opening book, if a book file has been given
+      else if( (option == "-book") && (arg+1 < argc) )
+      {
+         if( !CBoard::LoadOpeningBook(argv[++arg]) )
+         {
+            std::cout << "Could not load the opening book from \"" << argv[arg] << "\"\n";
+            return 1;
+         }
+      }
+      else if( option == "-noponder" )
+      {
+         ponder = false;
+      }
+      else if( option == "-stats" )
+      {
+         showStats = true;
+      }
+      // Set the number of threads that the Monte Carlo AI searches with
+      else if( (option == "-threads") && (arg+1 < argc) )
+      {
+         mctsThreads = (unsigned int)std::max(1, std::atoi(argv[++arg]));
+      }
+      // Record a timeline of the AI's searches
+      else if( (option == "-trace") && (arg+1 < argc) )
+      {
+         traceFilename = argv[++arg];
+#ifdef DRAUGHTS_TRACE
+         CTracer::Instance().Enable(true);
+#else
+         std::cout << "Tracing is not compiled in (compile with -DDRAUGHTS_TRACE)\n";
+         return 1;
+#endif
+      }
+      // Play on a smaller board
+      else if( (option == "-variant") && (arg+1 < argc) )
+      {
+         const std::string variantName = argv[++arg];
+         if( variantName == "8x8" )       variant = CBoard::VARIANT_8X8;
+         else if( variantName == "7x7" )  variant = CBoard::VARIANT_7X7;
+         else if( variantName == "6x6" )  variant = CBoard::VARIANT_6X6;
+         else
+         {
+            std::cout << "Variant \"" << variantName << "\" not recognised (8x8, 7x7 or 6x6)\n";
+            return 1;
+         }
+      }
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+
+   // Start reading the user's input
+   std::thread(ReadUserInput).detach();
+
    // random number generator to use later in the program
    CRandomRS rng;
    //// Set the range of the random number generator
@@ -91,7 +370,7 @@ int main()
    std::cout << "\n~~Welcome to Rob's Draughts!~~";
    std::cout << "\n~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n";
    // Create the checkers board
-   CBoard board;
+   CBoard board(variant);
    
    //bool isXTurn = true; // Initialise the game to X having the first turn
    //bool prevLoopIsXTurn = true;//false; // Used to check whether a turnover has occurred (if so, CalculateAllMoves must be called)
@@ -105,6 +384,8 @@ int main()
    bool isNewGame = true;
    bool singlePlayer = false; // bool to signal whether it is a 1-player or 2-player game
    bool aiIsX = true;         // bool to signal which side the AI is controlling (if 1-player game)
+   CAIHandle ponderSearch;    // The AI's search during the user's turn (if pondering)
+   std::unique_ptr<CAllocationMeter> gameAllocations;   // Memory allocated during the game (see allocations.h)
    
    // Define the letters for each command
    constexpr char userInput[NUM_COMMANDS] = {'w',  // UP,
@@ -126,6 +407,12 @@ int main()
 
       if( isNewGame )
       {
+         // Anything that the AI worked out during the last game is no longer needed
+         ponderSearch = CAIHandle();
+         // (the last game's meter is finished with first, so that it is not measuring at the same time)
+         gameAllocations.reset();
+         gameAllocations.reset( new CAllocationMeter );
+
          // Query how many players (only affects the behaviour of the code in this function)
          std::cout << "\nPlease enter the number of players followed by return (1/2): ";
          command = GetUserInput();
@@ -145,8 +432,8 @@ int main()
             }
 
             // Query what the personality of the AI should be
-            std::cout << "AI personality types are: Moderate(m) / Aggressive(a) / Cautious(c) / Generous(g) / Stupid(s)\n";
-            std::cout << "What type of AI would you like to face (m/a/c/g/s)? ";
+            std::cout << "AI personality types are: Moderate(m) / Aggressive(a) / Cautious(c) / Generous(g) / Monte Carlo(t) / Stupid(s)\n";
+            std::cout << "What type of AI would you like to face (m/a/c/g/t/s)? ";
             command = GetUserInput();
 
             aiIntelligence = 5;  // Default AI intelligence is 5 - will be overridden if a stupid AI is chosen
@@ -165,6 +452,24 @@ int main()
                case 'g':
                   board.SetAIGenerous();
                   break;
+               case 't':
+               {
+                  // Query how the Monte Carlo AI should play out its games
+                  std::cout << "Monte Carlo playouts are: Light(l) / Random(r) / Batch(b) / Light with move priors(p)\n";
+                  std::cout << "Which playouts should the AI use (l/r/b/p)? ";
+                  command = GetUserInput();
+                  int rollout = CMctsEngine::LIGHT_ROLLOUT;
+                  int selection = CMctsEngine::UCT;
+                  if( command == 'r' )
+                     rollout = CMctsEngine::RANDOM_ROLLOUT;
+                  else if( command == 'b' )
+                     rollout = CMctsEngine::BATCH_ROLLOUT;
+                  else if( command == 'p' )
+                     selection = CMctsEngine::PUCT;
+                  // 5000 playouts, or 1s, whichever comes first
+                  board.SetAIMonteCarlo(5000, 1000, mctsThreads, rollout, selection);
+                  break;
+               }
                default: // case 's'
                   // Acknowledge if an invalid type was selected, and default to a stupid AI
                   if( command != 's' )
@@ -196,18 +501,59 @@ int main()
 
       // Check to see if any moves are left for the current player - if not, then the other player has won the game
       if( !(board.CurrentSideHasMoves()) )
+      {
          std::cout << "\n\n~~~~ " << (board.IsXTurn()?"O":"X") << " Wins!!" << " ~~~~\n";
+         if( showStats && CAllocations::Counting() )
+         {
+            const CAllocationCounts counts = gameAllocations->Counts();
+            std::cout << "Game allocations: " << counts.allocations << " (" << counts.bytes << " bytes, peak "
+                      << counts.peakLiveBytes << " bytes in use)\n";
+         }
+      }
 
       if( singlePlayer && (board.IsXTurn() == aiIsX) && board.CurrentSideHasMoves() )
       {
          // It is the AI's turn
-         std::cout << "\n~~~~ AI\'s turn. ~~~~\n";
+         std::cout << "\n~~~~ AI\'s turn (press return to make the AI move now). ~~~~\n";
          
-         aiSuccess = board.InvokeAI( /*isXTurn ,*/ aiIntelligence );
+         // The AI thinks on its own thread, so show that it is thinking & let the user cut the search short
+         // If the AI has been pondering, then the pondering carries on as the search for the AI's move
+         CAIHandle aiSearch;
+         if( ponderSearch.IsActive() )
+         {
+            ponderSearch.OpponentMoved(board);
+            aiSearch = std::move(ponderSearch);
+         }
+         else
+         {
+            aiSearch = board.StartAI( CSearchLimits(aiIntelligence) );
+         }
+         while( !aiSearch.Poll() )
+         {
+            if( UserInputWithin(250) )
+               aiSearch.Stop();
+            else
+               std::cout << "." << std::flush;
+         }
+         std::cout << "\n";
+         const CBoard::CMove aiMove = aiSearch.Get();
+         if( showStats )
+            std::cout << aiSearch.Stats().Report();
+#ifdef DRAUGHTS_TRACE
+         if( !traceFilename.empty() && !CTracer::Instance().Flush(traceFilename) )
+            std::cout << "Could not write the trace to \"" << traceFilename << "\"\n";
+#endif
+         aiSuccess = aiMove.IsValid();
+         if( aiSuccess )
+            board.QueueMove(aiMove);
          board.ExecuteSelectedSquare( /*isXTurn*/ );
       }
       else
       {
+         // Let the AI think about its next move while the user decides on theirs
+         if( ponder && singlePlayer && board.CurrentSideHasMoves() && !ponderSearch.IsActive() )
+            ponderSearch = board.StartPonder( CSearchLimits(aiIntelligence) );
+
          // Prompt the user for a command
          std::cout << "\n\'"<<userInput[UP]     <<"\' = up, "
                       <<"\'"<<userInput[DOWN]   <<"\' = down, "
@@ -0,0 +1,88 @@
+// Definition of class functions for the evaluation weights
+
+#include "evaluation.h"
+
+#include <fstream>
+#include <sstream>
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the name of a feature
+// --------------------------------------------------------------------------- //
+
+const char *
+CEvalWeights::FeatureName(const int feature)
+{
+   static const char *names[NUM_EVAL_FEATURES] = { "men",
+                                                   "kings",
+                                                   "back_row",
+                                                   "advancement",
+                                                   "centre",
+                                                   "edge" };
+   if( (feature < 0) || (feature >= NUM_EVAL_FEATURES) )
+      return "";
+   return names[feature];
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to read the weights from a text file
+//   - Each line is "name value", blank lines & lines starting with '#' are ignored
+//   - The weights are only modified if the whole file is valid
+// --------------------------------------------------------------------------- //
+
+bool
+CEvalWeights::Load(const std::string &filename)
+{
+   std::ifstream file(filename.c_str());
+   if( !file )
+      return false;
+
+   CEvalWeights loaded = *this;
+   std::string line;
+   while( std::getline(file, line) )
+   {
+      std::istringstream lineStream(line);
+      std::string name;
+      int value;
+      if( !(lineStream >> name) || (name[0] == '#') )
+         continue;
+      if( !(lineStream >> value) )
+         return false;
+
+      if( name == "win_score" )
+      {
+         loaded.winScore = value;
+         continue;
+      }
+      int feature = 0;
+      while( (feature < NUM_EVAL_FEATURES) && (name != FeatureName(feature)) )
+         feature++;
+      if( feature == NUM_EVAL_FEATURES )
+         return false;
+      loaded.weights[feature] = value;
+   }
+
+   *this = loaded;
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to write the weights to a text file (in the format read by Load)
+// --------------------------------------------------------------------------- //
+
+bool
+CEvalWeights::Save(const std::string &filename) const
+{
+   std::ofstream file(filename.c_str());
+   if( !file )
+      return false;
+
+   file << "# Draughts evaluation weights\n";
+   for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+      file << FeatureName(feature) << " " << weights[feature] << "\n";
+   file << "win_score " << winScore << "\n";
+
+   return bool(file);
+}
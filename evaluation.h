@@ -0,0 +1,58 @@
+// Declaration of the weights used by the AI's static evaluation of a board
+
+#ifndef _EVALUATION_H
+#define _EVALUATION_H
+
+#include <string>
+
+
+// Features that make up the static evaluation of a board
+// Each feature is measured as (AI side's value) - (opponent's value), and the score is the weighted sum of the features
+enum EvalFeatures
+{
+   EVAL_MEN,          // Number of men
+   EVAL_KINGS,        // Number of kings
+   EVAL_BACK_ROW,     // Number of men still guarding their own back row
+   EVAL_ADVANCEMENT,  // Total number of rows that the men have advanced from their own back row
+   EVAL_CENTRE,       // Number of pieces in the central 4x2 block of squares
+   EVAL_EDGE,         // Number of pieces on the left or right edge of the board
+   NUM_EVAL_FEATURES
+};
+
+
+// Class for holding (and loading/saving) the weight of each evaluation feature
+class CEvalWeights
+{
+   public:
+      // Constructor - the default weights are the original "+1 per piece, +/-100 for a win" scoring
+      CEvalWeights() : winScore(100)
+      {
+         for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+            weights[feature] = 0;
+         weights[EVAL_MEN] = 1;
+         weights[EVAL_KINGS] = 1;
+      }
+
+      // Functions to read/write the weights as a text file of "name value" lines (returns false if the file could not be used)
+      //   Unknown names are rejected, and features that are missing from the file keep their current weight
+      bool Load(const std::string &filename);
+      bool Save(const std::string &filename) const;
+
+      // Function to get the name of a feature, as used in the weights file
+      static const char *FeatureName(const int feature);
+
+      // Weighted sum of a set of features
+      int Score(const int features[NUM_EVAL_FEATURES]) const
+      {
+         int score = 0;
+         for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+            score += weights[feature]*features[feature];
+         return score;
+      }
+
+      int weights[NUM_EVAL_FEATURES];
+      int winScore;  // Score for a won game (and -winScore for a lost game)
+};
+
+
+#endif
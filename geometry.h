@@ -0,0 +1,286 @@
+// Declaration of the compile-time board geometries for the bitboard rules engines (see rules.h)
+
+#ifndef _GEOMETRY_H
+#define _GEOMETRY_H
+
+
+// --------------------------------------------------------------------------- //
+// Square sets ("masks"): one bit per playable square, in the narrowest type that holds the board
+//   - 32 squares (8x8) fit in 32 bits, 50 (10x10) in 64 bits, & 72 (12x12) in 128 bits, which is a compiler extension
+//     where there is one (GCC/Clang) & otherwise a pair of 64-bit words
+// --------------------------------------------------------------------------- //
+
+#if !defined(__SIZEOF_INT128__)
+// Pair of 64-bit words for the compilers that do not have a 128-bit integer
+struct CWideMask
+{
+   constexpr CWideMask(const unsigned long long _low = 0, const unsigned long long _high = 0) : low(_low), high(_high) {}
+
+   constexpr CWideMask operator|(const CWideMask &rhs) const { return CWideMask(low | rhs.low, high | rhs.high); }
+   constexpr CWideMask operator&(const CWideMask &rhs) const { return CWideMask(low & rhs.low, high & rhs.high); }
+   constexpr CWideMask operator^(const CWideMask &rhs) const { return CWideMask(low ^ rhs.low, high ^ rhs.high); }
+   constexpr CWideMask operator~() const { return CWideMask(~low, ~high); }
+   CWideMask &operator|=(const CWideMask &rhs) { low |= rhs.low; high |= rhs.high; return *this; }
+   CWideMask &operator&=(const CWideMask &rhs) { low &= rhs.low; high &= rhs.high; return *this; }
+   CWideMask &operator^=(const CWideMask &rhs) { low ^= rhs.low; high ^= rhs.high; return *this; }
+   constexpr bool operator==(const CWideMask &rhs) const { return (low == rhs.low) && (high == rhs.high); }
+   constexpr bool operator!=(const CWideMask &rhs) const { return !(*this == rhs); }
+   constexpr explicit operator bool() const { return (low | high) != 0; }
+
+   unsigned long long low;
+   unsigned long long high;
+};
+#endif
+
+// Mask type & bit functions for a board with N playable squares
+template<unsigned int N, bool FITS_32 = (N <= 32), bool FITS_64 = (N <= 64)> struct CMaskTraits;
+
+template<unsigned int N> struct CMaskTraits<N, true, true>
+{
+   typedef unsigned int Mask;
+   static constexpr Mask Bit(const unsigned int square) { return Mask(1) << square; }
+   static unsigned int Count(const Mask mask) { return __builtin_popcount(mask); }
+   static unsigned int Lowest(const Mask mask) { return __builtin_ctz(mask); }   // mask must not be 0
+   static unsigned int Highest(const Mask mask) { return 31 - __builtin_clz(mask); }
+};
+
+template<unsigned int N> struct CMaskTraits<N, false, true>
+{
+   typedef unsigned long long Mask;
+   static constexpr Mask Bit(const unsigned int square) { return Mask(1) << square; }
+   static unsigned int Count(const Mask mask) { return __builtin_popcountll(mask); }
+   static unsigned int Lowest(const Mask mask) { return __builtin_ctzll(mask); }
+   static unsigned int Highest(const Mask mask) { return 63 - __builtin_clzll(mask); }
+};
+
+template<unsigned int N> struct CMaskTraits<N, false, false>
+{
+   static_assert( N <= 128, "Boards with more than 128 playable squares are not supported" );
+#if defined(__SIZEOF_INT128__)
+   typedef unsigned __int128 Mask;
+   static constexpr Mask Bit(const unsigned int square) { return Mask(1) << square; }
+   static unsigned int Count(const Mask mask)
+   {
+      return __builtin_popcountll((unsigned long long)(mask)) + __builtin_popcountll((unsigned long long)(mask >> 64));
+   }
+   static unsigned int Lowest(const Mask mask)
+   {
+      return ( (unsigned long long)(mask) != 0 ? __builtin_ctzll((unsigned long long)(mask))
+                                               : 64 + __builtin_ctzll((unsigned long long)(mask >> 64)) );
+   }
+   static unsigned int Highest(const Mask mask)
+   {
+      return ( (unsigned long long)(mask >> 64) != 0 ? 127 - __builtin_clzll((unsigned long long)(mask >> 64))
+                                                     : 63 - __builtin_clzll((unsigned long long)(mask)) );
+   }
+#else
+   typedef CWideMask Mask;
+   static constexpr Mask Bit(const unsigned int square)
+   {
+      return ( square < 64 ? CWideMask(1ULL << square, 0) : CWideMask(0, 1ULL << (square - 64)) );
+   }
+   static unsigned int Count(const Mask mask) { return __builtin_popcountll(mask.low) + __builtin_popcountll(mask.high); }
+   static unsigned int Lowest(const Mask mask)
+   {
+      return ( mask.low != 0 ? __builtin_ctzll(mask.low) : 64 + __builtin_ctzll(mask.high) );
+   }
+   static unsigned int Highest(const Mask mask)
+   {
+      return ( mask.high != 0 ? 127 - __builtin_clzll(mask.high) : 63 - __builtin_clzll(mask.low) );
+   }
+#endif
+};
+
+
+// --------------------------------------------------------------------------- //
+// Compile-time list of the numbers 0 to N-1, for filling a table from a constexpr function (C++11 has no loops in
+//   constexpr functions, so each table is built by expanding the list)
+// --------------------------------------------------------------------------- //
+
+template<unsigned int... I> struct CIndexList {};
+template<unsigned int N, unsigned int... I> struct CMakeIndexList : CMakeIndexList<N-1, N-1, I...> {};
+template<unsigned int... I> struct CMakeIndexList<0, I...> { typedef CIndexList<I...> Type; };
+
+// Table of Function::Get(i) for i = 0 to N-1, worked out by the compiler
+template<typename T, typename Function, unsigned int N, typename Indices = typename CMakeIndexList<N>::Type> struct CConstexprTable;
+
+template<typename T, typename Function, unsigned int N, unsigned int... I>
+struct CConstexprTable< T, Function, N, CIndexList<I...> >
+{
+   static constexpr T values[N] = { Function::Get(I)... };
+};
+
+template<typename T, typename Function, unsigned int N, unsigned int... I>
+constexpr T CConstexprTable< T, Function, N, CIndexList<I...> >::values[N];
+
+
+// --------------------------------------------------------------------------- //
+// Board geometry: a WIDTH x HEIGHT board (WIDTH must be even) on which each side starts with PIECES men
+//   - The playable squares are those where (x+y) is odd (as in CBoard's layout 1), numbered 0 upwards in scan order, so
+//     each row has WIDTH/2 of them & square s is on row s / (WIDTH/2)
+//   - X's men move towards y = HEIGHT-1 & O's men towards y = 0
+//   - The directions are numbered in the same order as CBoard::PopulateMoves: (-1,+1), (+1,+1), (-1,-1), (+1,-1)
+//   - Every table (neighbours, jumps, rays & rows) is worked out by the compiler, so a lookup is a single load
+// --------------------------------------------------------------------------- //
+
+template<unsigned int W, unsigned int H, unsigned int P>
+struct CGeometry
+{
+   static_assert( (W % 2) == 0, "The board width must be even" );
+
+   static const unsigned int WIDTH = W;
+   static const unsigned int HEIGHT = H;
+   static const unsigned int PIECES = P;
+   static const unsigned int ROW_SQUARES = W/2;
+   static const unsigned int NUM_SQUARES = (W/2)*H;
+   static const unsigned int NUM_DIRECTIONS = 4;
+
+   typedef CMaskTraits<NUM_SQUARES> Traits;
+   typedef typename Traits::Mask Mask;
+
+   // Coordinates of a square, & the square at some coordinates (-1 = off the board or not playable)
+   static constexpr int X(const int square) { return 2*(square % int(ROW_SQUARES)) + (((square / int(ROW_SQUARES)) & 1) ^ 1); }
+   static constexpr int Y(const int square) { return square / int(ROW_SQUARES); }
+   static constexpr int Square(const int x, const int y)
+   {
+      return ( (x >= 0) && (x < int(W)) && (y >= 0) && (y < int(H)) && (((x + y) & 1) == 1) ? y*int(ROW_SQUARES) + x/2 : -1 );
+   }
+   static constexpr int DX(const unsigned int direction) { return ( (direction & 1) ? 1 : -1 ); }
+   static constexpr int DY(const unsigned int direction) { return ( (direction & 2) ? -1 : 1 ); }
+
+   // Square that is "distance" steps from a square in a direction (-1 = off the board)
+   static constexpr int Step(const int square, const unsigned int direction, const int distance)
+   {
+      return Square( X(square) + distance*DX(direction), Y(square) + distance*DY(direction) );
+   }
+
+   // Squares in a direction from a square, up to the edge of the board (the square itself is not included)
+   static constexpr Mask Ray(const int square, const unsigned int direction)
+   {
+      return ( Step(square, direction, 1) < 0 ? Mask(0)
+                                              : Traits::Bit(Step(square, direction, 1)) | Ray(Step(square, direction, 1), direction) );
+   }
+
+   // All of the squares on row y
+   static constexpr Mask Row(const unsigned int y, const unsigned int count = ROW_SQUARES)
+   {
+      return ( count == 0 ? Mask(0) : Traits::Bit(y*ROW_SQUARES + count-1) | Row(y, count-1) );
+   }
+   // The squares on rows 0 to rows-1 (X's starting squares) or on the last "rows" rows (O's starting squares)
+   static constexpr Mask FirstRows(const unsigned int rows) { return ( rows == 0 ? Mask(0) : Row(rows-1) | FirstRows(rows-1) ); }
+   static constexpr Mask LastRows(const unsigned int rows) { return ( rows == 0 ? Mask(0) : Row(H-rows) | LastRows(rows-1) ); }
+
+   // Generators for the tables, indexed by direction*NUM_SQUARES + square
+   struct CNeighbourFunction { static constexpr signed char Get(const unsigned int i) { return (signed char)(Step(i % NUM_SQUARES, i / NUM_SQUARES, 1)); } };
+   struct CJumpFunction      { static constexpr signed char Get(const unsigned int i) { return (signed char)(Step(i % NUM_SQUARES, i / NUM_SQUARES, 2)); } };
+   struct CRayFunction       { static constexpr Mask Get(const unsigned int i) { return Ray(i % NUM_SQUARES, i / NUM_SQUARES); } };
+   struct CBitFunction       { static constexpr Mask Get(const unsigned int i) { return Traits::Bit(i); } };
+
+   // Table lookups
+   static int Neighbour(const unsigned int square, const unsigned int direction)
+   {
+      return CConstexprTable<signed char, CNeighbourFunction, NUM_DIRECTIONS*NUM_SQUARES>::values[direction*NUM_SQUARES + square];
+   }
+   static int Jump(const unsigned int square, const unsigned int direction)
+   {
+      return CConstexprTable<signed char, CJumpFunction, NUM_DIRECTIONS*NUM_SQUARES>::values[direction*NUM_SQUARES + square];
+   }
+   static Mask RayMask(const unsigned int square, const unsigned int direction)
+   {
+      return CConstexprTable<Mask, CRayFunction, NUM_DIRECTIONS*NUM_SQUARES>::values[direction*NUM_SQUARES + square];
+   }
+   static Mask Bit(const unsigned int square) { return CConstexprTable<Mask, CBitFunction, NUM_SQUARES>::values[square]; }
+
+   static unsigned int Count(const Mask mask) { return Traits::Count(mask); }
+   static unsigned int Lowest(const Mask mask) { return Traits::Lowest(mask); }
+   static unsigned int Highest(const Mask mask) { return Traits::Highest(mask); }
+   // The nearest square of a set that lies on a ray from some square in "direction" (the rays of directions 0 & 1 run
+   //   up the board, so their nearest square has the lowest number)
+   static unsigned int Nearest(const Mask mask, const unsigned int direction)
+   {
+      return ( direction < 2 ? Traits::Lowest(mask) : Traits::Highest(mask) );
+   }
+
+   // Rows that each side's men are crowned on, & the starting squares (the rows at each end that hold PIECES men)
+   static constexpr Mask X_CROWN_ROW = Row(H-1);
+   static constexpr Mask O_CROWN_ROW = Row(0);
+   static constexpr Mask X_START = FirstRows(P / ROW_SQUARES);
+   static constexpr Mask O_START = LastRows(P / ROW_SQUARES);
+   static_assert( (P % ROW_SQUARES) == 0, "The starting pieces must fill whole rows" );
+   static_assert( 2*(P / ROW_SQUARES) < H, "The starting pieces must leave an empty row in the middle" );
+};
+
+template<unsigned int W, unsigned int H, unsigned int P> constexpr typename CGeometry<W,H,P>::Mask CGeometry<W,H,P>::X_CROWN_ROW;
+template<unsigned int W, unsigned int H, unsigned int P> constexpr typename CGeometry<W,H,P>::Mask CGeometry<W,H,P>::O_CROWN_ROW;
+template<unsigned int W, unsigned int H, unsigned int P> constexpr typename CGeometry<W,H,P>::Mask CGeometry<W,H,P>::X_START;
+template<unsigned int W, unsigned int H, unsigned int P> constexpr typename CGeometry<W,H,P>::Mask CGeometry<W,H,P>::O_START;
+
+
+// The supported boards: the standard 8x8 game, international draughts (10x10) & Canadian draughts (12x12)
+typedef CGeometry<8, 8, 12>   CGeometry8x8;
+typedef CGeometry<10, 10, 20> CGeometry10x10;
+typedef CGeometry<12, 12, 30> CGeometry12x12;
+
+
+// --------------------------------------------------------------------------- //
+// Links between the squares of CBoard, which keeps every square of a SIZE x SIZE board (playable or not) in scan order
+//   - For each square & direction (numbered as for CGeometry): the neighbouring square & the square beyond it that a
+//     jump lands on (-1 = off the board), with bit "direction" of neighbourMask/jumpMask set where they are on the board
+//     (CBoard::PopulateMoves walks the set bits of neighbourMask, so it only visits the directions that stay on the board)
+//   - influenceMask has a bit (numbered y*SIZE + x) for each square whose contents decide the piece's moves: the square
+//     itself & its neighbour & jump squares
+//   - A table is worked out by the compiler for each size, so finding the moves of a piece needs no coordinate arithmetic
+//     or bounds checks
+// --------------------------------------------------------------------------- //
+
+struct CSquareLinks
+{
+   unsigned long long influenceMask;
+   unsigned char neighbourMask;
+   unsigned char jumpMask;
+   signed char neighbour[4];
+   signed char jump[4];
+};
+
+template<unsigned int SIZE>
+struct CGridLinks
+{
+   static_assert( SIZE*SIZE <= 64, "The squares must fit in a 64-bit mask" );
+
+   static constexpr int DX(const unsigned int direction) { return ( (direction & 1) ? 1 : -1 ); }
+   static constexpr int DY(const unsigned int direction) { return ( (direction & 2) ? -1 : 1 ); }
+
+   // Square that is "distance" steps from a square in a direction (-1 = off the board)
+   static constexpr int Step(const unsigned int square, const unsigned int direction, const int distance)
+   {
+      return ( (int(square % SIZE) + distance*DX(direction) >= 0) && (int(square % SIZE) + distance*DX(direction) < int(SIZE)) &&
+               (int(square / SIZE) + distance*DY(direction) >= 0) && (int(square / SIZE) + distance*DY(direction) < int(SIZE))
+               ? int(square) + distance*(DY(direction)*int(SIZE) + DX(direction)) : -1 );
+   }
+   static constexpr unsigned char Mask(const unsigned int square, const int distance)
+   {
+      return (unsigned char)( (Step(square, 0, distance) >= 0 ? 1 : 0) | (Step(square, 1, distance) >= 0 ? 2 : 0) |
+                              (Step(square, 2, distance) >= 0 ? 4 : 0) | (Step(square, 3, distance) >= 0 ? 8 : 0) );
+   }
+
+   static constexpr unsigned long long Bit(const int square) { return ( square >= 0 ? 1ULL << square : 0ULL ); }
+   static constexpr unsigned long long Influence(const unsigned int square)
+   {
+      return Bit(square) | Bit(Step(square, 0, 1)) | Bit(Step(square, 1, 1)) | Bit(Step(square, 2, 1)) | Bit(Step(square, 3, 1)) |
+                           Bit(Step(square, 0, 2)) | Bit(Step(square, 1, 2)) | Bit(Step(square, 2, 2)) | Bit(Step(square, 3, 2));
+   }
+
+   static constexpr CSquareLinks Get(const unsigned int square)
+   {
+      return { Influence(square), Mask(square, 1), Mask(square, 2),
+               { (signed char)(Step(square, 0, 1)), (signed char)(Step(square, 1, 1)),
+                 (signed char)(Step(square, 2, 1)), (signed char)(Step(square, 3, 1)) },
+               { (signed char)(Step(square, 0, 2)), (signed char)(Step(square, 1, 2)),
+                 (signed char)(Step(square, 2, 2)), (signed char)(Step(square, 3, 2)) } };
+   }
+
+   static const CSquareLinks *Table() { return CConstexprTable<CSquareLinks, CGridLinks, SIZE*SIZE>::values; }
+};
+
+
+#endif
@@ -207,6 +207,10 @@ key(unsigned char c, int x, int y)
    {
       scene.UserInputSelect();
    }
+   else if( c == 'i' ) // Show/hide the statistics of the AI's last search
+   {
+      scene.ToggleSearchStats();
+   }
 }
 
 
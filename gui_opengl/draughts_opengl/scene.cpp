@@ -50,6 +50,7 @@ Scene::Scene()
   boardLayout(1),
   timeAIStart(0.0f),
   aiHasDecided(false),
+  showSearchStats(false),
   angle(0.0f),
   anglePerSecond(2*PI),
   time(0.0f)
@@ -109,12 +110,19 @@ Scene::ToggleAISide()
 void
 Scene::ToggleLayout()
 {
+   // Abandon any search that the AI is doing on the old board
+   aiSearch = CAIHandle();
+   ponderSearch = CAIHandle();
    boardLayout = !boardLayout;
    board.SetLayoutAndReset(boardLayout);
 }
 
 void Scene::ResetBoard()
 {
+   // Abandon any search that the AI is doing on the old board
+   aiSearch = CAIHandle();
+   ponderSearch = CAIHandle();
+
    // Set the board up with some random parameters
    // random number generator to use later in the program
    CRandomRS rng;
@@ -605,10 +613,47 @@ Scene::RenderBoard()
    glEnable(GL_DEPTH_TEST);
 
    // Invoke the AI if necessary
-   // First get the AI to work out the best move, then after 1 second make the move
-   if( !aiHasDecided && singlePlayer && (board.IsXTurn() == aiIsX) && board.CurrentSideHasMoves() )
+   // First get the AI to work out the best move (on its own thread, so that rendering carries on), then after 0.5 seconds make the move
+   //   (if the AI has been pondering during the user's turn, then the pondering carries on as the search for the AI's move)
+   if( !aiHasDecided && !aiSearch.IsActive() && singlePlayer && (board.IsXTurn() == aiIsX) && board.CurrentSideHasMoves() )
    {
-      /*aiSuccess = */board.InvokeAI( /*isXTurn ,*/ aiIntelligence );
+      if( ponderSearch.IsActive() )
+      {
+         ponderSearch.OpponentMoved(board);
+         aiSearch = std::move(ponderSearch);
+      }
+      else
+      {
+         aiSearch = board.StartAI( CSearchLimits(aiIntelligence) );
+      }
+   }
+   // Let the AI think about its next move while the user decides on theirs
+   else if( !aiHasDecided && !ponderSearch.IsActive() && singlePlayer && (board.IsXTurn() != aiIsX) && board.CurrentSideHasMoves() )
+   {
+      ponderSearch = board.StartPonder( CSearchLimits(aiIntelligence) );
+   }
+   if( aiSearch.Poll() )
+   {
+      const CBoard::CMove aiMove = aiSearch.Get();
+      if( aiMove.IsValid() )
+         board.QueueMove(aiMove);
+      const CSearchStats &stats = aiSearch.Stats();
+      char line[64];
+      if( stats.playouts > 0 )
+      {
+         std::snprintf(line, sizeof(line), "%u playouts", stats.playouts);
+         sSearchStats[0] = line;
+         std::snprintf(line, sizeof(line), "%.0f ms", stats.elapsedMs);
+         sSearchStats[1] = line;
+      }
+      else
+      {
+         std::snprintf(line, sizeof(line), "Depth %d/%u, %llu nodes", stats.depth, stats.maxPly, stats.nodes);
+         sSearchStats[0] = line;
+         std::snprintf(line, sizeof(line), "%.0f ms, %.0f kn/s, EBF %.1f, TT %.0f%%", stats.elapsedMs,
+                       stats.NodesPerSecond()/1000, stats.EffectiveBranchingFactor(), 100*stats.TTHitRate());
+         sSearchStats[1] = line;
+      }
       timeAIStart = time;
       aiHasDecided = true;
    }
@@ -789,16 +834,31 @@ Scene::RenderBoard()
    // Render Text
    // --------------------------------------------------------------------- //
 
-   // Title
+   // Title (or the statistics of the AI's last search in its place, if they have been turned on with the 'i' key)
    prog_text.Use();
    prog_text.SetUniform("bUseAlpha", 1);
    prog_text.SetUniform("foregroundColour", glm::vec3(0.0f, 0.0f, 0.0f));
-   model = glm::mat4(1.0f);
-   model *= glm::translate( glm::vec3(0.0f, 1.125f, 1.0f) );  // Bottom-left corner of the text to be rendered
-   model *= glm::scale( glm::vec3(0.125, 0.125, 1.0f) );    // Each character is 0.5f x 1.0f, so must be scaled up/down to a suitable size
-   setMatrices();
-   text.ResetTextPos();
-   text.RenderString("Draughts");
+   if( showSearchStats && !sSearchStats[0].empty() )
+   {
+      for( unsigned int line = 0 ; line < 2 ; line++ )
+      {
+         model = glm::mat4(1.0f);
+         model *= glm::translate( glm::vec3(0.0f, 1.19f - 0.05f*line, 1.0f) );  // Bottom-left corner of the text to be rendered
+         model *= glm::scale( glm::vec3(0.04, 0.04, 1.0f) );    // Each character is 0.5f x 1.0f, so must be scaled up/down to a suitable size
+         setMatrices();
+         text.ResetTextPos();
+         text.RenderString( sSearchStats[line] );
+      }
+   }
+   else
+   {
+      model = glm::mat4(1.0f);
+      model *= glm::translate( glm::vec3(0.0f, 1.125f, 1.0f) );  // Bottom-left corner of the text to be rendered
+      model *= glm::scale( glm::vec3(0.125, 0.125, 1.0f) );    // Each character is 0.5f x 1.0f, so must be scaled up/down to a suitable size
+      setMatrices();
+      text.ResetTextPos();
+      text.RenderString("Draughts");
+   }
 
    // AI Info
    //prog_text.Use();
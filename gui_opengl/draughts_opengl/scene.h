@@ -88,6 +88,9 @@ private:
 
    float timeAIStart;   // Counter to wait for 1s before making the AI's move
    bool aiHasDecided;
+   CAIHandle aiSearch;  // The AI's search, which runs on its own thread so that the window keeps responding
+   CAIHandle ponderSearch; // The AI's search during the user's turn ("pondering")
+   bool showSearchStats;   // Whether to show the statistics of the AI's last search
 
    glm::vec3 colourX;	// Colour of the X pieces
    glm::vec3 colourO;	// Colour of the O pieces
@@ -98,6 +101,7 @@ private:
    std::string sAISide;
    std::string sTurn;
    std::string sGameOver;
+   std::string sSearchStats[2];   // Two lines of the statistics of the AI's last search
 
    // Standard matrices
    glm::mat4 model, view, projection;
@@ -142,11 +146,12 @@ public:
    void ToggleLayout();
 
    // Functions to process user-input
-   void UserInputUp()      { if( !aiHasDecided ) board.MoveSelectSquareUp(); }
-   void UserInputDown()    { if( !aiHasDecided ) board.MoveSelectSquareDown(); }
-   void UserInputLeft()    { if( !aiHasDecided ) board.MoveSelectSquareLeft(); }
-   void UserInputRight()   { if( !aiHasDecided ) board.MoveSelectSquareRight(); }
-   void UserInputSelect()  { if( !aiHasDecided ) board.ExecuteSelectedSquare(); }
+   void UserInputUp()      { if( !aiHasDecided && !aiSearch.IsActive() ) board.MoveSelectSquareUp(); }
+   void UserInputDown()    { if( !aiHasDecided && !aiSearch.IsActive() ) board.MoveSelectSquareDown(); }
+   void UserInputLeft()    { if( !aiHasDecided && !aiSearch.IsActive() ) board.MoveSelectSquareLeft(); }
+   void UserInputRight()   { if( !aiHasDecided && !aiSearch.IsActive() ) board.MoveSelectSquareRight(); }
+   void UserInputSelect()  { if( !aiHasDecided && !aiSearch.IsActive() ) board.ExecuteSelectedSquare(); }
+   void ToggleSearchStats() { showSearchStats = !showSearchStats; }
 
    void ClickLocation(const int _mouseX, const int _mouseY)
    {
@@ -0,0 +1,117 @@
+// Simple read-only memory-mapped file class
+
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>   // std::size_t
+
+#ifdef _WIN32
+// (without the min & max macros, which would break std::min & std::max in every file that includes this one)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+class CMappedFile
+{
+   public:
+      // Constructors
+      CMappedFile() : data(0), size(0)
+#ifdef _WIN32
+                    , fileHandle(INVALID_HANDLE_VALUE), mappingHandle(0)
+#endif
+      {}
+      ~CMappedFile() { Close(); }
+
+      // Function to map the whole of a file into memory (returns false if the file could not be mapped)
+      bool Open(const std::string &filename)
+      {
+         Close();
+#ifdef _WIN32
+         fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+         if( fileHandle == INVALID_HANDLE_VALUE )
+            return false;
+         LARGE_INTEGER fileSize;
+         if( !GetFileSizeEx(fileHandle, &fileSize) || (fileSize.QuadPart == 0) )
+         {
+            Close();
+            return false;
+         }
+         mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+         if( mappingHandle != 0 )
+            data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+         if( data == 0 )
+         {
+            Close();
+            return false;
+         }
+         size = std::size_t(fileSize.QuadPart);
+#else
+         const int fd = open(filename.c_str(), O_RDONLY);
+         if( fd < 0 )
+            return false;
+         struct stat fileStat;
+         if( (fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0) )
+         {
+            close(fd);
+            return false;
+         }
+         void *mapped = mmap(0, std::size_t(fileStat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+         close(fd);  // The mapping keeps its own reference to the file
+         if( mapped == MAP_FAILED )
+            return false;
+         data = static_cast<const char*>(mapped);
+         size = std::size_t(fileStat.st_size);
+#endif
+         return true;
+      }
+
+      // Function to unmap the file (safe to call if nothing is mapped)
+      void Close()
+      {
+#ifdef _WIN32
+         if( data != 0 )
+            UnmapViewOfFile(data);
+         if( mappingHandle != 0 )
+            CloseHandle(mappingHandle);
+         if( fileHandle != INVALID_HANDLE_VALUE )
+            CloseHandle(fileHandle);
+         fileHandle = INVALID_HANDLE_VALUE;
+         mappingHandle = 0;
+#else
+         if( data != 0 )
+            munmap(const_cast<char*>(data), size);
+#endif
+         data = 0;
+         size = 0;
+      }
+
+      bool IsOpen() const { return data != 0; }
+      const char *Data() const { return data; }
+      std::size_t Size() const { return size; }
+
+   private:
+      // A mapping cannot be shared between two objects, so copying is not allowed
+      CMappedFile(const CMappedFile &);
+      CMappedFile &operator=(const CMappedFile &);
+
+      const char *data;
+      std::size_t size;
+#ifdef _WIN32
+      HANDLE fileHandle;
+      HANDLE mappingHandle;
+#endif
+};
+
+#endif
@@ -0,0 +1,421 @@
+// Definition of class functions for the Monte Carlo tree search AI
+
+#include "mcts.h"
+#include "bitslice.h"
+#include "trace.h"
+
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <thread>
+
+
+// Maximum number of moves in a playout before the game is counted as a draw
+static const unsigned int MAX_ROLLOUT_MOVES = 300;
+// Maximum number of moves between searches that the tree can be reused over (the AI's moves & the opponent's reply,
+//   allowing for multi-jumps)
+static const unsigned int MAX_REUSE_DEPTH = 6;
+
+
+CMctsEngine::CMctsEngine(const unsigned int _maxNodes, const unsigned int _numThreads)
+ : pool(new CNode[_maxNodes > 1 ? _maxNodes : 1]),
+   sparePool(new CNode[_maxNodes > 1 ? _maxNodes : 1]),
+   maxNodes(_maxNodes > 1 ? _maxNodes : 1),
+   numNodes(0),
+   haveTree(false),
+   numThreads(_numThreads > 0 ? _numThreads : 1),
+   selection(UCT),
+   rollout(LIGHT_ROLLOUT),
+   exploration(1.4),
+   seed(0),
+   playoutsStarted(0),
+   playoutsCompleted(0),
+   lastPlayouts(0),
+   lastSearchReusedTree(false)
+{
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to search from the given board & choose a move
+// --------------------------------------------------------------------------- //
+
+bool
+CMctsEngine::Search(const CBoard &board, unsigned int playouts, const int maxTimeMs, CBoard::CMove &bestMove,
+                    const std::atomic<bool> *stop)
+{
+   TRACE_SPAN("MctsSearch");
+   if( !(board.CurrentSideHasMoves()) && !(board.InMultiTurnSequence()) )
+      return false;
+
+   // A search needs at least one limit
+   if( (playouts == 0) && (maxTimeMs <= 0) )
+      playouts = 1000;
+
+   // Keep the part of the previous tree that starts from this board, or else start a new tree
+   lastSearchReusedTree = haveTree && ReuseTree(board);
+   if( !lastSearchReusedTree )
+   {
+      CNode &root = pool[0];
+      root.move = CBoard::CMove();
+      root.moverIsX = !(board.IsXTurn());
+      root.visits = 0;
+      root.score = 0;
+      root.virtualLoss = 0;
+      root.state = UNEXPANDED;
+      root.numChildren = 0;
+      numNodes = 1;
+   }
+   // Only the position is kept: the board's pointer to this engine would make the engine own itself (so it would never
+   //   be freed), & every playout's copy of the board would update the pointer's count
+   rootBoard = board;
+   rootBoard.mctsEngine.reset();
+   haveTree = true;
+
+   // The root is expanded up-front, so that every thread starts by choosing between the moves
+   CBoard expandBoard = rootBoard;
+   if( (pool[0].state != EXPANDED) && !Expand(pool[0], expandBoard) )
+      return false;
+   if( pool[0].numChildren == 0 )
+      return false;
+
+   // Run the search threads (the calling thread is one of them)
+   playoutsStarted = 0;
+   playoutsCompleted = 0;
+   std::random_device seedSource;
+   std::vector<std::thread> threads;
+   for( unsigned int thread = 1 ; thread < numThreads ; thread++ )
+      threads.push_back( std::thread( &CMctsEngine::SearchThread, this, ( seed != 0 ? seed + thread : seedSource() ),
+                                      playouts, maxTimeMs, stop ) );
+   SearchThread(( seed != 0 ? seed : seedSource() ), playouts, maxTimeMs, stop);
+   {
+      TRACE_SPAN("WaitForSearchThreads");
+      for( unsigned int thread = 0 ; thread < threads.size() ; thread++ )
+         threads[thread].join();
+   }
+   lastPlayouts = playoutsCompleted;
+
+   // Choose the most visited move (using the score to break ties)
+   const CNode &root = pool[0];
+   unsigned int best = root.firstChild;
+   for( unsigned int child = root.firstChild+1 ; child < root.firstChild + root.numChildren ; child++ )
+   {
+      if( (pool[child].visits > pool[best].visits) ||
+          ((pool[child].visits == pool[best].visits) && (pool[child].score > pool[best].score)) )
+         best = child;
+   }
+   bestMove = pool[best].move;
+
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function that each search thread runs
+// --------------------------------------------------------------------------- //
+
+void
+CMctsEngine::SearchThread(const unsigned int seed, const unsigned int maxPlayouts, const int maxTimeMs, const std::atomic<bool> *stop)
+{
+   TRACE_SPAN("MctsSearchThread");
+   std::minstd_rand rng(seed);
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   std::vector<unsigned int> path;
+   path.reserve(64);
+
+   while( true )
+   {
+      // Stop once the playout budget has been used up, the time limit has been reached, or a stop has been requested
+      if( (stop != 0) && stop->load(std::memory_order_relaxed) )
+         break;
+      const unsigned int gamesPerPlayout = ( rollout == BATCH_ROLLOUT ? CBitSlicedPlayouts<unsigned long long>::LANES : 1 );
+      if( (maxPlayouts > 0) && (playoutsStarted.fetch_add(gamesPerPlayout) >= maxPlayouts) )
+         break;
+      if( (maxTimeMs > 0) &&
+          (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() >= maxTimeMs) )
+         break;
+
+      // Selection: walk down the tree, adding a virtual loss to each node so that other threads prefer other paths
+      CBoard board = rootBoard;
+      path.clear();
+      unsigned int nodeIndex = 0;
+      path.push_back(nodeIndex);
+      pool[nodeIndex].virtualLoss++;
+      while( pool[nodeIndex].state == EXPANDED && pool[nodeIndex].numChildren > 0 )
+      {
+         nodeIndex = SelectChild(pool[nodeIndex]);
+         board.MakeMove(pool[nodeIndex].move);
+         path.push_back(nodeIndex);
+         pool[nodeIndex].virtualLoss++;
+      }
+
+      // Expansion: create the children of the leaf & step into one of them
+      if( pool[nodeIndex].visits > 0 && Expand(pool[nodeIndex], board) && pool[nodeIndex].numChildren > 0 )
+      {
+         nodeIndex = SelectChild(pool[nodeIndex]);
+         board.MakeMove(pool[nodeIndex].move);
+         path.push_back(nodeIndex);
+         pool[nodeIndex].virtualLoss++;
+      }
+
+      // Simulation
+      unsigned int numGames = 1;
+      const unsigned int resultForX = ( rollout == BATCH_ROLLOUT ? BatchRollout(board, rng, numGames) : Rollout(board, rng) );
+
+      // Backpropagation: replace each virtual loss with the real result for the side that made the move
+      for( unsigned int step = 0 ; step < path.size() ; step++ )
+      {
+         CNode &node = pool[path[step]];
+         node.score += ( node.moverIsX ? resultForX : 2*numGames-resultForX );
+         node.visits += numGames;
+         node.virtualLoss--;
+      }
+      playoutsCompleted += numGames;
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to create the children of a node
+//   - Only one thread can expand a node: the others carry on with a playout from the unexpanded node
+// --------------------------------------------------------------------------- //
+
+bool
+CMctsEngine::Expand(CNode &node, CBoard &board)
+{
+   int expectedState = UNEXPANDED;
+   if( !node.state.compare_exchange_strong(expectedState, EXPANDING) )
+      return false;
+
+   std::vector<CBoard::CMove> moves;
+   board.GetLegalMoves(moves);
+
+   // Claim a contiguous block of the pool for the children
+   const unsigned int firstChild = numNodes.fetch_add(moves.size());
+   if( firstChild + moves.size() > maxNodes )
+   {
+      // The pool is full, so the node stays a leaf
+      numNodes = maxNodes;
+      node.state = UNEXPANDED;
+      return false;
+   }
+
+   // Light policy prior: crowning moves are twice as likely as other moves
+   float totalWeight = 0.0f;
+   for( unsigned int move = 0 ; move < moves.size() ; move++ )
+   {
+      CNode &child = pool[firstChild + move];
+      child.move = moves[move];
+      child.moverIsX = board.IsXTurn();
+      child.visits = 0;
+      child.score = 0;
+      child.virtualLoss = 0;
+      child.state = UNEXPANDED;
+      child.numChildren = 0;
+      child.prior = ( MoveCrowns(board, moves[move]) ? 2.0f : 1.0f );
+      totalWeight += child.prior;
+   }
+   for( unsigned int move = 0 ; move < moves.size() ; move++ )
+      pool[firstChild + move].prior /= totalWeight;
+
+   node.firstChild = firstChild;
+   node.numChildren = moves.size();
+   node.state = EXPANDED;  // Publishes the children to the other threads
+
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to choose which child of a node to explore next
+//   - Playouts that are still in progress count as losses (virtual loss)
+// --------------------------------------------------------------------------- //
+
+unsigned int
+CMctsEngine::SelectChild(const CNode &node) const
+{
+   const double parentVisits = double(node.visits + node.virtualLoss);
+   const double logParentVisits = std::log(parentVisits + 1.0);
+   const double sqrtParentVisits = std::sqrt(parentVisits + 1.0);
+
+   unsigned int best = node.firstChild;
+   double bestValue = -1.0;
+   for( unsigned int childIndex = node.firstChild ; childIndex < node.firstChild + node.numChildren ; childIndex++ )
+   {
+      const CNode &child = pool[childIndex];
+      const double visits = double(child.visits + child.virtualLoss);
+      const double meanScore = ( visits > 0.0 ? child.score/(2.0*visits) : 0.5 );
+
+      double value;
+      if( selection == PUCT )
+      {
+         value = meanScore + exploration*child.prior*sqrtParentVisits/(1.0 + visits);
+      }
+      else
+      {
+         // Unvisited children are always explored first
+         if( visits == 0.0 )
+            return childIndex;
+         value = meanScore + exploration*std::sqrt(logParentVisits/visits);
+      }
+
+      if( value > bestValue )
+      {
+         bestValue = value;
+         best = childIndex;
+      }
+   }
+
+   return best;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to play random moves until the end of the game
+// --------------------------------------------------------------------------- //
+
+unsigned int
+CMctsEngine::Rollout(CBoard &board, std::minstd_rand &rng) const
+{
+   std::vector<CBoard::CMove> moves;
+   moves.reserve(32);
+
+   for( unsigned int moveNumber = 0 ; moveNumber < MAX_ROLLOUT_MOVES ; moveNumber++ )
+   {
+      board.GetLegalMoves(moves);
+      // The side whose turn it is has no moves, so it has lost
+      if( moves.empty() )
+         return ( board.IsXTurn() ? 0 : 2 );
+
+      unsigned int choice = rng() % moves.size();
+      if( rollout == LIGHT_ROLLOUT )
+      {
+         for( unsigned int move = 0 ; move < moves.size() ; move++ )
+            if( MoveCrowns(board, moves[move]) )
+            {
+               choice = move;
+               break;
+            }
+      }
+      board.MakeMove(moves[choice]);
+   }
+
+   // The game went on too long, so count it as a draw
+   return 1;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to play a batch of random games from the board
+// --------------------------------------------------------------------------- //
+
+unsigned int
+CMctsEngine::BatchRollout(const CBoard &board, std::minstd_rand &rng, unsigned int &numGames) const
+{
+   const CBitSlicedPlayouts<unsigned long long> playouts(board);
+   std::vector<int> results;
+   playouts.Run(rng(), 0, MAX_ROLLOUT_MOVES, results);
+
+   // Convert each result (+1 = X won, -1 = O won, 0 = draw) into the 2/1/0 scoring used by the nodes
+   unsigned int totalForX = 0;
+   for( unsigned int game = 0 ; game < results.size() ; game++ )
+      totalForX += results[game] + 1;
+   numGames = results.size();
+
+   return totalForX;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to move the root of the tree to the node whose position matches the board
+//   - Searches the top of the old tree (replaying the moves) for the board's position
+//   - The matching subtree is copied to the start of the spare pool, which then becomes the pool
+// --------------------------------------------------------------------------- //
+
+bool
+CMctsEngine::ReuseTree(const CBoard &board)
+{
+   const unsigned long long targetHash = board.Hash();
+
+   // Breadth-first search of the expanded nodes at the top of the tree
+   struct CCandidate
+   {
+      CCandidate(const unsigned int _node, const unsigned int _depth, const CBoard &_board) : node(_node), depth(_depth), board(_board) {}
+      unsigned int node;
+      unsigned int depth;
+      CBoard board;
+   };
+   std::deque<CCandidate> candidates;
+   candidates.push_back( CCandidate(0, 0, rootBoard) );
+   unsigned int newRoot = maxNodes;
+   while( !candidates.empty() && (newRoot == maxNodes) )
+   {
+      CCandidate &candidate = candidates.front();
+      if( candidate.board.Hash() == targetHash )
+      {
+         newRoot = candidate.node;
+      }
+      else if( (candidate.depth < MAX_REUSE_DEPTH) && (pool[candidate.node].state == EXPANDED) )
+      {
+         const CNode &node = pool[candidate.node];
+         for( unsigned int child = node.firstChild ; child < node.firstChild + node.numChildren ; child++ )
+         {
+            candidates.push_back( CCandidate(child, candidate.depth+1, candidate.board) );
+            candidates.back().board.MakeMove(pool[child].move);
+         }
+      }
+      candidates.pop_front();
+   }
+   if( newRoot == maxNodes )
+      return false;
+   if( newRoot == 0 )
+      return true;
+
+   // Copy the subtree into the spare pool, keeping each node's children contiguous
+   unsigned int newNumNodes = 1;
+   std::deque< std::pair<unsigned int, unsigned int> > toCopy;   // (old index, new index)
+   toCopy.push_back( std::make_pair(newRoot, 0u) );
+   while( !toCopy.empty() )
+   {
+      const CNode &oldNode = pool[toCopy.front().first];
+      CNode &newNode = sparePool[toCopy.front().second];
+      toCopy.pop_front();
+
+      newNode.move = oldNode.move;
+      newNode.moverIsX = oldNode.moverIsX;
+      newNode.visits = oldNode.visits.load();
+      newNode.score = oldNode.score.load();
+      newNode.virtualLoss = 0;
+      newNode.prior = oldNode.prior;
+      newNode.numChildren = 0;
+      newNode.state = UNEXPANDED;
+      if( oldNode.state == EXPANDED )
+      {
+         newNode.state = EXPANDED;
+         newNode.firstChild = newNumNodes;
+         newNode.numChildren = oldNode.numChildren;
+         for( unsigned int child = 0 ; child < oldNode.numChildren ; child++ )
+            toCopy.push_back( std::make_pair(oldNode.firstChild+child, newNumNodes+child) );
+         newNumNodes += oldNode.numChildren;
+      }
+   }
+   pool.swap(sparePool);
+   numNodes = newNumNodes;
+
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to check whether a move crowns a man
+// --------------------------------------------------------------------------- //
+
+bool
+CMctsEngine::MoveCrowns(CBoard &board, const CBoard::CMove &move)
+{
+   if( !(board.SquareContainsManPiece(move.fromX, move.fromY)) )
+      return false;
+   if( board.SquareContainsXPiece(move.fromX, move.fromY) )
+      return move.toY == int(board.Height())-1;
+   return move.toY == 0;
+}
@@ -0,0 +1,113 @@
+// Declaration of class for the Monte Carlo tree search AI
+
+#ifndef _MCTS_H
+#define _MCTS_H
+
+#include <atomic>
+#include <memory>    // std::unique_ptr
+#include <random>    // std::minstd_rand
+#include <vector>
+
+#include "board.h"
+
+
+// Class for choosing moves by Monte Carlo tree search
+//   - The tree's nodes are allocated from a pool that is created once (so searching never allocates nodes)
+//   - Several threads can grow the same tree: nodes are expanded lock-free & "virtual losses" steer the threads apart
+//   - The part of the tree below the position reached after the opponent's reply is kept for the next search
+class CMctsEngine
+{
+   public:
+      // Rules for picking which child to explore: UCT, or PUCT which also uses a prior for each move
+      enum SelectionTypes { UCT, PUCT };
+      // Rules for picking moves during a playout: uniformly random, random but always taking a crowning move,
+      //   or a batch of uniformly random games played together on bit-sliced boards (each batch counts as many playouts)
+      enum RolloutTypes { RANDOM_ROLLOUT, LIGHT_ROLLOUT, BATCH_ROLLOUT };
+
+      // Constructors
+      CMctsEngine(const unsigned int _maxNodes = 1<<18, const unsigned int _numThreads = 1);
+
+      // Functions for configuring the search
+      void SetThreads(const unsigned int _numThreads) { numThreads = (_numThreads > 0 ? _numThreads : 1); }
+      void SetSelection(const int _selection) { selection = _selection; }
+      void SetRollout(const int _rollout) { rollout = _rollout; }
+      void SetExploration(const double _exploration) { exploration = _exploration; }
+      // Function to make the playouts repeatable: thread t of every search plays from seed+t (0 = a new random seed
+      //   for every search, the default)
+      void SetSeed(const unsigned int _seed) { seed = _seed; }
+
+      // Function to search from the given board & choose a move for the side whose turn it is
+      //   - The search stops after "playouts" playouts or "maxTimeMs" milliseconds, whichever comes first (0 = no limit)
+      //   - The search also stops as soon as the (optional) stop flag is set
+      //   - Returns false if the side whose turn it is has no moves
+      bool Search(const CBoard &board, unsigned int playouts, const int maxTimeMs, CBoard::CMove &bestMove,
+                  const std::atomic<bool> *stop = 0);
+
+      // Functions to query the previous search
+      unsigned int PlayoutsInLastSearch() const { return lastPlayouts; }
+      unsigned int NodesInTree() const { return numNodes; }
+      bool LastSearchReusedTree() const { return lastSearchReusedTree; }
+
+   private:
+      // A node of the tree: the move that leads to it, & the results of the playouts that have passed through it
+      struct CNode
+      {
+         CNode() : moverIsX(false), visits(0), score(0), virtualLoss(0), state(UNEXPANDED), firstChild(0), numChildren(0), prior(1.0f) {}
+
+         CBoard::CMove move;                    // Move from the parent's position to this node's position
+         bool moverIsX;                         // Side that made the move (the same side can move again during a multi-jump)
+         std::atomic<unsigned int> visits;      // Number of completed playouts through this node
+         std::atomic<unsigned int> score;       // Sum of the playout results for the mover: 2 = win, 1 = draw, 0 = loss
+         std::atomic<unsigned int> virtualLoss; // Number of playouts currently passing through this node
+         std::atomic<int> state;                // Whether the children of this node have been created
+         unsigned int firstChild;               // Pool index of the first child (the children are stored contiguously)
+         unsigned int numChildren;
+         float prior;                           // Prior probability of the move (only used by PUCT)
+      };
+      enum NodeStates { UNEXPANDED, EXPANDING, EXPANDED };
+
+      // Pool of nodes (the root is always node 0), and a second pool that is used when compacting the tree for reuse
+      std::unique_ptr<CNode[]> pool;
+      std::unique_ptr<CNode[]> sparePool;
+      unsigned int maxNodes;
+      std::atomic<unsigned int> numNodes;
+
+      // Board at the root of the tree (without its pointer to the engine - see Search)
+      CBoard rootBoard;
+      bool haveTree;
+
+      unsigned int numThreads;
+      int selection;
+      int rollout;
+      double exploration;
+      unsigned int seed;
+
+      // Control & statistics for the current/last search
+      std::atomic<unsigned int> playoutsStarted;
+      std::atomic<unsigned int> playoutsCompleted;
+      unsigned int lastPlayouts;
+      bool lastSearchReusedTree;
+
+      // Function to move the root of the tree to the node matching the board (returns false if there is no such node)
+      bool ReuseTree(const CBoard &board);
+      // Function to create the children of a node (returns false if another thread is doing it or the pool is full)
+      bool Expand(CNode &node, CBoard &board);
+      // Function to choose which child of a node to explore next
+      unsigned int SelectChild(const CNode &node) const;
+      // Function to play random moves to the end of the game (returns the result for X: 2 = win, 1 = draw, 0 = loss)
+      unsigned int Rollout(CBoard &board, std::minstd_rand &rng) const;
+      // Function to play a batch of random games (returns the total of the results for X, & the number of games)
+      unsigned int BatchRollout(const CBoard &board, std::minstd_rand &rng, unsigned int &numGames) const;
+      // Function that each search thread runs: repeated select / expand / rollout / backpropagate
+      void SearchThread(const unsigned int seed, const unsigned int maxPlayouts, const int maxTimeMs, const std::atomic<bool> *stop);
+
+      // Function to check whether a move crowns a man (used by the light rollouts & the PUCT priors)
+      static bool MoveCrowns(CBoard &board, const CBoard::CMove &move);
+
+      // The pools cannot be shared between two engines, so copying is not allowed
+      CMctsEngine(const CMctsEngine &);
+      CMctsEngine &operator=(const CMctsEngine &);
+};
+
+
+#endif
@@ -0,0 +1,555 @@
+// Microbenchmarks of the board's hot paths: times each of them over a fixed set of positions & writes the timings as JSON
+// g++ microbench.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp allocations.cpp -o microbench.exe -std=c++11 -pthread -O2
+//
+// Usage: microbench.exe [-positions N] [-seed N] [-warmup N] [-reps N] [-depth N] [-aidepth N] [-playouts N]
+//                       [-counters 0/1] [-filter text] [-o file.json]
+//   -positions number of positions to time each operation on (default 32)
+//   -seed      seed of the random games that the positions are taken from, & of the AI's random choices (default 1)
+//   -warmup    number of untimed passes over the positions before the timed ones (default 2)
+//   -reps      number of timed samples of each operation (default 15)
+//   -depth     deepest GetTreeScore search to time (default 6 - each depth from 1 up to it is timed)
+//   -aidepth   search depth for InvokeAI (default 4)
+//   -playouts  number of playouts for the Monte Carlo personality (default 1000)
+//   -counters  1 = also read the processor's performance counters around the timed code (the default), 0 = don't
+//   -filter    only run the benchmarks whose names contain the text
+//   -o         file to write the JSON to (default: the console)
+//
+// The positions are the start position & positions part way through random games (the same ones for the same seed),
+// & the AI's random choices & the Monte Carlo playouts are seeded, so every run does exactly the same work: each result
+// has a checksum of what the operation worked out, which only changes if the operation's results change.
+// Each sample is timed over enough passes over the positions to take at least a millisecond, & is given in nanoseconds
+// per operation. Anything that the operation needs setting up (fresh copies of the boards, an empty transposition table)
+// is done between the passes & is not timed.
+// With -counters 1, the cycles, instructions, L1 data cache read misses, last level cache misses & branch misses of the
+// timed code are given per node (for the searches, each board that GetTreeScore scores - otherwise each operation),
+// along with the instructions per cycle. Counters that cannot be read (see perfcounters.h) are given as null.
+// The heap allocations of the first (untimed) pass of each operation are counted (see allocations.h) & given per
+// operation, with the most bytes that were in use at once during the pass, & the sizes of the board & the search's
+// structures are given as the "footprint" (so that a change that makes them bigger shows up in the JSON).
+// Without allocations.cpp in the build line, the allocations are given as null.
+
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>   // std::atoi
+#include <cstdio>    // std::snprintf
+#include <cmath>     // std::sqrt
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm> // std::sort
+#include <chrono>
+#include <random>
+#include "board.h"
+#include "mcts.h"
+#include "perfcounters.h"
+#include "allocations.h"
+#include "randomrs.h"
+
+
+// --------------------------------------------------------------------------- //
+// Class that builds the positions & times the board's operations on them (a friend of CBoard)
+// --------------------------------------------------------------------------- //
+
+class CMicrobench
+{
+   public:
+      CMicrobench(const unsigned int numPositions, const unsigned int _seed, const unsigned int _warmup,
+                  const unsigned int _reps, const bool useCounters, const std::string &_filter);
+
+      // Functions to run each group of benchmarks
+      void RunMoveGeneration();
+      void RunTreeScore(const int maxDepth);
+      void RunInvokeAI(const int depth, const unsigned int playouts);
+
+      // Function to write the settings & the results as JSON
+      void WriteJson(std::ostream &out) const;
+
+   private:
+      // Timings of one benchmark: nanoseconds per operation in each sample
+      struct CResult
+      {
+         std::string name;
+         unsigned long long operations;   // Operations per sample
+         unsigned int passes;             // Passes over the positions per sample
+         std::vector<double> samples;
+         unsigned long long checksum;     // Checksum of the results of the first pass
+         unsigned long long nodes;        // Nodes per sample
+         unsigned long long counts[CPerfCounters::NUM_COUNTERS];   // Counts over all of the samples
+         CAllocationCounts allocations;   // Allocations of the first pass
+      };
+
+      // Function to time an operation: prepare() sets up a pass (untimed), & operation() makes one pass over the positions
+      //   & returns the number of operations it made (a search also adds the boards it scored to nodes)
+      template<typename PREPARE, typename OPERATION>
+      void Measure(const std::string &name, PREPARE prepare, OPERATION operation);
+
+      void Mix(const unsigned long long value) { checksum = (checksum ^ value) * 0x100000001B3ULL; }
+
+      unsigned int seed;
+      unsigned int warmup;
+      unsigned int reps;
+      std::string filter;
+
+      std::vector<CBoard> positions;
+      unsigned long long positionsSignature;
+      std::vector<CResult> results;
+      unsigned long long checksum;
+      unsigned long long nodes;
+
+      CPerfCounters counters;
+      bool countersOpen;
+};
+
+
+CMicrobench::CMicrobench(const unsigned int numPositions, const unsigned int _seed, const unsigned int _warmup,
+                         const unsigned int _reps, const bool useCounters, const std::string &_filter)
+ : seed(_seed), warmup(_warmup), reps(_reps > 0 ? _reps : 1), filter(_filter), positionsSignature(0), checksum(0), nodes(0),
+   countersOpen(false)
+{
+   if( useCounters )
+   {
+      countersOpen = counters.Open();
+      if( !countersOpen )
+         std::cerr << "The performance counters are not available (only the times are measured)\n";
+   }
+
+   // The positions are taken from random games, stopping after a random number of moves (0 - 79) at a position where
+   //   the side to move has a move & is not part way through a multi-jump
+   //   (rng() % n rather than a distribution, so that the positions are the same with every standard library)
+   std::mt19937_64 rng(seed);
+   CBoard start;
+   std::vector<CBoard::CMove> moves;
+   while( positions.size() < numPositions )
+   {
+      CBoard board = start;
+      const unsigned int numMoves = ( positions.empty() ? 0 : (unsigned int)(rng() % 80) );
+      for( unsigned int move = 0 ; move < numMoves ; move++ )
+      {
+         board.GetLegalMoves(moves);
+         if( moves.empty() )
+            break;
+         board.MakeMove( moves[rng() % moves.size()] );
+      }
+      if( !board.CurrentSideHasMoves() || board.InMultiTurnSequence() )
+         continue;
+      positions.push_back(board);
+      positionsSignature = (positionsSignature ^ board.Hash()) * 0x100000001B3ULL;
+   }
+}
+
+
+template<typename PREPARE, typename OPERATION>
+void
+CMicrobench::Measure(const std::string &name, PREPARE prepare, OPERATION operation)
+{
+   if( name.find(filter) == std::string::npos )
+      return;
+   std::cerr << name << "..." << std::flush;
+
+   CResult result;
+   result.name = name;
+
+   // The first warm-up pass sets the number of passes in a sample & gives the checksum & the allocations
+   checksum = 0;
+   nodes = 0;
+   prepare();
+   std::chrono::steady_clock::time_point start;
+   unsigned long long operationsPerPass = 0;
+   double passNs = 0;
+   {
+      const CAllocationMeter allocations;
+      start = std::chrono::steady_clock::now();
+      operationsPerPass = operation();
+      passNs = double( std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() );
+      result.allocations = allocations.Counts();
+   }
+   result.checksum = checksum;
+   const unsigned long long nodesPerPass = ( nodes > 0 ? nodes : operationsPerPass );
+   static const double MIN_SAMPLE_NS = 1e6;
+   result.passes = ( passNs >= MIN_SAMPLE_NS ? 1 : (unsigned int)(MIN_SAMPLE_NS / std::max(passNs, 1.0)) + 1 );
+   result.operations = operationsPerPass * result.passes;
+   result.nodes = nodesPerPass * result.passes;
+
+   for( unsigned int pass = 1 ; pass < warmup ; pass++ )
+   {
+      prepare();
+      operation();
+   }
+
+   // The counters are started before the clock & stopped after it, so that they are not part of the time
+   counters.Clear();
+   for( unsigned int rep = 0 ; rep < reps ; rep++ )
+   {
+      std::chrono::steady_clock::duration elapsed(0);
+      for( unsigned int pass = 0 ; pass < result.passes ; pass++ )
+      {
+         prepare();
+         if( countersOpen )
+            counters.Start();
+         start = std::chrono::steady_clock::now();
+         operation();
+         elapsed += std::chrono::steady_clock::now() - start;
+         if( countersOpen )
+            counters.Stop();
+      }
+      result.samples.push_back( double( std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() ) /
+                                double( std::max(result.operations, 1ULL) ) );
+   }
+
+   for( unsigned int counter = 0 ; counter < CPerfCounters::NUM_COUNTERS ; counter++ )
+      result.counts[counter] = counters.Total(counter);
+
+   std::sort(result.samples.begin(), result.samples.end());
+   std::cerr << " " << result.samples[result.samples.size()/2] << " ns\n";
+   results.push_back(result);
+}
+
+
+// --------------------------------------------------------------------------- //
+// Benchmarks of making & copying boards, & of working out the moves
+// --------------------------------------------------------------------------- //
+
+void
+CMicrobench::RunMoveGeneration()
+{
+   std::vector<CBoard> boards = positions;
+
+   Measure( "ResetBoard", [](){},
+            [&]()
+            {
+               for( unsigned int board = 0 ; board < boards.size() ; board++ )
+               {
+                  boards[board].ResetBoard(false);
+                  Mix( boards[board].numSidePieces[0] );
+               }
+               return (unsigned long long)boards.size();
+            } );
+
+   // Every piece of the side to move has its moves worked out
+   boards = positions;
+   Measure( "PopulateMoves", [](){},
+            [&]()
+            {
+               unsigned long long operations = 0;
+               for( unsigned int board = 0 ; board < boards.size() ; board++ )
+               {
+                  CBoard &current = boards[board];
+                  const CBoard::CMoveTable &sideMoves = current.CurrentTurnAllMoves();
+                  for( unsigned int piece = 0 ; piece < current.numSidePieces[current.isXTurn] ; piece++ )
+                  {
+                     CBoard::CMoveContainer moves;
+                     moves.pieceLocation = sideMoves[piece].pieceLocation;
+                     current.PopulateMoves(current.GetSquare(moves.pieceLocation).GetPiece(), true, moves);
+                     Mix( moves.passiveMoves.size() + 8*moves.aggressiveMoves.size() );
+                     operations++;
+                  }
+               }
+               return operations;
+            } );
+
+   // The side to move's table of moves is rebuilt from scratch
+   boards = positions;
+   Measure( "CalculateAllMoves", [](){},
+            [&]()
+            {
+               for( unsigned int board = 0 ; board < boards.size() ; board++ )
+               {
+                  boards[board].changedSquares[boards[board].isXTurn] = CBoard::ALL_SQUARES;
+                  boards[board].CalculateAllMoves();
+                  Mix( boards[board].currentSideHasAggressiveMoves );
+               }
+               return (unsigned long long)boards.size();
+            } );
+
+   // Each legal move of each position is made (the boards have the moving piece queued & its destination selected)
+   std::vector<CBoard> queued;
+   std::vector<CBoard::CMove> moves;
+   for( unsigned int board = 0 ; board < positions.size() ; board++ )
+   {
+      positions[board].GetLegalMoves(moves);
+      for( unsigned int move = 0 ; move < moves.size() ; move++ )
+      {
+         queued.push_back(positions[board]);
+         queued.back().QueueMove(moves[move]);
+      }
+   }
+   std::vector<CBoard> executed = queued;
+   Measure( "ExecuteSelectedSquare", [&](){ executed = queued; },
+            [&]()
+            {
+               for( unsigned int board = 0 ; board < executed.size() ; board++ )
+               {
+                  const int returnCode = executed[board].ExecuteSelectedSquare();
+                  Mix( returnCode + 4*executed[board].isXTurn );
+               }
+               return (unsigned long long)executed.size();
+            } );
+
+   // The copy is destroyed at the end of each loop, so this times copying & destroying a board
+   Measure( "CBoardCopy", [](){},
+            [&]()
+            {
+               for( unsigned int board = 0 ; board < positions.size() ; board++ )
+               {
+                  const CBoard copy(positions[board]);
+                  Mix( copy.numSidePieces[copy.isXTurn] );
+               }
+               return (unsigned long long)positions.size();
+            } );
+}
+
+
+// --------------------------------------------------------------------------- //
+// Benchmarks of the tree search, from an empty transposition table
+// --------------------------------------------------------------------------- //
+
+void
+CMicrobench::RunTreeScore(const int maxDepth)
+{
+   // The first legal move of each position is scored by the position's own board, set up as ChooseMove does
+   std::vector<CBoard> searchers;
+   std::vector<CBoard> queued;
+   std::vector<CBoard::CMove> moves;
+   for( unsigned int board = 0 ; board < positions.size() ; board++ )
+   {
+      searchers.push_back(positions[board]);
+      CBoard &searcher = searchers.back();
+      searcher.aiIsX = searcher.isXTurn;
+      searcher.searchStop = 0;
+      searcher.searchHasDeadline = false;
+      searcher.searchNodes = 0;
+      searcher.searchAborted = false;
+
+      positions[board].GetLegalMoves(moves);
+      queued.push_back(positions[board]);
+      queued.back().QueueMove(moves[0]);
+   }
+
+   // The boards for the plies are set aside up-front, as ChooseMove does
+   CBoard::ReservePlyBoards(maxDepth+1);
+   for( int depth = 1 ; depth <= maxDepth ; depth++ )
+   {
+      std::ostringstream name;
+      name << "GetTreeScore/depth" << depth;
+      Measure( name.str(), [](){ CBoard::ClearTranspositionTable(); },
+               [&]()
+               {
+                  for( unsigned int board = 0 ; board < searchers.size() ; board++ )
+                  {
+                     const unsigned long long startNodes = searchers[board].searchNodes;
+                     Mix( (unsigned int)searchers[board].GetTreeScore(queued[board], depth) );
+                     nodes += searchers[board].searchNodes - startNodes;
+                  }
+                  return (unsigned long long)searchers.size();
+               } );
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Benchmarks of the AI choosing a move with each personality, from an empty transposition table
+// --------------------------------------------------------------------------- //
+
+void
+CMicrobench::RunInvokeAI(const int depth, const unsigned int playouts)
+{
+   static const char *PERSONALITY_NAMES[] = { "moderate", "generous", "aggressive", "cautious", "montecarlo" };
+   std::vector<CBoard> boards;
+
+   for( int personality = CBoard::MODERATE ; personality <= CBoard::MONTE_CARLO ; personality++ )
+   {
+      // Every board's search starts from the same random numbers (InvokeAI searches on this thread, with this thread's
+      //   generator), & the Monte Carlo boards share a new engine for each pass (so no tree is kept from the pass before)
+      auto prepare = [&]()
+      {
+         CBoard::ClearTranspositionTable();
+         boards = positions;
+         std::shared_ptr<CMctsEngine> engine;
+         if( personality == CBoard::MONTE_CARLO )
+         {
+            engine = std::make_shared<CMctsEngine>();
+            engine->SetSeed(seed);
+         }
+         for( unsigned int board = 0 ; board < boards.size() ; board++ )
+         {
+            boards[board].aiPersonality = personality;
+            boards[board].mctsEngine = engine;
+            boards[board].mctsPlayouts = playouts;
+            boards[board].mctsMaxTimeMs = 0;
+         }
+      };
+
+      Measure( std::string("InvokeAI/") + PERSONALITY_NAMES[personality], prepare,
+               [&]()
+               {
+                  for( unsigned int board = 0 ; board < boards.size() ; board++ )
+                  {
+                     const CBoard &ai = boards[board];
+                     CRandomRS::Thread().Seed(seed + board);
+                     boards[board].InvokeAI(depth);
+                     nodes += ai.SearchNodes();
+                     Mix( (unsigned long long)(ai.QueuedX() + 8*ai.QueuedY()) * 64 + ai.SelectedX() + 8*ai.SelectedY() );
+                  }
+                  return (unsigned long long)boards.size();
+               } );
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to write the settings & the results as JSON
+// --------------------------------------------------------------------------- //
+
+void
+CMicrobench::WriteJson(std::ostream &out) const
+{
+   char hex[32];
+   std::snprintf(hex, sizeof(hex), "%016llx", positionsSignature);
+   out << "{\n"
+       << "  \"benchmark\": \"microbench\",\n"
+       << "  \"seed\": " << seed << ",\n"
+       << "  \"positions\": " << positions.size() << ",\n"
+       << "  \"positions_signature\": \"" << hex << "\",\n"
+       << "  \"warmup\": " << warmup << ",\n"
+       << "  \"repetitions\": " << reps << ",\n"
+       << "  \"counters\": " << ( countersOpen ? "true" : "false" ) << ",\n"
+       << "  \"allocations\": " << ( CAllocations::Counting() ? "true" : "false" ) << ",\n"
+       << "  \"footprint\": {";
+   std::vector< std::pair<std::string, unsigned long long> > footprint;
+   CBoard::GetMemoryFootprint(footprint);
+   for( unsigned int item = 0 ; item < footprint.size() ; item++ )
+      out << ( item > 0 ? ", " : "" ) << "\"" << footprint[item].first << "\": " << footprint[item].second;
+   out << "},\n"
+       << "  \"unit\": \"ns/op\",\n"
+       << "  \"results\": [";
+
+   for( unsigned int result = 0 ; result < results.size() ; result++ )
+   {
+      // The samples are sorted, so the median & the 99th percentile (nearest rank) can be read off
+      const std::vector<double> &samples = results[result].samples;
+      const unsigned int numSamples = samples.size();
+      const double median = ( (numSamples & 1) ? samples[numSamples/2] : (samples[numSamples/2 - 1] + samples[numSamples/2]) / 2 );
+      const unsigned int p99Rank = (99*numSamples + 99) / 100;
+      double mean = 0, variance = 0;
+      for( unsigned int sample = 0 ; sample < numSamples ; sample++ )
+         mean += samples[sample] / numSamples;
+      for( unsigned int sample = 0 ; sample < numSamples ; sample++ )
+         variance += (samples[sample] - mean) * (samples[sample] - mean) / numSamples;
+
+      char line[512];
+      std::snprintf(line, sizeof(line),
+                    "%s\n    {\"name\": \"%s\", \"operations\": %llu, \"passes\": %u, \"samples\": %u, "
+                    "\"median\": %.2f, \"p99\": %.2f, \"min\": %.2f, \"max\": %.2f, \"mean\": %.2f, \"stddev\": %.2f, "
+                    "\"checksum\": \"%016llx\", \"nodes\": %llu",
+                    ( result > 0 ? "," : "" ), results[result].name.c_str(), results[result].operations,
+                    results[result].passes, numSamples, median, samples[std::max(p99Rank, 1u) - 1], samples.front(),
+                    samples.back(), mean, std::sqrt(variance), results[result].checksum, results[result].nodes);
+      out << line;
+
+      // Allocations per operation in the first pass
+      const CAllocationCounts &allocations = results[result].allocations;
+      const double passOperations = double( std::max(results[result].operations / results[result].passes, 1ULL) );
+      if( CAllocations::Counting() )
+         std::snprintf(line, sizeof(line), ", \"allocations\": {\"per_op\": %.3f, \"bytes_per_op\": %.1f, \"peak_live_bytes\": %llu}",
+                       allocations.allocations / passOperations, allocations.bytes / passOperations, allocations.peakLiveBytes);
+      else
+         std::snprintf(line, sizeof(line), ", \"allocations\": null");
+      out << line;
+
+      // Counts per node over all of the samples
+      if( countersOpen )
+      {
+         const double totalNodes = double(results[result].nodes) * numSamples;
+         const unsigned long long *counts = results[result].counts;
+         out << ", \"counters\": {";
+         for( unsigned int counter = 0 ; counter < CPerfCounters::NUM_COUNTERS ; counter++ )
+         {
+            out << ( counter > 0 ? ", " : "" ) << "\"" << CPerfCounters::Name(counter) << "_per_node\": ";
+            if( counters.Available(counter) )
+            {
+               std::snprintf(line, sizeof(line), "%.3f", double(counts[counter]) / totalNodes);
+               out << line;
+            }
+            else
+               out << "null";
+         }
+         out << ", \"ipc\": ";
+         if( counters.Available(CPerfCounters::CYCLES) && counters.Available(CPerfCounters::INSTRUCTIONS) &&
+             (counts[CPerfCounters::CYCLES] > 0) )
+         {
+            std::snprintf(line, sizeof(line), "%.3f",
+                          double(counts[CPerfCounters::INSTRUCTIONS]) / double(counts[CPerfCounters::CYCLES]));
+            out << line;
+         }
+         else
+            out << "null";
+         out << "}";
+      }
+      out << "}";
+   }
+   out << "\n  ]\n}\n";
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned int numPositions = 32;
+   unsigned int seed = 1;
+   unsigned int warmup = 2;
+   unsigned int reps = 15;
+   int maxDepth = 6;
+   int aiDepth = 4;
+   unsigned int playouts = 1000;
+   bool useCounters = true;
+   std::string filter;
+   std::string outputFilename;
+
+   for( int arg = 1 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      const char *value = argv[arg+1];
+      if( option == "-positions" )         numPositions = std::atoi(value);
+      else if( option == "-seed" )         seed = std::atoi(value);
+      else if( option == "-warmup" )       warmup = std::atoi(value);
+      else if( option == "-reps" )         reps = std::atoi(value);
+      else if( option == "-depth" )        maxDepth = std::atoi(value);
+      else if( option == "-aidepth" )      aiDepth = std::atoi(value);
+      else if( option == "-playouts" )     playouts = std::atoi(value);
+      else if( option == "-counters" )     useCounters = (std::atoi(value) != 0);
+      else if( option == "-filter" )       filter = value;
+      else if( option == "-o" )            outputFilename = value;
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+   if( numPositions == 0 )
+      numPositions = 1;
+
+   CMicrobench bench(numPositions, seed, warmup, reps, useCounters, filter);
+   bench.RunMoveGeneration();
+   bench.RunTreeScore(maxDepth);
+   bench.RunInvokeAI(aiDepth, playouts);
+
+   if( outputFilename.empty() )
+      bench.WriteJson(std::cout);
+   else
+   {
+      std::ofstream out(outputFilename.c_str());
+      if( !out )
+      {
+         std::cout << "Could not open \"" << outputFilename << "\"\n";
+         return 1;
+      }
+      bench.WriteJson(out);
+   }
+   return 0;
+}
@@ -0,0 +1,134 @@
+// Simple class for reading the processor's hardware performance counters around a region of code
+//   - Uses perf_event_open on Linux. Elsewhere, or where the counters cannot be opened (e.g. in a container or virtual
+//     machine without access to them, or with /proc/sys/kernel/perf_event_paranoid set too high), no counters are
+//     available & the counts are all 0
+
+#ifndef _PERFCOUNTERS_H
+#define _PERFCOUNTERS_H
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>   // std::memset
+#endif
+
+
+class CPerfCounters
+{
+   public:
+      enum Counters { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+      static const char *Name(const unsigned int counter)
+      {
+         static const char *NAMES[NUM_COUNTERS] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses" };
+         return NAMES[counter];
+      }
+
+      // Constructors
+      CPerfCounters()
+      {
+         for( unsigned int counter = 0 ; counter < NUM_COUNTERS ; counter++ )
+            fds[counter] = -1;
+         Clear();
+      }
+      ~CPerfCounters() { Close(); }
+
+      // Function to open the counters (returns false if none of them could be opened - each counter that could not be
+      //   opened is left out, so the others can still be used)
+      bool Open()
+      {
+         Close();
+#ifdef __linux__
+         static const unsigned int TYPES[NUM_COUNTERS] =
+            { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+         static const unsigned long long CONFIGS[NUM_COUNTERS] =
+            { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+              PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+              PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+         for( unsigned int counter = 0 ; counter < NUM_COUNTERS ; counter++ )
+         {
+            // Only this thread's user-space work is counted, & only between Start & Stop. If there are not enough
+            //   hardware counters for all of them at once, the kernel takes turns between them, & the times that each
+            //   was enabled & running are read so that its count can be scaled up
+            struct perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = TYPES[counter];
+            attr.config = CONFIGS[counter];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[counter] = int( syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0) );
+         }
+#endif
+         return AnyAvailable();
+      }
+
+      void Close()
+      {
+#ifdef __linux__
+         for( unsigned int counter = 0 ; counter < NUM_COUNTERS ; counter++ )
+            if( fds[counter] >= 0 )
+               close(fds[counter]);
+#endif
+         for( unsigned int counter = 0 ; counter < NUM_COUNTERS ; counter++ )
+            fds[counter] = -1;
+      }
+
+      bool Available(const unsigned int counter) const { return fds[counter] >= 0; }
+      bool AnyAvailable() const
+      {
+         for( unsigned int counter = 0 ; counter < NUM_COUNTERS ; counter++ )
+            if( Available(counter) )
+               return true;
+         return false;
+      }
+
+      // Functions to count a region of code: the counts between each Start & Stop are added to the totals, until Clear
+      void Clear()
+      {
+         for( unsigned int counter = 0 ; counter < NUM_COUNTERS ; counter++ )
+            totals[counter] = 0;
+      }
+      void Start()
+      {
+#ifdef __linux__
+         for( unsigned int counter = 0 ; counter < NUM_COUNTERS ; counter++ )
+            if( fds[counter] >= 0 )
+            {
+               ioctl(fds[counter], PERF_EVENT_IOC_RESET, 0);
+               ioctl(fds[counter], PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+      }
+      void Stop()
+      {
+#ifdef __linux__
+         for( unsigned int counter = 0 ; counter < NUM_COUNTERS ; counter++ )
+            if( fds[counter] >= 0 )
+               ioctl(fds[counter], PERF_EVENT_IOC_DISABLE, 0);
+         for( unsigned int counter = 0 ; counter < NUM_COUNTERS ; counter++ )
+         {
+            // value, time enabled, time running
+            unsigned long long values[3];
+            if( (fds[counter] < 0) || (read(fds[counter], values, sizeof(values)) != sizeof(values)) || (values[2] == 0) )
+               continue;
+            totals[counter] += ( values[2] < values[1] ? (unsigned long long)(double(values[0]) * values[1] / values[2]) : values[0] );
+         }
+#endif
+      }
+
+      unsigned long long Total(const unsigned int counter) const { return totals[counter]; }
+
+   private:
+      // Copying would close the counters twice
+      CPerfCounters(const CPerfCounters &);
+      CPerfCounters &operator=(const CPerfCounters &);
+
+      int fds[NUM_COUNTERS];
+      unsigned long long totals[NUM_COUNTERS];
+};
+
+#endif
@@ -0,0 +1,408 @@
+// Perft: counts the positions at the end of every sequence of turns from a position, to check that a move generator
+// follows the rules (the counts from the starting positions are well known) & to measure how fast it is
+// g++ perft.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp -o perft.exe -std=c++11 -pthread -O2
+//
+// Usage: perft.exe [-depth N] [-engine board/bitboard/international/canadian] [-variant 8x8/7x7/6x6] [-position "<pos>"]
+//                  [-layout 0/1] [-divide 0/1] [-hash MB] [-threads N]
+//   -depth     number of turns to look ahead (default 6)
+//   -engine    board: CBoard, making the moves one at a time as the game does (the default)
+//              bitboard: the bitboard rules engine for the same game (8x8 only, see rules.h)
+//              international/canadian: the international rules on the 10x10/12x12 board (flying kings, maximum capture)
+//   -variant   board size for the board engine (default 8x8)
+//   -position  position to count from (see CBoard::SetPosition) instead of the starting position - for the bitboard
+//              engines it is read in layout 1, whatever -layout says
+//   -layout    board layout for the board engine (default 1)
+//   -divide    1 = print the count for each of the first turns as well as the total
+//   -hash      size in MB of a table of the counts that have already been worked out, so that positions that are reached
+//              by different orders of turns are only counted once (default 0 = no table)
+//   -threads   number of threads to share the first turns between (default 1)
+//
+// A turn is the whole of a piece's move: with the board engine, each step of a multi-jump is made separately (as
+// ExecuteSelectedSquare does, with the turn only passing to the other side once the multi-jump has ended), so a
+// multi-jump is one turn & each different sequence of jumps is counted. The international & Canadian engines list
+// different orders of jumps that capture the same pieces once, as their rules do.
+
+
+#include <iostream>
+#include <cstdlib>   // std::atoi
+#include <string>
+#include <sstream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>    // std::unique_ptr
+#include "board.h"
+#include "rules.h"
+
+
+// --------------------------------------------------------------------------- //
+// Table of the counts that have already been worked out, shared by all of the threads
+//   - Each entry holds the key (a hash of the position & the depth) XORed with the count, & the count, so an entry that
+//     was torn by two threads writing to it at once does not match any key, & no locks are needed
+// --------------------------------------------------------------------------- //
+
+class CPerftHash
+{
+   public:
+      explicit CPerftHash(const unsigned int memoryMB)
+       : numEntries( (unsigned long long)(memoryMB) * 1024 * 1024 / sizeof(CEntry) ),
+         entries( numEntries > 0 ? new CEntry[numEntries] : nullptr )
+      {
+         for( unsigned long long entry = 0 ; entry < numEntries ; entry++ )
+         {
+            entries[entry].check = 0;
+            entries[entry].count = 0;
+         }
+      }
+
+      bool IsEnabled() const { return numEntries > 0; }
+
+      bool Probe(const unsigned long long hash, const unsigned int depth, unsigned long long &count) const
+      {
+         const unsigned long long key = Key(hash, depth);
+         const CEntry &entry = entries[key % numEntries];
+         const unsigned long long stored = entry.count.load(std::memory_order_relaxed);
+         if( (entry.check.load(std::memory_order_relaxed) ^ stored) != key )
+            return false;
+         count = stored;
+         return true;
+      }
+
+      void Store(const unsigned long long hash, const unsigned int depth, const unsigned long long count)
+      {
+         const unsigned long long key = Key(hash, depth);
+         CEntry &entry = entries[key % numEntries];
+         entry.check.store(key ^ count, std::memory_order_relaxed);
+         entry.count.store(count, std::memory_order_relaxed);
+      }
+
+   private:
+      class CEntry
+      {
+         public:
+            std::atomic<unsigned long long> check;
+            std::atomic<unsigned long long> count;
+      };
+
+      // The depth is mixed into the hash (a key of 0 is never stored, so the empty entries never match)
+      static unsigned long long Key(const unsigned long long hash, const unsigned int depth)
+      {
+         const unsigned long long key = hash ^ (0x9E3779B97F4A7C15ULL * (depth + 1));
+         return ( key == 0 ? 1 : key );
+      }
+
+      unsigned long long numEntries;
+      std::unique_ptr<CEntry[]> entries;
+};
+
+
+// --------------------------------------------------------------------------- //
+// Engine for CBoard: each move of a multi-jump is made separately, & the depth only goes down once the turn has passed
+//   to the other side
+// --------------------------------------------------------------------------- //
+
+class CBoardEngine
+{
+   public:
+      typedef CBoard Position;
+
+      // A first turn: the moves that make it up & the board after it
+      class CTurn
+      {
+         public:
+            CTurn(const std::string &_name, const CBoard &_result) : name(_name), result(_result) {}
+
+            std::string name;
+            CBoard result;
+      };
+
+      static void GetTurns(const CBoard &board, std::vector<CTurn> &turns) { AddTurns(board, board, "", turns); }
+
+      static unsigned long long Count(const CBoard &board, const unsigned int depth, CPerftHash &hash)
+      {
+         if( depth == 0 )
+            return 1;
+
+         unsigned long long count = 0;
+         const unsigned long long key = board.Hash();
+         if( (depth > 1) && hash.IsEnabled() && hash.Probe(key, depth, count) )
+            return count;
+
+         std::vector<CBoard::CMove> moves;
+         board.GetLegalMoves(moves);
+         for( unsigned int move = 0 ; move < moves.size() ; move++ )
+         {
+            CBoard moved = board;
+            moved.MakeMove(moves[move]);
+            count += Count(moved, ( moved.IsXTurn() == board.IsXTurn() ? depth : depth-1 ), hash);
+         }
+
+         if( (depth > 1) && hash.IsEnabled() )
+            hash.Store(key, depth, count);
+         return count;
+      }
+
+   private:
+      // Function to follow each move of a multi-jump to the end of the turn
+      static void AddTurns(const CBoard &start, const CBoard &board, const std::string &name, std::vector<CTurn> &turns)
+      {
+         std::vector<CBoard::CMove> moves;
+         board.GetLegalMoves(moves);
+         for( unsigned int move = 0 ; move < moves.size() ; move++ )
+         {
+            CBoard moved = board;
+            moved.MakeMove(moves[move]);
+
+            std::ostringstream stepName;
+            if( name.empty() )
+               stepName << "(" << moves[move].fromX << "," << moves[move].fromY << ")";
+            else
+               stepName << name;
+            stepName << ( std::abs(moves[move].toX - moves[move].fromX) == 2 ? "x" : "-" )
+                     << "(" << moves[move].toX << "," << moves[move].toY << ")";
+
+            if( moved.IsXTurn() == start.IsXTurn() )
+               AddTurns(start, moved, stepName.str(), turns);
+            else
+               turns.push_back( CTurn(stepName.str(), moved) );
+         }
+      }
+};
+
+
+// --------------------------------------------------------------------------- //
+// Engine for the bitboard rules (see rules.h): each turn is generated whole
+// --------------------------------------------------------------------------- //
+
+// Functions to mix a square set into a hash (the 128-bit sets are mixed a word at a time)
+static unsigned long long
+MixHash(const unsigned long long hash, const unsigned long long word)
+{
+   unsigned long long mixed = (hash ^ word) + 0x9E3779B97F4A7C15ULL;
+   mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+   return mixed ^ (mixed >> 31);
+}
+static unsigned long long
+MixHash(const unsigned long long hash, const unsigned int mask)
+{
+   return MixHash(hash, (unsigned long long)(mask));
+}
+#if defined(__SIZEOF_INT128__)
+static unsigned long long
+MixHash(const unsigned long long hash, const unsigned __int128 mask)
+{
+   return MixHash( MixHash(hash, (unsigned long long)(mask)), (unsigned long long)(mask >> 64) );
+}
+#else
+static unsigned long long
+MixHash(const unsigned long long hash, const CWideMask &mask)
+{
+   return MixHash( MixHash(hash, mask.low), mask.high );
+}
+#endif
+
+template<class RULES>
+class CBitboardEngine
+{
+   public:
+      typedef typename RULES::Position Position;
+      typedef typename RULES::Geometry Geometry;
+
+      class CTurn
+      {
+         public:
+            CTurn(const std::string &_name, const Position &_result) : name(_name), result(_result) {}
+
+            std::string name;
+            Position result;
+      };
+
+      static void GetTurns(const Position &position, std::vector<CTurn> &turns)
+      {
+         std::vector<typename RULES::CTurn> generated;
+         RULES::GenerateTurns(position, generated);
+         for( unsigned int turn = 0 ; turn < generated.size() ; turn++ )
+         {
+            const typename RULES::CTurn &made = generated[turn];
+            std::ostringstream name;
+            name << "(" << Geometry::X(made.from) << "," << Geometry::Y(made.from) << ")" << ( made.captured ? "x" : "-" )
+                 << "(" << Geometry::X(made.to) << "," << Geometry::Y(made.to) << ")";
+            if( made.captured )
+               name << " [" << Geometry::Count(made.captured) << "]";
+            turns.push_back( CTurn(name.str(), made.result) );
+         }
+      }
+
+      static unsigned long long Count(const Position &position, const unsigned int depth, CPerftHash &hash)
+      {
+         if( depth == 0 )
+            return 1;
+
+         std::vector<typename RULES::CTurn> turns;
+         RULES::GenerateTurns(position, turns);
+         if( depth == 1 )
+            return turns.size();
+
+         unsigned long long count = 0;
+         const unsigned long long key = Hash(position);
+         if( hash.IsEnabled() && hash.Probe(key, depth, count) )
+            return count;
+
+         for( unsigned int turn = 0 ; turn < turns.size() ; turn++ )
+            count += Count(turns[turn].result, depth-1, hash);
+
+         if( hash.IsEnabled() )
+            hash.Store(key, depth, count);
+         return count;
+      }
+
+   private:
+      static unsigned long long Hash(const Position &position)
+      {
+         unsigned long long hash = ( position.isXTurn ? 1 : 2 );
+         hash = MixHash(hash, position.xMen);
+         hash = MixHash(hash, position.xKings);
+         hash = MixHash(hash, position.oMen);
+         return MixHash(hash, position.oKings);
+      }
+};
+
+
+// --------------------------------------------------------------------------- //
+// Function to count from a position, sharing the first turns between the threads, & to print the results
+// --------------------------------------------------------------------------- //
+
+template<class ENGINE>
+static void
+RunPerft(const typename ENGINE::Position &position, const unsigned int depth, const bool divide, const unsigned int hashMB,
+         const unsigned int numThreads)
+{
+   CPerftHash hash(hashMB);
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+   std::vector<typename ENGINE::CTurn> turns;
+   if( depth > 0 )
+      ENGINE::GetTurns(position, turns);
+   std::vector<unsigned long long> counts(turns.size(), 0);
+
+   // Each thread takes the next first turn that has not been counted yet
+   std::atomic<unsigned int> nextTurn(0);
+   auto worker = [&]()
+   {
+      for( unsigned int turn = nextTurn++ ; turn < turns.size() ; turn = nextTurn++ )
+         counts[turn] = ENGINE::Count(turns[turn].result, depth-1, hash);
+   };
+   std::vector<std::thread> threads;
+   for( unsigned int thread = 1 ; thread < numThreads ; thread++ )
+      threads.push_back( std::thread(worker) );
+   worker();
+   for( unsigned int thread = 0 ; thread < threads.size() ; thread++ )
+      threads[thread].join();
+
+   unsigned long long total = ( depth == 0 ? 1 : 0 );
+   for( unsigned int turn = 0 ; turn < turns.size() ; turn++ )
+   {
+      if( divide )
+         std::cout << "  " << turns[turn].name << ": " << counts[turn] << "\n";
+      total += counts[turn];
+   }
+
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+   std::cout << "perft " << depth << ": " << total << " positions in " << seconds << "s";
+   if( seconds > 0 )
+      std::cout << " (" << (unsigned long long)(total / seconds) << " positions/s)";
+   std::cout << "\n";
+}
+
+// Function to read the position for a bitboard engine & count from it (returns false if the position is not valid)
+template<class RULES>
+static bool
+RunBitboardPerft(const std::string &positionString, const unsigned int depth, const bool divide, const unsigned int hashMB,
+                 const unsigned int numThreads)
+{
+   typename RULES::Position position = RULES::StartPosition();
+   if( !positionString.empty() && !RULES::FromString(positionString, position) )
+      return false;
+   RunPerft< CBitboardEngine<RULES> >(position, depth, divide, hashMB, numThreads);
+   return true;
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned int depth = 6;
+   std::string engine = "board";
+   std::string variantName = "8x8";
+   std::string position;
+   bool layout = true;
+   bool divide = false;
+   unsigned int hashMB = 0;
+   unsigned int numThreads = 1;
+
+   for( int arg = 1 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      const char *value = argv[arg+1];
+      if( option == "-depth" )             depth = std::atoi(value);
+      else if( option == "-engine" )       engine = value;
+      else if( option == "-variant" )      variantName = value;
+      else if( option == "-position" )     position = value;
+      else if( option == "-layout" )       layout = (std::atoi(value) != 0);
+      else if( option == "-divide" )       divide = (std::atoi(value) != 0);
+      else if( option == "-hash" )         hashMB = std::atoi(value);
+      else if( option == "-threads" )      numThreads = std::atoi(value);
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+   if( numThreads == 0 )
+      numThreads = 1;
+
+   bool validPosition = true;
+   if( engine == "board" )
+   {
+      CBoard::Variants variant = CBoard::VARIANT_8X8;
+      if( variantName == "7x7" )
+         variant = CBoard::VARIANT_7X7;
+      else if( variantName == "6x6" )
+         variant = CBoard::VARIANT_6X6;
+      else if( variantName != "8x8" )
+      {
+         std::cout << "Variant \"" << variantName << "\" not recognised (8x8, 7x7 or 6x6)\n";
+         return 1;
+      }
+      CBoard board(variant);
+      board.SetLayoutAndReset(layout);
+      validPosition = position.empty() || board.SetPosition(position);
+      if( validPosition )
+         RunPerft<CBoardEngine>(board, depth, divide, hashMB, numThreads);
+   }
+   else if( engine == "bitboard" )
+      validPosition = RunBitboardPerft< CCheckersRules<CGeometry8x8> >(position, depth, divide, hashMB, numThreads);
+   else if( engine == "international" )
+      validPosition = RunBitboardPerft< CInternationalRules<CGeometry10x10> >(position, depth, divide, hashMB, numThreads);
+   else if( engine == "canadian" )
+      validPosition = RunBitboardPerft< CInternationalRules<CGeometry12x12> >(position, depth, divide, hashMB, numThreads);
+   else
+   {
+      std::cout << "Engine \"" << engine << "\" not recognised (board, bitboard, international or canadian)\n";
+      return 1;
+   }
+
+   if( !validPosition )
+   {
+      std::cout << "\"" << position << "\" is not a valid position\n";
+      return 1;
+   }
+   return 0;
+}
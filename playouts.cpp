@@ -0,0 +1,107 @@
+// Checks the bit-sliced random playouts against the scalar rules engine, and measures the playout throughput of each
+// g++ playouts.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp -o playouts.exe -std=c++11 -pthread -O2 [-mavx2]
+//
+// Usage: playouts.exe [-batches N] [-seed S] [-maxmoves N] [-position "<position string>"]
+
+
+#include <iostream>
+#include <cstdlib>   // std::atoi, std::strtoull
+#include <string>
+#include <vector>
+#include <chrono>
+#include "board.h"
+#include "bitslice.h"
+
+
+// --------------------------------------------------------------------------- //
+// Function to play & verify a number of batches with one word type
+//   Returns the number of games whose result differed from the scalar playout
+// --------------------------------------------------------------------------- //
+
+template<typename W>
+unsigned int
+RunBatches(const CBoard &board, const unsigned long long seed, const unsigned int numBatches, const unsigned int maxMoves,
+           const char *name)
+{
+   typedef CBitSlicedPlayouts<W> Playouts;
+   const Playouts playouts(board);
+
+   std::vector<int> results;
+   int totals[3] = { 0, 0, 0 };  // O wins, draws, X wins
+   std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   std::vector< std::vector<int> > allResults(numBatches);
+   for( unsigned int batch = 0 ; batch < numBatches ; batch++ )
+   {
+      playouts.Run(seed, (unsigned long long)(batch)*Playouts::LANES, maxMoves, allResults[batch]);
+      for( unsigned int lane = 0 ; lane < Playouts::LANES ; lane++ )
+         totals[ allResults[batch][lane]+1 ]++;
+   }
+   const double bitSlicedTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+   // The scalar rules engine must produce the same result for every game
+   unsigned int numMismatches = 0;
+   startTime = std::chrono::steady_clock::now();
+   for( unsigned int batch = 0 ; batch < numBatches ; batch++ )
+      for( unsigned int lane = 0 ; lane < Playouts::LANES ; lane++ )
+      {
+         const unsigned long long game = (unsigned long long)(batch)*Playouts::LANES + lane;
+         if( ScalarPlayout(board, seed, game, maxMoves) != allResults[batch][lane] )
+         {
+            if( numMismatches == 0 )
+               std::cout << "   First mismatch: game " << game << "\n";
+            numMismatches++;
+         }
+      }
+   const double scalarTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+   const double numGames = double(numBatches)*Playouts::LANES;
+   std::cout << name << ": " << numGames << " games (X/O/draw = " << totals[2] << "/" << totals[0] << "/" << totals[1] << ")\n"
+             << "   bit-sliced: " << numGames/bitSlicedTime << " games/s\n"
+             << "   scalar:     " << numGames/scalarTime << " games/s\n"
+             << "   mismatches: " << numMismatches << "\n";
+
+   return numMismatches;
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned int numBatches = 16;
+   unsigned long long seed = 1;
+   unsigned int maxMoves = 300;
+   CBoard board;
+
+   for( int arg = 1 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      if( option == "-batches" )        numBatches = std::atoi(argv[arg+1]);
+      else if( option == "-seed" )      seed = std::strtoull(argv[arg+1], 0, 10);
+      else if( option == "-maxmoves" )  maxMoves = std::atoi(argv[arg+1]);
+      else if( option == "-position" )
+      {
+         if( !board.SetPosition(argv[arg+1]) )
+         {
+            std::cout << "Position \"" << argv[arg+1] << "\" is not valid\n";
+            return 1;
+         }
+      }
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+
+   unsigned int numMismatches = RunBatches<unsigned long long>(board, seed, numBatches, maxMoves, "64 games per word");
+#if defined(__GNUC__) && defined(__AVX2__)
+   numMismatches += RunBatches<LaneWord256>(board, seed, (numBatches+3)/4, maxMoves, "256 games per word (AVX2)");
+#endif
+
+   return ( numMismatches == 0 ? 0 : 1 );
+}
@@ -1,66 +1,114 @@
 // Simple Random Number Generator Class
+//   - xoshiro256** (32 bytes of state, so it is cheap to keep one for each thread & to copy), seeded through SplitMix64
+//   - Numbers in a range are unbiased: Lemire's multiply-shift, rejecting the few values that would favour some numbers
 
 #ifndef _RANDOMRS_H
 #define _RANDOMRS_H
 
 #include <random>
 #include <chrono>
-#include <algorithm>
+#include <atomic>
 
 
 class CRandomRS
 {
    public:
       // Constructors
-      CRandomRS() { e1 = initialize_twister(); }
+      CRandomRS() : lower(0), span(1) { Reseed(); }
+      explicit CRandomRS(const unsigned long long seed) : lower(0), span(1) { Seed(seed); }
+
+      // Function to get the calling thread's generator (each thread's starts from its own random seed, unless the thread
+      //   calls Seed on it)
+      static CRandomRS &Thread()
+      {
+         static thread_local CRandomRS rng;
+         return rng;
+      }
 
       // Function to set the range of random numbers to generate
       void SetRange(const int lower_incl, const int upper_incl)
       {
-         uniform_dist = std::uniform_int_distribution<int>(lower_incl, upper_incl);
+         lower = lower_incl;
+         span = (unsigned long long)( (long long)upper_incl - lower_incl ) + 1;
       }
 
       // Function to get a random number within the specified range
       int GetNumber()
       {
-         return uniform_dist(e1);
+         return int( lower + (long long)Below(span) );
       }
-      
-      CRandomRS &operator=(const CRandomRS &rhs)
+
+      // Function to get a random number from 0 to bound-1 (bound must be at least 1)
+      unsigned long long Below(const unsigned long long bound)
       {
-         uniform_dist = rhs.uniform_dist;
-         return *this;
+         unsigned __int128 product = (unsigned __int128)Next() * bound;
+         if( (unsigned long long)product < bound )
+         {
+            // 2^64 % bound of the low halves would give some numbers one more time than the others
+            const unsigned long long threshold = (0 - bound) % bound;
+            while( (unsigned long long)product < threshold )
+               product = (unsigned __int128)Next() * bound;
+         }
+         return (unsigned long long)(product >> 64);
       }
-      
-   private:
-      
-      std::mt19937 e1;
-      std::uniform_int_distribution<int> uniform_dist;
 
-      // Function to set up the random number generator with a random seeding
-      std::mt19937 initialize_twister( std::size_t seed = std::time(nullptr) )
+      // Function to get the next 64 random bits
+      unsigned long long Next()
       {
-         static constexpr std::size_t NUM_DISCARD = 1024;
-
-         std::minstd_rand lcg(seed);
-         lcg.discard(NUM_DISCARD);
-
-         std::size_t seeds[ std::mt19937::state_size ];
-         std::generate_n( seeds , std::mt19937::state_size , lcg );
+         const unsigned long long result = RotateLeft(state[1] * 5, 7) * 9;
+         const unsigned long long shifted = state[1] << 17;
+         state[2] ^= state[0];
+         state[3] ^= state[1];
+         state[1] ^= state[2];
+         state[0] ^= state[3];
+         state[2] ^= shifted;
+         state[3] = RotateLeft(state[3], 45);
+         return result;
+      }
 
+      // Function to start a new random sequence (e.g. for a copy, which would otherwise give the same numbers as the original)
+      void Reseed()
+      {
+         // The clock & a count of the reseeds are mixed in, in case the random device is not random (or not there)
+         static std::atomic<unsigned long long> reseeds(0);
+         unsigned long long seed = (unsigned long long)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+         seed ^= reseeds.fetch_add(1, std::memory_order_relaxed) * 0x9E3779B97F4A7C15ULL;
          try
          {
-            // check if there is a random_device available
-            seeds[0] = std::random_device {}();
+            std::random_device device;
+            seed ^= ( (unsigned long long)device() << 32 ) | device();
          }
          catch (const std::exception&)
          {
             /* ignore */
          }
+         Seed(seed);
+      }
+
+      // Function to restart the random sequence from a fixed seed, so that the same numbers are generated every time
+      //   (e.g. for repeatable benchmarks)
+      void Seed(unsigned long long seed)
+      {
+         // SplitMix64 spreads the seed over the whole state
+         for( unsigned int word = 0 ; word < 4 ; word++ )
+         {
+            unsigned long long mixed = (seed += 0x9E3779B97F4A7C15ULL);
+            mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+            state[word] = mixed ^ (mixed >> 31);
+         }
+      }
+
+   private:
 
-         std::seed_seq seed_sequence( std::begin(seeds) , std::end(seeds) );
-         return std::mt19937 { seed_sequence }; // warm-up with seed seed_sequence.generate()
+      static unsigned long long RotateLeft(const unsigned long long value, const int bits)
+      {
+         return (value << bits) | (value >> (64 - bits));
       }
+
+      unsigned long long state[4];
+      long long lower;           // Range of the numbers that GetNumber gives
+      unsigned long long span;
 };
 
 #endif
@@ -0,0 +1,527 @@
+// Declaration of the bitboard rules engine, templated on the board geometry (see geometry.h)
+
+#ifndef _RULES_H
+#define _RULES_H
+
+#include <string>
+#include <vector>
+
+#include "geometry.h"
+
+
+// --------------------------------------------------------------------------- //
+// Position on a bitboard: one square set per kind of piece, & the side to move
+// --------------------------------------------------------------------------- //
+
+template<class G>
+class CBitPosition
+{
+   public:
+      typedef typename G::Mask Mask;
+
+      CBitPosition() : xMen(0), xKings(0), oMen(0), oKings(0), isXTurn(true) {}
+
+      Mask XPieces() const  { return xMen | xKings; }
+      Mask OPieces() const  { return oMen | oKings; }
+      Mask Occupied() const { return xMen | xKings | oMen | oKings; }
+
+      bool operator==(const CBitPosition &rhs) const
+      {
+         return (xMen == rhs.xMen) && (xKings == rhs.xKings) && (oMen == rhs.oMen) && (oKings == rhs.oKings) &&
+                (isXTurn == rhs.isXTurn);
+      }
+      bool operator!=(const CBitPosition &rhs) const { return !(*this == rhs); }
+
+      Mask xMen;
+      Mask xKings;
+      Mask oMen;
+      Mask oKings;
+      bool isXTurn;
+};
+
+
+// A whole turn: the square that the piece starts & finishes on, the pieces that it captured & the position after it
+template<class G>
+class CBitTurn
+{
+   public:
+      typedef typename G::Mask Mask;
+
+      CBitTurn(const unsigned int _from, const unsigned int _to, const Mask _captured, const CBitPosition<G> &_result)
+         : from((unsigned char)(_from)), to((unsigned char)(_to)), captured(_captured), result(_result) {}
+
+      unsigned char from;
+      unsigned char to;
+      Mask captured;
+      CBitPosition<G> result;
+};
+
+
+// --------------------------------------------------------------------------- //
+// Rules engine for the game that CBoard plays, on any of the geometries
+//   - Men move one square diagonally forwards (X towards y = HEIGHT-1, O towards y = 0) & kings one square in any
+//     direction
+//   - Captures are compulsory: a man jumps forwards & a king in any direction over an opposing piece, which is removed
+//     at once, & the same piece carries on jumping while it can. A man that reaches the far row is crowned, which ends
+//     the turn
+//   - A side that has no moves loses
+//
+// A turn is the whole of a piece's move (every jump of a multi-jump), & each different sequence of jumps is a different
+// turn even if it ends in the same position, as it is when CBoard's moves are made one at a time
+// --------------------------------------------------------------------------- //
+
+template<class G>
+class CCheckersRules
+{
+   public:
+      typedef G Geometry;
+      typedef typename G::Mask Mask;
+      typedef CBitPosition<G> Position;
+
+      typedef CBitTurn<G> CTurn;
+
+      // The starting position (each side's men fill the rows at its end of the board, & X moves first)
+      static Position StartPosition()
+      {
+         Position position;
+         position.xMen = G::X_START;
+         position.oMen = G::O_START;
+         return position;
+      }
+
+      // Function to list every turn that the side to move can take (turns is cleared first)
+      static void GenerateTurns(const Position &position, std::vector<CTurn> &turns);
+
+      // Function to count the positions at the end of every sequence of "depth" turns (each turn is counted, so a
+      //   depth of 1 gives the number of turns)
+      static unsigned long long Perft(const Position &position, const unsigned int depth);
+
+      // Functions to convert between a position & a CBoard position string (in layout 1, which has the same playable
+      //   squares as the geometry) - FromString returns false if the string is not a valid position for the geometry
+      static bool FromString(const std::string &text, Position &position);
+      static std::string ToString(const Position &position);
+
+      // Function to build the position at the end of a turn (the piece moves from "from" to "to", a man that finishes on
+      //   the far row is crowned & the captured pieces are removed)
+      static Position Result(const Position &position, const unsigned int from, const unsigned int to, const bool isKing,
+                             const Mask captured);
+
+   private:
+      // Function to follow every jump of a multi-jump from "square" (captured holds the pieces taken so far)
+      static void GenerateJumps(const Position &position, const unsigned int from, const unsigned int square,
+                                const bool isKing, const Mask captured, std::vector<CTurn> &turns);
+
+      // Directions that each kind of piece moves in (kings move in all 4)
+      static unsigned int FirstDirection(const bool isXTurn, const bool isKing) { return ( isKing || isXTurn ? 0 : 2 ); }
+      static unsigned int LastDirection(const bool isXTurn, const bool isKing)  { return ( isKing || !isXTurn ? 4 : 2 ); }
+};
+
+
+// --------------------------------------------------------------------------- //
+// Function to list every turn (if any piece can capture, only captures are allowed)
+// --------------------------------------------------------------------------- //
+
+template<class G>
+void
+CCheckersRules<G>::GenerateTurns(const Position &position, std::vector<CTurn> &turns)
+{
+   turns.clear();
+
+   const Mask ownMen = ( position.isXTurn ? position.xMen : position.oMen );
+   const Mask ownKings = ( position.isXTurn ? position.xKings : position.oKings );
+   const Mask empty = ~position.Occupied();
+
+   // Captures
+   for( Mask pieces = ownMen | ownKings ; pieces ; pieces ^= G::Bit(G::Lowest(pieces)) )
+   {
+      const unsigned int square = G::Lowest(pieces);
+      GenerateJumps(position, square, square, (ownKings & G::Bit(square)) ? true : false, Mask(0), turns);
+   }
+   if( !turns.empty() )
+      return;
+
+   // Simple moves
+   for( Mask pieces = ownMen | ownKings ; pieces ; pieces ^= G::Bit(G::Lowest(pieces)) )
+   {
+      const unsigned int square = G::Lowest(pieces);
+      const bool isKing = (ownKings & G::Bit(square)) ? true : false;
+      for( unsigned int direction = FirstDirection(position.isXTurn, isKing) ;
+           direction < LastDirection(position.isXTurn, isKing) ; direction++ )
+      {
+         const int to = G::Neighbour(square, direction);
+         if( (to >= 0) && (empty & G::Bit(to)) )
+            turns.push_back( CTurn(square, to, Mask(0), Result(position, square, to, isKing, Mask(0))) );
+      }
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to follow a multi-jump: the piece stands on "square" (its starting square "from" is empty while it jumps, &
+//   the pieces it has captured are already off the board)
+// --------------------------------------------------------------------------- //
+
+template<class G>
+void
+CCheckersRules<G>::GenerateJumps(const Position &position, const unsigned int from, const unsigned int square,
+                                 const bool isKing, const Mask captured, std::vector<CTurn> &turns)
+{
+   const Mask opponent = ( position.isXTurn ? position.OPieces() : position.XPieces() ) & ~captured;
+   const Mask empty = (~position.Occupied() | captured | G::Bit(from));
+   const Mask crownRow = ( position.isXTurn ? G::X_CROWN_ROW : G::O_CROWN_ROW );
+
+   bool jumped = false;
+   for( unsigned int direction = FirstDirection(position.isXTurn, isKing) ;
+        direction < LastDirection(position.isXTurn, isKing) ; direction++ )
+   {
+      const int over = G::Neighbour(square, direction);
+      const int to = G::Jump(square, direction);
+      if( (to < 0) || !(opponent & G::Bit(over)) || !(empty & G::Bit(to)) )
+         continue;
+
+      jumped = true;
+      const Mask nowCaptured = captured | G::Bit(over);
+      // Crowning ends the turn
+      if( !isKing && (crownRow & G::Bit(to)) )
+         turns.push_back( CTurn(from, to, nowCaptured, Result(position, from, to, isKing, nowCaptured)) );
+      else
+         GenerateJumps(position, from, to, isKing, nowCaptured, turns);
+   }
+
+   // The turn ends when the piece has jumped & cannot jump again
+   if( !jumped && captured )
+      turns.push_back( CTurn(from, square, captured, Result(position, from, square, isKing, captured)) );
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to build the position after a turn (a man that finishes on the far row is crowned)
+// --------------------------------------------------------------------------- //
+
+template<class G>
+typename CCheckersRules<G>::Position
+CCheckersRules<G>::Result(const Position &position, const unsigned int from, const unsigned int to, const bool isKing,
+                          const Mask captured)
+{
+   Position result = position;
+   const Mask fromBit = G::Bit(from), toBit = G::Bit(to);
+   const bool crowned = isKing || ((position.isXTurn ? G::X_CROWN_ROW : G::O_CROWN_ROW) & toBit);
+   Mask &men = ( position.isXTurn ? result.xMen : result.oMen );
+   Mask &kings = ( position.isXTurn ? result.xKings : result.oKings );
+
+   men &= ~fromBit;
+   kings &= ~fromBit;
+   (crowned ? kings : men) |= toBit;
+   result.xMen &= ~captured;
+   result.xKings &= ~captured;
+   result.oMen &= ~captured;
+   result.oKings &= ~captured;
+   result.isXTurn = !position.isXTurn;
+   return result;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to count the positions at the end of every sequence of turns
+// --------------------------------------------------------------------------- //
+
+template<class G>
+unsigned long long
+CCheckersRules<G>::Perft(const Position &position, const unsigned int depth)
+{
+   if( depth == 0 )
+      return 1;
+
+   std::vector<CTurn> turns;
+   GenerateTurns(position, turns);
+   if( depth == 1 )
+      return turns.size();
+
+   unsigned long long count = 0;
+   for( unsigned int turn = 0 ; turn < turns.size() ; turn++ )
+      count += Perft(turns[turn].result, depth-1);
+   return count;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions to convert between a position & a position string
+// --------------------------------------------------------------------------- //
+
+template<class G>
+bool
+CCheckersRules<G>::FromString(const std::string &text, Position &position)
+{
+   Position read;
+   unsigned int x = 0, y = 0;
+
+   // Read the squares (skipping any row separators) until the space before the side to move
+   std::string::size_type index = 0;
+   for( ; (index < text.size()) && (text[index] != ' ') ; index++ )
+   {
+      const char piece = text[index];
+      if( piece == '/' )
+         continue;
+      if( y >= G::HEIGHT )
+         return false;
+
+      const int square = G::Square(x, y);
+      Mask *pieces = ( piece == 'x' ? &read.xMen : piece == 'X' ? &read.xKings :
+                       piece == 'o' ? &read.oMen : piece == 'O' ? &read.oKings : nullptr );
+      if( (piece != '.') && ((pieces == nullptr) || (square < 0)) )
+         return false;
+      if( pieces != nullptr )
+         *pieces |= G::Bit(square);
+
+      if( ++x == G::WIDTH )
+      {
+         x = 0;
+         y++;
+      }
+   }
+   if( (y != G::HEIGHT) || (x != 0) || (index+1 >= text.size()) || ((text[index+1] != 'x') && (text[index+1] != 'o')) )
+      return false;
+   // Neither side can have more pieces than it starts with
+   if( (G::Count(read.XPieces()) > G::PIECES) || (G::Count(read.OPieces()) > G::PIECES) )
+      return false;
+
+   read.isXTurn = (text[index+1] == 'x');
+   position = read;
+   return true;
+}
+
+template<class G>
+std::string
+CCheckersRules<G>::ToString(const Position &position)
+{
+   std::string text;
+   text.reserve((G::WIDTH+1)*G::HEIGHT + 2);
+
+   for( unsigned int y = 0 ; y < G::HEIGHT ; y++ )
+   {
+      if( y > 0 )
+         text += '/';
+      for( unsigned int x = 0 ; x < G::WIDTH ; x++ )
+      {
+         const int square = G::Square(x, y);
+         const Mask bit = ( square >= 0 ? G::Bit(square) : Mask(0) );
+         text += ( (position.xMen & bit) ? 'x' : (position.xKings & bit) ? 'X' :
+                   (position.oMen & bit) ? 'o' : (position.oKings & bit) ? 'O' : '.' );
+      }
+   }
+   text += ( position.isXTurn ? " x" : " o" );
+   return text;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Rules engine for international draughts (on the 10x10 board, & Canadian draughts on the 12x12 board)
+//   - Men move one square diagonally forwards, but capture forwards & backwards
+//   - Kings fly: they move any distance along an empty diagonal, & capture a piece any distance away along a diagonal,
+//     landing on any empty square beyond it
+//   - Captures are compulsory, & the turn must capture as many pieces as possible (kings & men count the same). The
+//     captured pieces stay on the board until the turn ends, so each can only be jumped once & they block the jumper
+//   - A man is only crowned if its turn ends on the far row (passing through it during a capture does not count)
+//
+// Different orders of jumping that capture the same pieces & finish on the same square are the same turn, so they are
+// listed once
+// --------------------------------------------------------------------------- //
+
+template<class G>
+class CInternationalRules
+{
+   public:
+      typedef G Geometry;
+      typedef typename G::Mask Mask;
+      typedef CBitPosition<G> Position;
+      typedef CBitTurn<G> CTurn;
+
+      static Position StartPosition() { return CCheckersRules<G>::StartPosition(); }
+
+      // Function to list every turn that the side to move can take (turns is cleared first)
+      static void GenerateTurns(const Position &position, std::vector<CTurn> &turns);
+
+      // Function to count the positions at the end of every sequence of "depth" turns
+      static unsigned long long Perft(const Position &position, const unsigned int depth);
+
+      static bool FromString(const std::string &text, Position &position) { return CCheckersRules<G>::FromString(text, position); }
+      static std::string ToString(const Position &position) { return CCheckersRules<G>::ToString(position); }
+
+   private:
+      // The parts of the position that stay the same during a capture: the pieces that can be captured & the squares
+      //   that block the jumper (every piece but the jumper itself, including the pieces it has captured)
+      class CCaptureState
+      {
+         public:
+            const Position *position;
+            unsigned int from;
+            Mask opponent;
+            Mask occupied;
+            unsigned int bestCount;   // The most pieces captured by any turn found so far
+      };
+
+      // Function to follow every jump of a capture from "square" (captured holds the pieces taken so far)
+      static void GenerateCaptures(CCaptureState &state, const unsigned int square, const bool isKing,
+                                   const Mask captured, const unsigned int count, std::vector<CTurn> &turns);
+      // Function to add a finished capture, if it takes at least as many pieces as the others
+      static void AddCapture(CCaptureState &state, const unsigned int square, const bool isKing, const Mask captured,
+                             const unsigned int count, std::vector<CTurn> &turns);
+
+      // Squares along a ray from "square" up to (but not including) the first occupied square
+      static Mask OpenRay(const unsigned int square, const unsigned int direction, const Mask occupied)
+      {
+         const Mask ray = G::RayMask(square, direction);
+         const Mask blockers = ray & occupied;
+         if( !blockers )
+            return ray;
+         const unsigned int blocker = G::Nearest(blockers, direction);
+         return ray & ~(G::Bit(blocker) | G::RayMask(blocker, direction));
+      }
+};
+
+
+// --------------------------------------------------------------------------- //
+// Function to list every turn (if any piece can capture, only the captures that take the most pieces are allowed)
+// --------------------------------------------------------------------------- //
+
+template<class G>
+void
+CInternationalRules<G>::GenerateTurns(const Position &position, std::vector<CTurn> &turns)
+{
+   turns.clear();
+
+   const Mask ownMen = ( position.isXTurn ? position.xMen : position.oMen );
+   const Mask ownKings = ( position.isXTurn ? position.xKings : position.oKings );
+
+   // Captures
+   CCaptureState state;
+   state.position = &position;
+   state.opponent = ( position.isXTurn ? position.OPieces() : position.XPieces() );
+   state.bestCount = 1;
+   for( Mask pieces = ownMen | ownKings ; pieces ; pieces ^= G::Bit(G::Lowest(pieces)) )
+   {
+      const unsigned int square = G::Lowest(pieces);
+      state.from = square;
+      state.occupied = position.Occupied() & ~G::Bit(square);
+      GenerateCaptures(state, square, (ownKings & G::Bit(square)) ? true : false, Mask(0), 0, turns);
+   }
+   if( !turns.empty() )
+      return;
+
+   // Simple moves (men one square forwards, kings any distance)
+   const Mask occupied = position.Occupied();
+   for( Mask pieces = ownMen ; pieces ; pieces ^= G::Bit(G::Lowest(pieces)) )
+   {
+      const unsigned int square = G::Lowest(pieces);
+      for( unsigned int direction = (position.isXTurn ? 0 : 2) ; direction < (position.isXTurn ? 2u : 4u) ; direction++ )
+      {
+         const int to = G::Neighbour(square, direction);
+         if( (to >= 0) && !(occupied & G::Bit(to)) )
+            turns.push_back( CTurn(square, to, Mask(0), CCheckersRules<G>::Result(position, square, to, false, Mask(0))) );
+      }
+   }
+   for( Mask pieces = ownKings ; pieces ; pieces ^= G::Bit(G::Lowest(pieces)) )
+   {
+      const unsigned int square = G::Lowest(pieces);
+      for( unsigned int direction = 0 ; direction < G::NUM_DIRECTIONS ; direction++ )
+         for( Mask targets = OpenRay(square, direction, occupied) ; targets ; targets ^= G::Bit(G::Lowest(targets)) )
+         {
+            const unsigned int to = G::Lowest(targets);
+            turns.push_back( CTurn(square, to, Mask(0), CCheckersRules<G>::Result(position, square, to, true, Mask(0))) );
+         }
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to follow a capture: the jumper stands on "square" & has taken "count" pieces so far
+//   - A man jumps an adjacent piece in any direction; a king jumps the first piece along a diagonal (if it can be
+//     captured) & may land on any empty square before the next piece
+// --------------------------------------------------------------------------- //
+
+template<class G>
+void
+CInternationalRules<G>::GenerateCaptures(CCaptureState &state, const unsigned int square, const bool isKing,
+                                         const Mask captured, const unsigned int count, std::vector<CTurn> &turns)
+{
+   const Mask canCapture = state.opponent & ~captured;
+   bool jumped = false;
+
+   for( unsigned int direction = 0 ; direction < G::NUM_DIRECTIONS ; direction++ )
+   {
+      if( !isKing )
+      {
+         const int over = G::Neighbour(square, direction);
+         const int to = G::Jump(square, direction);
+         if( (to < 0) || !(canCapture & G::Bit(over)) || (state.occupied & G::Bit(to)) )
+            continue;
+
+         jumped = true;
+         GenerateCaptures(state, to, false, captured | G::Bit(over), count+1, turns);
+         continue;
+      }
+
+      const Mask blockers = G::RayMask(square, direction) & state.occupied;
+      if( !blockers )
+         continue;
+      const unsigned int over = G::Nearest(blockers, direction);
+      if( !(canCapture & G::Bit(over)) )
+         continue;
+      for( Mask targets = OpenRay(over, direction, state.occupied) ; targets ; targets ^= G::Bit(G::Lowest(targets)) )
+      {
+         jumped = true;
+         GenerateCaptures(state, G::Lowest(targets), true, captured | G::Bit(over), count+1, turns);
+      }
+   }
+
+   if( !jumped && (count > 0) )
+      AddCapture(state, square, isKing, captured, count, turns);
+}
+
+template<class G>
+void
+CInternationalRules<G>::AddCapture(CCaptureState &state, const unsigned int square, const bool isKing, const Mask captured,
+                                   const unsigned int count, std::vector<CTurn> &turns)
+{
+   if( count < state.bestCount )
+      return;
+   if( count > state.bestCount )
+   {
+      turns.clear();
+      state.bestCount = count;
+   }
+
+   // Every turn in the list takes the same number of pieces, so one with the same start, finish & captured pieces is
+   //   the same turn reached by a different order of jumps
+   for( unsigned int turn = 0 ; turn < turns.size() ; turn++ )
+      if( (turns[turn].from == state.from) && (turns[turn].to == square) && (turns[turn].captured == captured) )
+         return;
+   const Position result = CCheckersRules<G>::Result(*state.position, state.from, square, isKing, captured);
+   turns.push_back( CTurn(state.from, square, captured, result) );
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to count the positions at the end of every sequence of turns
+// --------------------------------------------------------------------------- //
+
+template<class G>
+unsigned long long
+CInternationalRules<G>::Perft(const Position &position, const unsigned int depth)
+{
+   if( depth == 0 )
+      return 1;
+
+   std::vector<CTurn> turns;
+   GenerateTurns(position, turns);
+   if( depth == 1 )
+      return turns.size();
+
+   unsigned long long count = 0;
+   for( unsigned int turn = 0 ; turn < turns.size() ; turn++ )
+      count += Perft(turns[turn].result, depth-1);
+   return count;
+}
+
+
+#endif
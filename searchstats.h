@@ -0,0 +1,119 @@
+// Statistics of the AI's search for a move (see CBoard::LastSearchStats & CAIHandle::Stats)
+
+#ifndef _SEARCHSTATS_H
+#define _SEARCHSTATS_H
+
+#include <string>
+#include <sstream>
+#include <iomanip>   // std::setprecision
+#include <cmath>     // std::pow
+
+// The counts are collected unless the program is compiled with -DDRAUGHTS_NO_SEARCH_STATS, in which case the search
+//   does no counting at all & only the depth reached, the time taken (& the Monte Carlo playouts) are filled in
+#ifdef DRAUGHTS_NO_SEARCH_STATS
+#define SEARCH_STATS(...)
+#else
+#define SEARCH_STATS(...) __VA_ARGS__
+#endif
+
+
+class CSearchStats
+{
+   public:
+      // Plies beyond this are counted in the last entry of plyNodes
+      static const unsigned int MAX_PLIES = 63;
+
+      CSearchStats() { Clear(); }
+
+      void Clear()
+      {
+         nodes = leaves = ttProbes = ttHits = cutoffs = 0;
+         depth = iterationDepth = maxPly = 0;
+         for( unsigned int ply = 0 ; ply <= MAX_PLIES ; ply++ )
+            plyNodes[ply] = 0;
+         playouts = 0;
+         elapsedMs = 0;
+         allocationsCounted = false;
+         allocations = allocatedBytes = peakLiveBytes = 0;
+         boardBytes = plyBoardBytes = 0;
+      }
+
+      unsigned long long nodes;       // Boards scored by the tree search
+      unsigned long long leaves;      // Boards scored by the evaluation (at the depth limit, or with no moves left)
+      unsigned long long ttProbes;    // Transposition table lookups, & the ones that found the board's score
+      unsigned long long ttHits;
+      // Boards whose moves were not searched because their score was already known (from the transposition table, the
+      //   tablebase or the bitbase) - the search has no alpha-beta bounds, so these are the only cutoffs that it makes
+      unsigned long long cutoffs;
+      int depth;                      // Depth of the deepest search that finished (the searches go 0, 1, 2, ... when timed)
+      int iterationDepth;             // Depth of the search that is running
+      unsigned int maxPly;            // Deepest ply that was reached (each jump of a multi-jump is a ply)
+      unsigned long long plyNodes[MAX_PLIES+1];   // Nodes at each ply (ply 1 = the boards after each of the AI's moves)
+      unsigned int playouts;          // Playouts of the Monte Carlo personality (which does not use the tree search)
+      double elapsedMs;
+      // Memory that all threads allocated during the search, & the most of it that was in use at once (only counted if
+      //   the program is linked with allocations.cpp - see allocations.h)
+      bool allocationsCounted;
+      unsigned long long allocations;
+      unsigned long long allocatedBytes;
+      unsigned long long peakLiveBytes;
+      // Size of a board, & of the boards that the searching thread keeps for the plies of the tree search
+      unsigned long long boardBytes;
+      unsigned long long plyBoardBytes;
+
+      double NodesPerSecond() const { return ( elapsedMs > 0 ? nodes * 1000.0 / elapsedMs : 0 ); }
+      double TTHitRate() const { return ( ttProbes > 0 ? double(ttHits) / ttProbes : 0 ); }
+      // Effective branching factor: the number of moves per ply that would give the nodes at the deepest ply
+      double EffectiveBranchingFactor() const
+      {
+         return ( (maxPly > 0) && (plyNodes[maxPly] > 0) ? std::pow(double(plyNodes[maxPly]), 1.0/maxPly) : 0 );
+      }
+
+      // Functions to describe the statistics on one line, or in full (with the nodes at each ply)
+      std::string Summary() const
+      {
+         std::ostringstream summary;
+         summary << std::fixed << std::setprecision(1);
+         if( playouts > 0 )
+            summary << playouts << " playouts, " << elapsedMs << " ms";
+         else
+            summary << "depth " << depth << "/" << maxPly << ", " << nodes << " nodes, " << elapsedMs << " ms, "
+                    << NodesPerSecond() / 1000 << " kn/s, EBF " << EffectiveBranchingFactor()
+                    << ", TT hits " << 100*TTHitRate() << "%";
+         return summary.str();
+      }
+      std::string Report() const
+      {
+         std::ostringstream report;
+         report << std::fixed << std::setprecision(2);
+         if( playouts > 0 )
+         {
+            report << "Playouts:         " << playouts << "\n"
+                   << "Time:             " << elapsedMs << " ms\n"
+                   << MemoryReport();
+            return report.str();
+         }
+         report << "Depth:            " << depth << " (deepest ply " << maxPly << ")\n"
+                << "Nodes:            " << nodes << " (" << leaves << " leaves)\n"
+                << "Time:             " << elapsedMs << " ms\n"
+                << "Nodes/second:     " << (unsigned long long)NodesPerSecond() << "\n"
+                << "Branching factor: " << EffectiveBranchingFactor() << "\n"
+                << "TT probes/hits:   " << ttProbes << " / " << ttHits << " (" << 100*TTHitRate() << "%)\n"
+                << "Cutoffs:          " << cutoffs << "\n";
+         for( unsigned int ply = 1 ; ply <= maxPly ; ply++ )
+            report << "  Ply " << std::setw(2) << ply << ":         " << plyNodes[ply] << "\n";
+         report << MemoryReport();
+         return report.str();
+      }
+      std::string MemoryReport() const
+      {
+         std::ostringstream report;
+         report << "Memory:           board " << boardBytes << " bytes, ply boards " << plyBoardBytes << " bytes\n";
+         if( allocationsCounted )
+            report << "Allocations:      " << allocations << " (" << allocatedBytes << " bytes, peak " << peakLiveBytes
+                   << " bytes in use)\n";
+         return report.str();
+      }
+};
+
+#endif
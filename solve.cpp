@@ -0,0 +1,99 @@
+// Solver for single positions: proves whether the side to move can force a win (or the other side can), & prints the
+// line of play that the proof found
+// g++ solve.cpp solver.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp -o solve.exe -std=c++11 -pthread -O2
+//
+// Usage: solve.exe "<position>" [-layout 0/1] [-nodes N] [-time ms] [-threads N] [-memory MB]
+//   position   the 8x8 board as a position string (see CBoard::SetPosition), e.g.
+//              ".x.x.x.x/x.x.x.x./.x.x.x.x/......../......../o.o.o.o./.o.o.o.o/o.o.o.o. x"
+//   -layout    board layout that the position is given in (default 1)
+//   -nodes     maximum number of positions to search (default no limit), -time: time limit in ms (default no limit)
+//   -threads   number of threads (default 1), -memory: size of the transposition table in MB (default 256)
+//
+// Unlike the AI's search, which looks a fixed number of turns ahead & scores the positions it reaches, the solver keeps
+// going until every line either ends in a win or is shown not to, so it finds wins however many turns away they are.
+// "UNKNOWN" means that no win was proven for either side within the limits (or that the position is a draw by repetition).
+
+
+#include <iostream>
+#include <cstdlib>   // std::atoi, std::strtoull
+#include <string>
+#include <vector>
+#include <chrono>
+#include "board.h"
+#include "solver.h"
+
+
+int main(int argc, char **argv)
+{
+   if( argc < 2 )
+   {
+      std::cout << "Usage: solve.exe \"<position>\" [-layout 0/1] [-nodes N] [-time ms] [-threads N] [-memory MB]\n";
+      return 1;
+   }
+
+   const std::string position = argv[1];
+   bool layout = true;
+   unsigned long long maxNodes = 0;
+   int maxTimeMs = 0;
+   unsigned int numThreads = 1;
+   unsigned int memoryMB = 256;
+
+   for( int arg = 2 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      const char *value = argv[arg+1];
+      if( option == "-layout" )            layout = (std::atoi(value) != 0);
+      else if( option == "-nodes" )        maxNodes = std::strtoull(value, nullptr, 10);
+      else if( option == "-time" )         maxTimeMs = std::atoi(value);
+      else if( option == "-threads" )      numThreads = std::atoi(value);
+      else if( option == "-memory" )       memoryMB = std::atoi(value);
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+
+   CBoard board;
+   board.SetLayoutAndReset(layout);
+   if( !board.SetPosition(position) )
+   {
+      std::cout << "\"" << position << "\" is not a valid position\n";
+      return 1;
+   }
+
+   CProofSolver solver(memoryMB, numThreads);
+   std::vector<CBoard::CMove> principalLine;
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   const CProofSolver::Results result = solver.Solve(board, maxNodes, maxTimeMs, principalLine);
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+   const char *resultNames[] = { "WIN", "LOSS", "UNKNOWN" };
+   std::cout << resultNames[result] << " for " << (board.IsXTurn() ? "x" : "o") << " (" << solver.NumNodes()
+             << " positions in " << seconds << "s)\n";
+
+   // Print the line one turn per row (the steps of a multi-jump are on the same row)
+   CBoard line = board;
+   bool turnStart = true;
+   for( unsigned int step = 0 ; step < principalLine.size() ; step++ )
+   {
+      const CBoard::CMove &move = principalLine[step];
+      const bool wasXTurn = line.IsXTurn();
+      line.MakeMove(move);
+      std::cout << ( turnStart ? (wasXTurn ? "x: " : "o: ") : " " );
+      std::cout << "(" << move.fromX << "," << move.fromY << ")-(" << move.toX << "," << move.toY << ")";
+      turnStart = (line.IsXTurn() != wasXTurn);
+      if( turnStart )
+         std::cout << "\n";
+   }
+   if( !principalLine.empty() )
+      std::cout << line.GetPosition() << "\n";
+
+   return 0;
+}
@@ -0,0 +1,392 @@
+// Definition of class functions for the proof-number solver
+
+#include "solver.h"
+
+#include <algorithm> // std::min, std::find
+#include <thread>
+
+
+// --------------------------------------------------------------------------- //
+// Constructor
+// --------------------------------------------------------------------------- //
+
+CProofSolver::CProofSolver(const unsigned int memoryMB, const unsigned int _numThreads)
+ : numThreads(_numThreads > 0 ? _numThreads : 1), locks(new std::mutex[NUM_LOCKS]), attackerIsX(true), stop(false),
+   numNodes(0), maxNodes(0), hasDeadline(false)
+{
+   // The largest power of 2 that fits in the memory (at least one bucket)
+   const unsigned long long maxEntries = (unsigned long long)(memoryMB) * 1024 * 1024 / sizeof(CEntry);
+   numEntries = 2;
+   while( (numEntries*2ULL <= maxEntries) && (numEntries < 0x80000000u) )
+      numEntries *= 2;
+   entries.reset( new CEntry[numEntries] );
+   ClearTable();
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions for the transposition table
+//   - Each key has a bucket of 2 entries, which are guarded by one of the locks
+//   - A new position replaces one that is not yet proven or disproven if it can, as those are the cheapest to redo
+// --------------------------------------------------------------------------- //
+
+void
+CProofSolver::ClearTable()
+{
+   for( unsigned int entry = 0 ; entry < numEntries ; entry++ )
+   {
+      entries[entry].key = 0;
+      entries[entry].pn = 0;
+      entries[entry].dn = 0;
+      entries[entry].distance = 0;
+      entries[entry].repetitionKey = 0;
+   }
+}
+
+void
+CProofSolver::Lookup(const unsigned long long key, unsigned int &pn, unsigned int &dn, unsigned int *distance,
+                     unsigned long long *repetitionKey)
+{
+   const unsigned int bucket = (unsigned int)(key) & (numEntries-2);
+   std::lock_guard<std::mutex> lock(locks[(bucket/2) % NUM_LOCKS]);
+   for( unsigned int entry = bucket ; entry < bucket+2 ; entry++ )
+      if( (entries[entry].key == key) && (entries[entry].pn + entries[entry].dn != 0) )
+      {
+         pn = entries[entry].pn;
+         dn = entries[entry].dn;
+         if( distance )
+            *distance = entries[entry].distance;
+         if( repetitionKey )
+            *repetitionKey = entries[entry].repetitionKey;
+         return;
+      }
+   pn = 1;
+   dn = 1;
+   if( distance )
+      *distance = 0;
+   if( repetitionKey )
+      *repetitionKey = 0;
+}
+
+void
+CProofSolver::Store(const unsigned long long key, const unsigned int pn, const unsigned int dn, const unsigned int distance,
+                    const unsigned long long repetitionKey)
+{
+   const unsigned int bucket = (unsigned int)(key) & (numEntries-2);
+   std::lock_guard<std::mutex> lock(locks[(bucket/2) % NUM_LOCKS]);
+   unsigned int replace = bucket + 1;
+   for( unsigned int entry = bucket ; entry < bucket+2 ; entry++ )
+   {
+      const bool isEmpty = (entries[entry].pn + entries[entry].dn == 0);
+      if( (entries[entry].key == key) || isEmpty )
+      {
+         replace = entry;
+         break;
+      }
+      // Keep proven & disproven positions in preference to the others
+      if( (entries[entry].pn != 0) && (entries[entry].dn != 0) )
+         replace = entry;
+   }
+   entries[replace].key = key;
+   entries[replace].pn = pn;
+   entries[replace].dn = dn;
+   entries[replace].distance = distance;
+   entries[replace].repetitionKey = repetitionKey;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions to list the positions that each of the side to move's turns leads to
+// --------------------------------------------------------------------------- //
+
+void
+CProofSolver::GetChildren(const CBoard &board, std::vector<CChild> &children)
+{
+   std::vector<CBoard::CMove> steps;
+   children.clear();
+   AddTurns(board, steps, children);
+}
+
+void
+CProofSolver::AddTurns(const CBoard &board, std::vector<CBoard::CMove> &steps, std::vector<CChild> &children)
+{
+   std::vector<CBoard::CMove> moves;
+   board.GetLegalMoves(moves);
+   for( unsigned int move = 0 ; move < moves.size() ; move++ )
+   {
+      CBoard moved = board;
+      moved.MakeMove(moves[move]);
+      steps.push_back(moves[move]);
+      // A jump that can be followed by another jump is only part of the turn
+      if( moved.IsXTurn() == board.IsXTurn() )
+         AddTurns(moved, steps, children);
+      else
+         children.push_back( CChild(moved, steps) );
+      steps.pop_back();
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the proof & disproof numbers of a child
+//   - A position that is already in the current line would repeat, & a line that is too long is given up on: both
+//     count as a failure for the side trying to win (pn = infinite, dn = 0)
+//   - Such a disproof only holds for the line that it was found in, so it keeps the position in the line that it
+//     relied on (repetition = its index in the path, or -1 if it did not rely on one), & it is only used again while that
+//     position is still in the line being searched
+// --------------------------------------------------------------------------- //
+
+void
+CProofSolver::ChildNumbers(const CChild &child, const CThreadState &state, unsigned int &pn, unsigned int &dn,
+                           int &repetition)
+{
+   repetition = -1;
+   if( state.path.size() >= MAX_PLY )
+   {
+      pn = INF;
+      dn = 0;
+      repetition = 0;
+      return;
+   }
+   std::vector<unsigned long long>::const_iterator repeated = std::find(state.path.begin(), state.path.end(), child.key);
+   if( repeated != state.path.end() )
+   {
+      pn = INF;
+      dn = 0;
+      repetition = repeated - state.path.begin();
+      return;
+   }
+
+   unsigned long long repetitionKey = 0;
+   Lookup(child.key, pn, dn, nullptr, &repetitionKey);
+   if( repetitionKey != 0 )
+   {
+      repeated = std::find(state.path.begin(), state.path.end(), repetitionKey);
+      if( repeated != state.path.end() )
+         repetition = repeated - state.path.begin();
+      else
+      {
+         pn = 1;
+         dn = 1;
+      }
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Recursive df-pn search
+//   - phi & delta are (pn, dn) if the side trying to win is to move, & (dn, pn) otherwise
+//   - phi(n) = min over the children of delta(child), delta(n) = sum over the children of phi(child)
+//   - The most-proving child is searched with its thresholds set so that the search comes back as soon as another child
+//     becomes the most-proving one, or this position reaches its own thresholds (the "1 + epsilon" trick widens the
+//     child's threshold a little, so that it does not bounce between two children that are nearly as good as each other)
+// --------------------------------------------------------------------------- //
+
+void
+CProofSolver::Search(const CBoard &board, const unsigned long long key, const unsigned int thresholdPhi,
+                     const unsigned int thresholdDelta, CThreadState &state)
+{
+   const bool isAttacker = (board.IsXTurn() == attackerIsX);
+
+   // Check the limits every 1024 positions
+   if( (++state.nodes & 1023) == 0 )
+   {
+      const unsigned long long totalNodes = (numNodes += 1024);
+      if( ((maxNodes > 0) && (totalNodes >= maxNodes)) || (hasDeadline && (std::chrono::steady_clock::now() >= deadline)) )
+         stop = true;
+   }
+
+   std::vector<CChild> children;
+   GetChildren(board, children);
+   // The side to move has no moves, so it has lost
+   if( children.empty() )
+   {
+      Store(key, isAttacker ? INF : 0, isAttacker ? 0 : INF);
+      return;
+   }
+   for( unsigned int child = 0 ; child < children.size() ; child++ )
+      children[child].key = Key(children[child].board);
+
+   state.path.push_back(key);
+   unsigned int phi = 0, delta = 0;
+   for( ;; )
+   {
+      // Find the most-proving child (the smallest delta), the second smallest delta, & this position's (phi, delta)
+      //   (each thread starts looking at a different child, so that they tend to explore different children)
+      phi = INF;
+      delta = 0;
+      unsigned int bestChild = 0, bestPhi = INF, secondDelta = INF;
+      for( unsigned int count = 0 ; count < children.size() ; count++ )
+      {
+         const unsigned int child = (count + state.threadIndex) % children.size();
+         unsigned int pn = 0, dn = 0;
+         int repetition = -1;
+         ChildNumbers(children[child], state, pn, dn, repetition);
+         // The child's side to move is the other side
+         const unsigned int childPhi = ( isAttacker ? dn : pn );
+         const unsigned int childDelta = ( isAttacker ? pn : dn );
+         // The sum only reaches infinity if one of the children does (a large sum does not make the position solved)
+         delta = ( (childPhi == INF) || (delta == INF) ? INF : std::min(delta + childPhi, INF-1) );
+         if( childDelta < phi )
+         {
+            secondDelta = phi;
+            phi = childDelta;
+            bestChild = child;
+            bestPhi = childPhi;
+         }
+         else if( childDelta < secondDelta )
+            secondDelta = childDelta;
+      }
+      if( (phi >= thresholdPhi) || (delta >= thresholdDelta) || stop )
+         break;
+
+      const unsigned int childThresholdPhi = std::min( (unsigned long long)(thresholdDelta) - delta + bestPhi, (unsigned long long)(INF) );
+      const unsigned int childThresholdDelta = std::min( thresholdPhi, std::min(secondDelta + secondDelta/4 + 1, INF) );
+      Search(children[bestChild].board, children[bestChild].key, (unsigned int)(childThresholdPhi), childThresholdDelta, state);
+   }
+
+   // For a proven position, count the turns to the end of the game: the winner takes the quickest win, & the loser puts
+   //   it off for as long as it can
+   // For a disproven position, find the earlier position in the line that the disproof relies on repeating (if any): the
+   //   latest one that any child relies on if all of the children had to be disproven, or the earliest one that a
+   //   disproven child relies on if only one had to be (a repetition of this position itself no longer matters)
+   const unsigned int pn = ( isAttacker ? phi : delta );
+   const unsigned int dn = ( isAttacker ? delta : phi );
+   const int depth = state.path.size() - 1;
+   unsigned int distance = ( isAttacker ? INF : 0 );
+   int repetition = ( isAttacker ? -1 : depth );
+   for( unsigned int child = 0 ; child < children.size() ; child++ )
+   {
+      unsigned int childPn = 0, childDn = 0, childDistance = 0;
+      int childRepetition = -1;
+      if( pn == 0 )
+      {
+         Lookup(children[child].key, childPn, childDn, &childDistance);
+         if( childPn == 0 )
+            distance = ( isAttacker ? std::min(distance, childDistance+1) : std::max(distance, childDistance+1) );
+      }
+      else if( dn == 0 )
+      {
+         ChildNumbers(children[child], state, childPn, childDn, childRepetition);
+         if( childRepetition >= depth )
+            childRepetition = -1;
+         if( childDn == 0 )
+            repetition = ( isAttacker ? std::max(repetition, childRepetition) : std::min(repetition, childRepetition) );
+      }
+   }
+   state.path.pop_back();
+
+   if( pn == 0 )
+      Store(key, pn, dn, distance);
+   else if( (dn == 0) && (repetition >= 0) && (repetition < depth) )
+      Store(key, pn, dn, 0, state.path[repetition]);
+   else
+      Store(key, pn, dn);
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to prove a win for one side, with each thread searching from the root (sharing the transposition table)
+// --------------------------------------------------------------------------- //
+
+bool
+CProofSolver::Prove(const CBoard &board, const bool _attackerIsX)
+{
+   attackerIsX = _attackerIsX;
+   const unsigned long long rootKey = Key(board);
+
+   std::vector<std::thread> threads;
+   for( unsigned int thread = 0 ; thread < numThreads ; thread++ )
+      threads.push_back( std::thread( [this, &board, rootKey, thread]()
+                                      {
+                                         CThreadState state;
+                                         state.threadIndex = thread;
+                                         state.nodes = 0;
+                                         Search(board, rootKey, INF, INF, state);
+                                         numNodes += state.nodes & 1023;
+                                         // The root is solved (or the limits were reached), so the other threads can stop
+                                         stop = true;
+                                      } ) );
+   for( unsigned int thread = 0 ; thread < threads.size() ; thread++ )
+      threads[thread].join();
+
+   unsigned int pn = 0, dn = 0;
+   Lookup(rootKey, pn, dn);
+   return (pn == 0) || (dn == 0);
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to solve a position
+// --------------------------------------------------------------------------- //
+
+CProofSolver::Results
+CProofSolver::Solve(const CBoard &board, const unsigned long long _maxNodes, const int maxTimeMs,
+                    std::vector<CBoard::CMove> &principalLine)
+{
+   maxNodes = _maxNodes;
+   hasDeadline = (maxTimeMs > 0);
+   deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(maxTimeMs);
+   numNodes = 0;
+   principalLine.clear();
+   ClearTable();
+
+   // Try to prove a win for the side to move, then (if that fails) a win for the other side
+   Results result = UNKNOWN;
+   for( unsigned int attempt = 0 ; (attempt < 2) && (result == UNKNOWN) ; attempt++ )
+   {
+      stop = false;
+      const bool forSideToMove = (attempt == 0);
+      Prove(board, forSideToMove ? board.IsXTurn() : !board.IsXTurn());
+      unsigned int pn = 0, dn = 0;
+      Lookup(Key(board), pn, dn);
+      if( pn == 0 )
+      {
+         result = ( forSideToMove ? WIN : LOSS );
+         GetPrincipalLine(board, principalLine);
+      }
+      // Out of time or positions
+      if( ((maxNodes > 0) && (numNodes >= maxNodes)) || (hasDeadline && (std::chrono::steady_clock::now() >= deadline)) )
+         break;
+   }
+   return result;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to follow the proof from the root: the winner plays the move to the proven position that is the fewest turns
+//   from the end of the game, & the loser plays the move that puts it off for longest
+// --------------------------------------------------------------------------- //
+
+void
+CProofSolver::GetPrincipalLine(const CBoard &board, std::vector<CBoard::CMove> &principalLine)
+{
+   CBoard position = board;
+   std::vector<unsigned long long> line(1, Key(position));
+   std::vector<CChild> children;
+   while( line.size() < MAX_PLY )
+   {
+      const bool isAttacker = (position.IsXTurn() == attackerIsX);
+      GetChildren(position, children);
+      unsigned int next = children.size(), nextDistance = 0;
+      for( unsigned int child = 0 ; child < children.size() ; child++ )
+      {
+         unsigned int pn = 0, dn = 0, distance = 0;
+         children[child].key = Key(children[child].board);
+         Lookup(children[child].key, pn, dn, &distance);
+         if( (pn != 0) || (std::find(line.begin(), line.end(), children[child].key) != line.end()) )
+            continue;
+         if( (next == children.size()) || (isAttacker ? (distance < nextDistance) : (distance > nextDistance)) )
+         {
+            next = child;
+            nextDistance = distance;
+         }
+      }
+      // The game is over, or the rest of the proof is no longer in the table
+      if( next == children.size() )
+         break;
+      principalLine.insert(principalLine.end(), children[next].steps.begin(), children[next].steps.end());
+      position = children[next].board;
+      line.push_back(children[next].key);
+   }
+}
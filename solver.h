@@ -0,0 +1,119 @@
+// Declaration of class for the proof-number solver (exact win/loss results, rather than the AI's heuristic scores)
+
+#ifndef _SOLVER_H
+#define _SOLVER_H
+
+#include <atomic>
+#include <memory>    // std::unique_ptr
+#include <mutex>
+#include <vector>
+#include <chrono>
+
+#include "board.h"
+
+
+// Class for proving whether a position is a forced win, by depth-first proof-number search (df-pn)
+//   - Each side's turns are searched in full (a multi-jump is followed to its end), so the solver works on any board
+//     that CBoard can play, of any size
+//   - The proof & disproof numbers are kept in a transposition table of a fixed size, which several threads share
+//   - A position that repeats one earlier in the line (or a line longer than MAX_PLY turns) is counted as a failure for
+//     the side trying to win, so a proven win is always a real forced win, but a failed proof only means that the win was
+//     not found (the position may be a draw by endless repetition, or in rare cases a disproof that relied on a
+//     repetition may have been used again in a line where it does not hold)
+class CProofSolver
+{
+   public:
+      enum Results { WIN, LOSS, UNKNOWN };   // For the side to move
+      static const unsigned int MAX_PLY = 400;
+
+      // Constructors - the transposition table uses up to memoryMB megabytes
+      CProofSolver(const unsigned int memoryMB = 256, const unsigned int _numThreads = 1);
+
+      void SetThreads(const unsigned int _numThreads) { numThreads = (_numThreads > 0 ? _numThreads : 1); }
+
+      // Function to solve a position: tries to prove a win for the side to move, then a win for the other side
+      //   - Stops after maxNodes positions or maxTimeMs milliseconds in total (0 = no limit), giving UNKNOWN
+      //   - For a WIN or a LOSS, principalLine is a line of play that the winner can force (one CMove per step of each
+      //     turn, starting with the side to move), as far as the transposition table still holds it
+      Results Solve(const CBoard &board, const unsigned long long maxNodes, const int maxTimeMs,
+                    std::vector<CBoard::CMove> &principalLine);
+
+      // Number of positions searched by the last call of Solve
+      unsigned long long NumNodes() const { return numNodes; }
+
+   private:
+      static const unsigned int INF = 0x3FFFFFFF;
+
+      // Transposition table entry: proof & disproof numbers for the side trying to win, & for a proven position, the
+      //   number of turns to the end of the game, or for a disproven one, the key of the earlier position in the line that
+      //   the disproof relied on repeating (0 = none)
+      struct CEntry
+      {
+         unsigned long long key;
+         unsigned int pn;
+         unsigned int dn;
+         unsigned int distance;
+         unsigned long long repetitionKey;
+      };
+      // A position that a turn leads to, & the steps of the turn
+      struct CChild
+      {
+         CChild(const CBoard &_board, const std::vector<CBoard::CMove> &_steps) : board(_board), key(0), steps(_steps) {}
+
+         CBoard board;
+         unsigned long long key;
+         std::vector<CBoard::CMove> steps;
+      };
+      // State of each thread's search
+      struct CThreadState
+      {
+         unsigned int threadIndex;
+         std::vector<unsigned long long> path;   // Keys of the positions in the current line
+         unsigned long long nodes;
+      };
+
+      unsigned int numThreads;
+      unsigned int numEntries;   // Power of 2, 2 entries per bucket
+      std::unique_ptr<CEntry[]> entries;
+      static const unsigned int NUM_LOCKS = 1024;
+      std::unique_ptr<std::mutex[]> locks;
+
+      // The current proof: which side is trying to win, & when to stop
+      bool attackerIsX;
+      std::atomic<bool> stop;
+      std::atomic<unsigned long long> numNodes;
+      unsigned long long maxNodes;
+      bool hasDeadline;
+      std::chrono::steady_clock::time_point deadline;
+
+      // Functions to look up & store the proof & disproof numbers of a position (a missing position has 1 & 1)
+      void Lookup(const unsigned long long key, unsigned int &pn, unsigned int &dn, unsigned int *distance = nullptr,
+                  unsigned long long *repetitionKey = nullptr);
+      void Store(const unsigned long long key, const unsigned int pn, const unsigned int dn, const unsigned int distance = 0,
+                 const unsigned long long repetitionKey = 0);
+      void ClearTable();
+
+      // Function to prove a win for one side (returns true if the root was proven or disproven)
+      bool Prove(const CBoard &board, const bool _attackerIsX);
+      // Recursive df-pn function: searches until the position's proof & disproof numbers reach the thresholds, which are
+      //   given as (phi, delta) = (pn, dn) if the side trying to win is to move, & (dn, pn) otherwise
+      void Search(const CBoard &board, const unsigned long long key, const unsigned int thresholdPhi,
+                  const unsigned int thresholdDelta, CThreadState &state);
+      // Function to get the proof & disproof numbers of a child in the current line, & the index in the line of the
+      //   position that a disproof relies on repeating (-1 = none)
+      void ChildNumbers(const CChild &child, const CThreadState &state, unsigned int &pn, unsigned int &dn, int &repetition);
+      // Function to list the positions that each of the side to move's turns leads to
+      static void GetChildren(const CBoard &board, std::vector<CChild> &children);
+      static void AddTurns(const CBoard &board, std::vector<CBoard::CMove> &steps, std::vector<CChild> &children);
+      // Function to follow the proven moves from the root
+      void GetPrincipalLine(const CBoard &board, std::vector<CBoard::CMove> &principalLine);
+
+      unsigned long long Key(const CBoard &board) const { return board.Hash() ^ ( attackerIsX ? 0x5DEECE66DULL : 0ULL ); }
+
+      // The table is large, so copying is not allowed
+      CProofSolver(const CProofSolver &);
+      CProofSolver &operator=(const CProofSolver &);
+};
+
+
+#endif
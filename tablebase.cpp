@@ -0,0 +1,476 @@
+// Definition of class functions for the endgame tablebase
+
+#include "tablebase.h"
+
+#include <cstring>   // std::memcmp, std::memcpy
+
+
+namespace
+{
+   const unsigned int NUM_SQUARES = 32;
+   const unsigned int ALL_SQUARES = 0xFFFFFFFFu;
+   // Squares that a man cannot be on (a man on its far row is crowned)
+   const unsigned int X_CROWNING_ROW = 0xF0000000u;   // y = 7
+   const unsigned int O_CROWNING_ROW = 0x0000000Fu;   // y = 0
+
+   // Neighbouring & jump squares in each direction (-1 = off the board), in the same order as CBoard::PopulateMoves:
+   //   (-1,+1), (+1,+1) (the directions that X's men move in), then (-1,-1), (+1,-1) (the directions that O's men move in)
+   struct CTbGeometry
+   {
+      CTbGeometry()
+      {
+         static const int dx[4] = { -1, +1, -1, +1 };
+         static const int dy[4] = { +1, +1, -1, -1 };
+         for( int square = 0 ; square < int(NUM_SQUARES) ; square++ )
+         {
+            const int y = square/4;
+            const int x = 2*(square%4) + ( (y%2 == 0) ? 1 : 0 );
+            for( int direction = 0 ; direction < 4 ; direction++ )
+            {
+               neighbour[square][direction] = Square(x + dx[direction], y + dy[direction]);
+               jump[square][direction] = Square(x + 2*dx[direction], y + 2*dy[direction]);
+            }
+         }
+
+         // Binomial coefficients for the position numbering
+         for( unsigned int n = 0 ; n <= NUM_SQUARES ; n++ )
+            for( unsigned int k = 0 ; k <= NUM_SQUARES ; k++ )
+               binomial[n][k] = ( k == 0 ? 1 : ( n == 0 ? 0 : binomial[n-1][k-1] + binomial[n-1][k] ) );
+      }
+
+      static int Square(const int x, const int y)
+      {
+         if( (x < 0) || (x > 7) || (y < 0) || (y > 7) )
+            return -1;
+         return y*4 + x/2;
+      }
+
+      int neighbour[NUM_SQUARES][4];
+      int jump[NUM_SQUARES][4];
+      unsigned long long binomial[NUM_SQUARES+1][NUM_SQUARES+1];
+   };
+
+   const CTbGeometry &Geometry()
+   {
+      static const CTbGeometry geometry;
+      return geometry;
+   }
+
+   unsigned int PopCount(unsigned int bits)
+   {
+      unsigned int count = 0;
+      for( ; bits != 0 ; bits &= bits-1 )
+         count++;
+      return count;
+   }
+
+   unsigned int LowestSquare(const unsigned int bits)
+   {
+      unsigned int square = 0;
+      while( ((bits >> square) & 1u) == 0 )
+         square++;
+      return square;
+   }
+
+   unsigned int Reverse(unsigned int bits)
+   {
+      unsigned int reversed = 0;
+      for( unsigned int square = 0 ; square < NUM_SQUARES ; square++, bits >>= 1 )
+         reversed = (reversed << 1) | (bits & 1u);
+      return reversed;
+   }
+
+   // Function to number a set of squares (combinatorial number system), where each square is first converted to its
+   //   rank amongst the "allowed" squares
+   unsigned long long RankSquares(unsigned int squares, const unsigned int allowed)
+   {
+      const CTbGeometry &geometry = Geometry();
+      unsigned long long index = 0;
+      for( unsigned int piece = 1 ; squares != 0 ; piece++, squares &= squares-1 )
+      {
+         const unsigned int square = LowestSquare(squares);
+         const unsigned int rank = PopCount( allowed & ((1u << square) - 1u) );
+         index += geometry.binomial[rank][piece];
+      }
+      return index;
+   }
+
+   // Function to get the set of squares with the given number (the inverse of RankSquares)
+   unsigned int UnrankSquares(unsigned long long index, const unsigned int numPieces, const unsigned int allowed)
+   {
+      const CTbGeometry &geometry = Geometry();
+      // The ranks of the allowed squares, in order
+      unsigned int allowedSquares[NUM_SQUARES];
+      unsigned int numAllowed = 0;
+      for( unsigned int square = 0 ; square < NUM_SQUARES ; square++ )
+         if( (allowed >> square) & 1u )
+            allowedSquares[numAllowed++] = square;
+
+      unsigned int squares = 0;
+      unsigned int rank = numAllowed;
+      for( unsigned int piece = numPieces ; piece > 0 ; piece-- )
+      {
+         // Largest rank whose binomial coefficient fits in what is left of the index
+         do
+            rank--;
+         while( geometry.binomial[rank][piece] > index );
+         index -= geometry.binomial[rank][piece];
+         squares |= 1u << allowedSquares[rank];
+      }
+      return squares;
+   }
+
+   // Function to continue a multi-jump by X's piece on "square" (the piece has just jumped, so it is in the position)
+   //   - The turns are added to a std::vector or a CTbTurnList
+   template<typename T>
+   void ContinueJumps(const CTbPosition &position, const unsigned int square, const bool isKing, T &turns)
+   {
+      const CTbGeometry &geometry = Geometry();
+      const unsigned int empty = ~(position.xMen | position.xKings | position.oMen | position.oKings);
+      const unsigned int oPieces = position.oMen | position.oKings;
+
+      bool jumped = false;
+      for( unsigned int direction = 0 ; direction < (isKing ? 4u : 2u) ; direction++ )
+      {
+         const int over = geometry.neighbour[square][direction];
+         const int to = geometry.jump[square][direction];
+         if( (to < 0) || !((oPieces >> over) & 1u) || !((empty >> to) & 1u) )
+            continue;
+         jumped = true;
+
+         CTbPosition next = position;
+         next.oMen &= ~(1u << over);
+         next.oKings &= ~(1u << over);
+         if( isKing )
+         {
+            next.xKings = (next.xKings & ~(1u << square)) | (1u << to);
+            ContinueJumps(next, to, true, turns);
+         }
+         else
+         {
+            next.xMen &= ~(1u << square);
+            // A man that is crowned ends the turn
+            if( (1u << to) & X_CROWNING_ROW )
+            {
+               next.xKings |= 1u << to;
+               turns.push_back(next.Flip());
+            }
+            else
+            {
+               next.xMen |= 1u << to;
+               ContinueJumps(next, to, false, turns);
+            }
+         }
+      }
+
+      // The piece cannot jump again, so the turn is over
+      if( !jumped )
+         turns.push_back(position.Flip());
+   }
+
+   // Function to check whether X's piece on "square" can jump
+   bool CanJump(const CTbPosition &position, const unsigned int square, const bool isKing)
+   {
+      const CTbGeometry &geometry = Geometry();
+      const unsigned int empty = ~(position.xMen | position.xKings | position.oMen | position.oKings);
+      const unsigned int oPieces = position.oMen | position.oKings;
+      for( unsigned int direction = 0 ; direction < (isKing ? 4u : 2u) ; direction++ )
+      {
+         const int to = geometry.jump[square][direction];
+         if( (to >= 0) && ((oPieces >> geometry.neighbour[square][direction]) & 1u) && ((empty >> to) & 1u) )
+            return true;
+      }
+      return false;
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions for the compact position
+// --------------------------------------------------------------------------- //
+
+CTbPosition
+CTbPosition::Flip() const
+{
+   // Turning the board around maps square s to square 31-s, which reverses the order of the bits
+   CTbPosition flipped;
+   flipped.xMen = Reverse(oMen);
+   flipped.xKings = Reverse(oKings);
+   flipped.oMen = Reverse(xMen);
+   flipped.oKings = Reverse(xKings);
+   return flipped;
+}
+
+unsigned int
+CTbPosition::NumPieces() const
+{
+   return PopCount(xMen) + PopCount(xKings) + PopCount(oMen) + PopCount(oKings);
+}
+
+CTbMaterial::CTbMaterial(const CTbPosition &position)
+ : xMen(PopCount(position.xMen)), xKings(PopCount(position.xKings)),
+   oMen(PopCount(position.oMen)), oKings(PopCount(position.oKings))
+{
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions to list the positions that each of X's possible turns leads to
+// --------------------------------------------------------------------------- //
+
+namespace
+{
+   // Function that both forms of TbGenerateTurns use (the turns are added to a std::vector or a CTbTurnList)
+   template<typename T>
+   void GenerateTurns(const CTbPosition &position, T &turns)
+   {
+      const CTbGeometry &geometry = Geometry();
+      turns.clear();
+
+      // Jumps are compulsory, so only look for other moves if no piece can jump
+      const unsigned int xPieces = position.xMen | position.xKings;
+      for( unsigned int pieces = xPieces ; pieces != 0 ; pieces &= pieces-1 )
+      {
+         const unsigned int square = LowestSquare(pieces);
+         const bool isKing = (position.xKings >> square) & 1u;
+         if( CanJump(position, square, isKing) )
+            ContinueJumps(position, square, isKing, turns);
+      }
+      if( !turns.empty() )
+         return;
+
+      const unsigned int empty = ~(xPieces | position.oMen | position.oKings);
+      for( unsigned int pieces = xPieces ; pieces != 0 ; pieces &= pieces-1 )
+      {
+         const unsigned int square = LowestSquare(pieces);
+         const bool isKing = (position.xKings >> square) & 1u;
+         for( unsigned int direction = 0 ; direction < (isKing ? 4u : 2u) ; direction++ )
+         {
+            const int to = geometry.neighbour[square][direction];
+            if( (to < 0) || !((empty >> to) & 1u) )
+               continue;
+            CTbPosition next = position;
+            if( isKing )
+               next.xKings = (next.xKings & ~(1u << square)) | (1u << to);
+            else if( (1u << to) & X_CROWNING_ROW )
+            {
+               next.xMen &= ~(1u << square);
+               next.xKings |= 1u << to;
+            }
+            else
+               next.xMen = (next.xMen & ~(1u << square)) | (1u << to);
+            turns.push_back(next.Flip());
+         }
+      }
+   }
+}
+
+void
+TbGenerateTurns(const CTbPosition &position, std::vector<CTbPosition> &turns)
+{
+   GenerateTurns(position, turns);
+}
+
+bool
+TbGenerateTurns(const CTbPosition &position, CTbTurnList &turns)
+{
+   GenerateTurns(position, turns);
+   return turns.Complete();
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to list the positions that a single step (not a jump or crowning) by X could have come from
+// --------------------------------------------------------------------------- //
+
+void
+TbGenerateStepsBack(const CTbPosition &position, std::vector<CTbPosition> &previous)
+{
+   const CTbGeometry &geometry = Geometry();
+   previous.clear();
+
+   // The side that has just moved is O in this position, so step O's pieces backwards: O's men move in directions 2 & 3,
+   //   so they came from directions 0 & 1
+   const unsigned int empty = ~(position.xMen | position.xKings | position.oMen | position.oKings);
+   const unsigned int oPieces = position.oMen | position.oKings;
+   for( unsigned int pieces = oPieces ; pieces != 0 ; pieces &= pieces-1 )
+   {
+      const unsigned int square = LowestSquare(pieces);
+      const bool isKing = (position.oKings >> square) & 1u;
+      for( unsigned int direction = 0 ; direction < (isKing ? 4u : 2u) ; direction++ )
+      {
+         const int from = geometry.neighbour[square][direction];
+         if( (from < 0) || !((empty >> from) & 1u) )
+            continue;
+         CTbPosition before = position;
+         if( isKing )
+            before.oKings = (before.oKings & ~(1u << square)) | (1u << from);
+         else
+            before.oMen = (before.oMen & ~(1u << square)) | (1u << from);
+         previous.push_back(before.Flip());
+      }
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions for numbering the positions of a slice
+// --------------------------------------------------------------------------- //
+
+CTbSlice::CTbSlice(const CTbMaterial &_material)
+ : material(_material)
+{
+   const CTbGeometry &geometry = Geometry();
+   const unsigned int numMen = material.xMen + material.oMen;
+   const unsigned int menSquares = NUM_SQUARES - 4;
+   numXMen = geometry.binomial[menSquares][material.xMen];
+   numOMen = geometry.binomial[menSquares][material.oMen];
+   numXKings = ( numMen <= NUM_SQUARES ? geometry.binomial[NUM_SQUARES - numMen][material.xKings] : 0 );
+   numOKings = ( numMen + material.xKings <= NUM_SQUARES ? geometry.binomial[NUM_SQUARES - numMen - material.xKings][material.oKings] : 0 );
+   size = numXMen * numOMen * numXKings * numOKings;
+}
+
+unsigned long long
+CTbSlice::Index(const CTbPosition &position) const
+{
+   const unsigned int menFree = ~(position.xMen | position.oMen);
+   const unsigned long long xMenIndex = RankSquares(position.xMen, ALL_SQUARES & ~X_CROWNING_ROW);
+   const unsigned long long oMenIndex = RankSquares(position.oMen, ALL_SQUARES & ~O_CROWNING_ROW);
+   const unsigned long long xKingsIndex = RankSquares(position.xKings, menFree);
+   const unsigned long long oKingsIndex = RankSquares(position.oKings, menFree & ~position.xKings);
+   return ( (xMenIndex*numOMen + oMenIndex)*numXKings + xKingsIndex )*numOKings + oKingsIndex;
+}
+
+bool
+CTbSlice::Position(unsigned long long index, CTbPosition &position) const
+{
+   const unsigned long long oKingsIndex = index % numOKings;
+   index /= numOKings;
+   const unsigned long long xKingsIndex = index % numXKings;
+   index /= numXKings;
+   const unsigned long long oMenIndex = index % numOMen;
+   const unsigned long long xMenIndex = index / numOMen;
+
+   position.xMen = UnrankSquares(xMenIndex, material.xMen, ALL_SQUARES & ~X_CROWNING_ROW);
+   position.oMen = UnrankSquares(oMenIndex, material.oMen, ALL_SQUARES & ~O_CROWNING_ROW);
+   if( position.xMen & position.oMen )
+      return false;
+   const unsigned int menFree = ~(position.xMen | position.oMen);
+   position.xKings = UnrankSquares(xKingsIndex, material.xKings, menFree);
+   position.oKings = UnrankSquares(oKingsIndex, material.oKings, menFree & ~position.xKings);
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to map a tablebase file & read its list of slices
+// --------------------------------------------------------------------------- //
+
+bool
+CTablebase::Open(const std::string &filename)
+{
+   Close();
+   if( !file.Open(filename) )
+      return false;
+
+   const char *data = file.Data();
+   unsigned int header[4];   // version, maximum number of pieces, number of slices, positions per block
+   if( (file.Size() < HEADER_SIZE) || (std::memcmp(data, "DTB1", 4) != 0) )
+   {
+      Close();
+      return false;
+   }
+   std::memcpy(header, data + 4, sizeof(header));
+   const unsigned int numSlices = header[2];
+   if( (header[0] != VERSION) || (header[1] > MAX_PIECES) || (header[3] != BLOCK_SIZE) ||
+       (file.Size() < HEADER_SIZE + (unsigned long long)(numSlices)*SLICE_ENTRY_SIZE) )
+   {
+      Close();
+      return false;
+   }
+   maxPieces = header[1];
+
+   sliceLookup.assign( MaterialKey(CTbMaterial(maxPieces, maxPieces, maxPieces, maxPieces)) + 1, -1 );
+   for( unsigned int slice = 0 ; slice < numSlices ; slice++ )
+   {
+      const unsigned char *entry = reinterpret_cast<const unsigned char*>(data + HEADER_SIZE + slice*SLICE_ENTRY_SIZE);
+      const CTbMaterial material(entry[0], entry[1], entry[2], entry[3]);
+      unsigned long long numPositions, blockIndexOffset;
+      std::memcpy(&numPositions, entry + 8, sizeof(numPositions));
+      std::memcpy(&blockIndexOffset, entry + 16, sizeof(blockIndexOffset));
+
+      slices.push_back( CSliceInfo(material, blockIndexOffset) );
+      const unsigned long long numBlocks = (numPositions + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      if( (material.NumPieces() > maxPieces) || (slices.back().slice.Size() != numPositions) ||
+          (blockIndexOffset + (numBlocks+1)*sizeof(unsigned long long) > file.Size()) )
+      {
+         Close();
+         return false;
+      }
+      sliceLookup[MaterialKey(material)] = int(slice);
+   }
+   return true;
+}
+
+void
+CTablebase::Close()
+{
+   file.Close();
+   maxPieces = 0;
+   slices.clear();
+   sliceLookup.clear();
+}
+
+unsigned int
+CTablebase::MaterialKey(const CTbMaterial &material) const
+{
+   return ( (material.xMen*(maxPieces+1) + material.xKings)*(maxPieces+1) + material.oMen )*(maxPieces+1) + material.oKings;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to look up a position
+// --------------------------------------------------------------------------- //
+
+bool
+CTablebase::Probe(const CTbPosition &position, unsigned char &value) const
+{
+   const CTbMaterial material(position);
+   if( !IsOpen() || (material.NumPieces() > maxPieces) )
+      return false;
+   // A side with no pieces has no moves
+   if( material.xMen + material.xKings == 0 )
+   {
+      value = TbValue::Loss(0);
+      return true;
+   }
+   if( material.oMen + material.oKings == 0 )
+      return false;
+
+   const int slice = sliceLookup[MaterialKey(material)];
+   if( slice < 0 )
+      return false;
+   const CSliceInfo &info = slices[slice];
+   const unsigned long long index = info.slice.Index(position);
+
+   // Find the block, then step through its runs to the position
+   const char *data = file.Data();
+   unsigned long long blockOffsets[2];
+   std::memcpy(blockOffsets, data + info.blockIndexOffset + (index/BLOCK_SIZE)*sizeof(unsigned long long), sizeof(blockOffsets));
+   if( blockOffsets[1] > file.Size() )
+      return false;
+   const unsigned char *run = reinterpret_cast<const unsigned char*>(data + blockOffsets[0]);
+   const unsigned char *end = reinterpret_cast<const unsigned char*>(data + blockOffsets[1]);
+   unsigned int positionInBlock = index % BLOCK_SIZE;
+   for( ; run+1 < end ; run += 2 )
+   {
+      const unsigned int runLength = (unsigned int)(run[1]) + 1;
+      if( positionInBlock < runLength )
+      {
+         value = run[0];
+         return true;
+      }
+      positionInBlock -= runLength;
+   }
+   return false;
+}
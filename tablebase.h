@@ -0,0 +1,203 @@
+// Declaration of classes for the endgame tablebase (every position with only a few pieces left, solved exactly)
+
+#ifndef _TABLEBASE_H
+#define _TABLEBASE_H
+
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+
+// Compact position for the tablebase: one bit per playable square of an 8x8 board, with X to move
+//   - The 32 playable squares are numbered 0-31 in scan order (square = y*4 + x/2), using the squares where (x+y) is odd
+//     (the board layout of the starting position when CBoard::Layout() is true - the other layout is its mirror image)
+//   - X's men move towards y = 7 & O's men move towards y = 0
+//   - A position with O to move is held as the same position seen from O's side (see Flip), so it is also "X to move"
+class CTbPosition
+{
+   public:
+      CTbPosition() : xMen(0), xKings(0), oMen(0), oKings(0) {}
+
+      // Function to swap the sides & turn the board around (the result is the same position, but with the other side to move)
+      CTbPosition Flip() const;
+
+      unsigned int NumPieces() const;
+
+      bool operator==(const CTbPosition &rhs) const
+      {
+         return (xMen == rhs.xMen) && (xKings == rhs.xKings) && (oMen == rhs.oMen) && (oKings == rhs.oKings);
+      }
+
+      unsigned int xMen;
+      unsigned int xKings;
+      unsigned int oMen;
+      unsigned int oKings;
+};
+
+// Function to list the positions that each of X's possible turns leads to (flipped, so that it is X's turn again in each)
+//   - The same rules as CBoard: jumps are compulsory, a multi-jump continues until the piece cannot jump again, & a man
+//     that is crowned ends the turn
+void TbGenerateTurns(const CTbPosition &position, std::vector<CTbPosition> &turns);
+
+// Fixed-size list of the positions that a position's turns lead to, so that the turns can be listed without allocating
+//   any memory (e.g. by the bitbase during the AI's tree search)
+class CTbTurnList
+{
+   public:
+      static const unsigned int MAX_TURNS = 64;
+
+      CTbTurnList() : numTurns(0), overflowed(false) {}
+
+      void clear() { numTurns = 0; overflowed = false; }
+      bool empty() const { return numTurns == 0; }
+      unsigned int size() const { return numTurns; }
+      const CTbPosition &operator[](const unsigned int turn) const { return turns[turn]; }
+      // Turns that do not fit are left out, & the list is marked as incomplete
+      void push_back(const CTbPosition &turn)
+      {
+         if( numTurns < MAX_TURNS )
+            turns[numTurns++] = turn;
+         else
+            overflowed = true;
+      }
+      bool Complete() const { return !overflowed; }
+
+   private:
+      CTbPosition turns[MAX_TURNS];
+      unsigned int numTurns;
+      bool overflowed;
+};
+// Function to list the turns into a fixed-size list (returns false if they do not all fit)
+bool TbGenerateTurns(const CTbPosition &position, CTbTurnList &turns);
+// Function to list the positions (with X to move) from which a single step by one of X's pieces, that is not a jump or a
+//   crowning, leads to this position - the list may also contain positions in which X would have had to jump instead
+void TbGenerateStepsBack(const CTbPosition &position, std::vector<CTbPosition> &previous);
+
+
+// Number of each kind of piece in a slice of the tablebase
+class CTbMaterial
+{
+   public:
+      CTbMaterial(const unsigned int _xMen = 0, const unsigned int _xKings = 0, const unsigned int _oMen = 0, const unsigned int _oKings = 0)
+       : xMen(_xMen), xKings(_xKings), oMen(_oMen), oKings(_oKings) {}
+      explicit CTbMaterial(const CTbPosition &position);
+
+      // Material of the flipped positions
+      CTbMaterial Flip() const { return CTbMaterial(oMen, oKings, xMen, xKings); }
+
+      unsigned int NumPieces() const { return xMen + xKings + oMen + oKings; }
+
+      bool operator==(const CTbMaterial &rhs) const
+      {
+         return (xMen == rhs.xMen) && (xKings == rhs.xKings) && (oMen == rhs.oMen) && (oKings == rhs.oKings);
+      }
+
+      unsigned int xMen;
+      unsigned int xKings;
+      unsigned int oMen;
+      unsigned int oKings;
+};
+
+
+// Class for numbering all of the positions with the same material (a "slice" of the tablebase)
+//   - Each group of pieces is numbered with the combinatorial number system: X's men over the 28 squares that an X man can
+//     be on, O's men likewise, then X's kings over the squares that are left & O's kings over the squares left after that
+//   - The kings are packed perfectly, but X's & O's men are numbered independently, so an index whose men share a square
+//     is not a position
+class CTbSlice
+{
+   public:
+      explicit CTbSlice(const CTbMaterial &_material);
+
+      const CTbMaterial &Material() const { return material; }
+      unsigned long long Size() const { return size; }
+
+      // Function to get the index of a position (which must have this slice's material)
+      unsigned long long Index(const CTbPosition &position) const;
+      // Function to get the position with the given index (returns false if the index is not a position)
+      bool Position(unsigned long long index, CTbPosition &position) const;
+
+   private:
+      CTbMaterial material;
+      unsigned long long numXMen;    // Number of ways of placing each group of pieces
+      unsigned long long numOMen;
+      unsigned long long numXKings;
+      unsigned long long numOKings;
+      unsigned long long size;
+};
+
+
+// Values stored in the tablebase, one byte per position, from the point of view of the side to move
+//   - 0 = draw (neither side can force a win), 1 = not a position
+//   - 2 + 2*distance = win, 3 + 2*distance = loss, where distance is the number of turns until the losing side has no moves
+namespace TbValue
+{
+   const unsigned char DRAW = 0;
+   const unsigned char INVALID = 1;
+   const unsigned int MAX_DISTANCE = 126;
+
+   inline unsigned char Win(const unsigned int distance) { return (unsigned char)(2 + 2*distance); }
+   inline unsigned char Loss(const unsigned int distance) { return (unsigned char)(3 + 2*distance); }
+   inline bool IsWin(const unsigned char value) { return (value >= 2) && ((value & 1) == 0); }
+   inline bool IsLoss(const unsigned char value) { return (value >= 2) && ((value & 1) == 1); }
+   inline unsigned int Distance(const unsigned char value) { return (value >= 2 ? (value-2)/2 : 0); }
+}
+
+
+// Class for looking up positions in a tablebase file (which is memory-mapped, so only the parts that are used are read)
+//
+// File layout (numbers are in the machine's byte order, which is little-endian on every platform that the game runs on):
+//   - Header: "DTB1", then 32-bit version, maximum number of pieces, number of slices & positions per block
+//   - One entry per slice: the four piece counts (8 bits each), then a 32-bit padding word, the 64-bit number of positions
+//     & the 64-bit file offset of the slice's block index
+//   - Each block index is (number of blocks + 1) 64-bit file offsets, the last of which is the end of the slice's data
+//   - Each block is run-length encoded as (value, run length - 1) byte pairs (a position that is not a position is given
+//     the value before it, so that it does not break up a run)
+class CTablebase
+{
+   public:
+      static const unsigned int VERSION = 1;
+      static const unsigned int HEADER_SIZE = 20;
+      static const unsigned int SLICE_ENTRY_SIZE = 24;
+      static const unsigned int BLOCK_SIZE = 1024;   // Positions per block
+      static const unsigned int MAX_PIECES = 12;
+
+      CTablebase() : maxPieces(0) {}
+
+      // Function to map a tablebase file (returns false if it could not be opened or is not a tablebase)
+      bool Open(const std::string &filename);
+      void Close();
+      bool IsOpen() const { return file.IsOpen(); }
+
+      // Positions with this many pieces or fewer (& at least one piece on each side) are in the tablebase
+      unsigned int MaxPieces() const { return maxPieces; }
+
+      // Function to look up a position: returns false if the position is not in the tablebase, otherwise the value
+      bool Probe(const CTbPosition &position, unsigned char &value) const;
+
+   private:
+      struct CSliceInfo
+      {
+         CSliceInfo(const CTbMaterial &material, const unsigned long long _blockIndexOffset)
+          : slice(material), blockIndexOffset(_blockIndexOffset) {}
+
+         CTbSlice slice;
+         unsigned long long blockIndexOffset;
+      };
+
+      CMappedFile file;
+      unsigned int maxPieces;
+      std::vector<CSliceInfo> slices;
+      // Slice number for each material (-1 = not in the tablebase), indexed by MaterialKey
+      std::vector<int> sliceLookup;
+
+      unsigned int MaterialKey(const CTbMaterial &material) const;
+
+      // The mapping cannot be shared, so copying is not allowed
+      CTablebase(const CTablebase &);
+      CTablebase &operator=(const CTablebase &);
+};
+
+
+#endif
@@ -0,0 +1,522 @@
+// Generator for the endgame tablebase: solves every 8x8 position with up to N pieces by retrograde analysis, & writes the
+// win/loss/draw & distance-to-win of each position to a compressed, block-indexed file that the AI can probe
+// g++ tbgen.cpp tablebase.cpp -o tbgen.exe -std=c++11 -pthread -O2
+//
+// Usage: tbgen.exe [-pieces N] [-threads N] [-o tablebase file] [-bitbase bitbase source file]
+//   -bitbase  also write the positions with up to 4 pieces as a C++ source file, for building into the game (see bitbase.h)
+//
+// The slices (all of the positions with the same material) are solved in order of the number of pieces, then the number
+// of men, so every jump (which removes a piece) & every crowning (which turns a man into a king) leads to a slice that has
+// already been solved. A slice & its mirror image (the same material with the sides swapped) are solved together, as the
+// moves that do neither lead from one to the other.
+
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>    // std::snprintf
+#include <cstdlib>   // std::atoi
+#include <string>
+#include <vector>
+#include <algorithm> // std::sort
+#include <memory>    // std::unique_ptr
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "tablebase.h"
+#include "bitbase.h"
+
+
+// A slice that is being (or has been) solved: the value of each position, with X to move
+//   - While the slice is being solved, each position also has the round in which it should next be looked at ("wake"),
+//     & flags that are set when one of the positions that it leads to has just been resolved
+struct CSolvedSlice
+{
+   static const unsigned char NEVER = 255;
+
+   explicit CSolvedSlice(const CTbMaterial &material)
+    : slice(material), values(new std::atomic<unsigned char>[slice.Size()]),
+      changed(new std::atomic<unsigned char>[slice.Size()]), wake(new unsigned char[slice.Size()]), maxDistance(0)
+   {
+      for( unsigned long long index = 0 ; index < slice.Size() ; index++ )
+      {
+         values[index].store(TbValue::DRAW, std::memory_order_relaxed);
+         changed[index].store(0, std::memory_order_relaxed);
+         wake[index] = NEVER;
+      }
+   }
+
+   CTbSlice slice;
+   std::unique_ptr< std::atomic<unsigned char>[] > values;
+   std::unique_ptr< std::atomic<unsigned char>[] > changed;   // Bit (round & 1) set = look at the position in that round
+   std::unique_ptr<unsigned char[]> wake;
+   unsigned int maxDistance;
+};
+
+
+// Counters shared by the threads during a round
+struct CRoundCounters
+{
+   CRoundCounters() : nextChunk(0), numResolved(0), numChanged(0), lastWake(0) {}
+
+   std::atomic<unsigned long long> nextChunk;
+   std::atomic<unsigned long long> numResolved;
+   std::atomic<unsigned long long> numChanged;   // Number of positions flagged for the next round
+   std::atomic<unsigned int> lastWake;           // Latest round that any position is waiting for
+};
+
+
+// Class holding every slice that has been solved so far
+class CTablebaseGenerator
+{
+   public:
+      CTablebaseGenerator(const unsigned int _maxPieces, const unsigned int _numThreads)
+       : maxPieces(_maxPieces), numThreads(_numThreads),
+         sliceLookup((_maxPieces+1)*(_maxPieces+1)*(_maxPieces+1)*(_maxPieces+1), -1) {}
+
+      // Function to solve every slice
+      void Generate();
+      // Function to write the tablebase file (returns false if the file could not be written)
+      bool Write(const std::string &filename) const;
+      // Function to write the positions with up to BITBASE_MAX_PIECES pieces as the source of the built-in bitbase
+      bool WriteBitbase(const std::string &filename) const;
+
+   private:
+      unsigned int maxPieces;
+      unsigned int numThreads;
+      std::vector< std::unique_ptr<CSolvedSlice> > slices;
+      std::vector<int> sliceLookup;
+
+      unsigned int MaterialKey(const CTbMaterial &material) const
+      {
+         return ( (material.xMen*(maxPieces+1) + material.xKings)*(maxPieces+1) + material.oMen )*(maxPieces+1) + material.oKings;
+      }
+
+      // Function to get the value of a position in a slice that has been (or is being) solved
+      unsigned char Lookup(const CTbPosition &position) const;
+      // Function to solve a slice together with its mirror image
+      void SolvePair(const CTbMaterial &material);
+      // Function that each thread runs for one round of a pair
+      void Round(const std::vector<CSolvedSlice*> &pair, const unsigned int round, CRoundCounters &counters) const;
+};
+
+
+// --------------------------------------------------------------------------- //
+// Function to describe the material of a slice, e.g. "xxX v oO" (x/o = man, X/O = king)
+// --------------------------------------------------------------------------- //
+
+std::string
+MaterialName(const CTbMaterial &material)
+{
+   return std::string(material.xMen, 'x') + std::string(material.xKings, 'X') + " v " +
+          std::string(material.oMen, 'o') + std::string(material.oKings, 'O');
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the value of a position
+// --------------------------------------------------------------------------- //
+
+unsigned char
+CTablebaseGenerator::Lookup(const CTbPosition &position) const
+{
+   const CTbMaterial material(position);
+   // A side with no pieces left has no moves
+   if( material.xMen + material.xKings == 0 )
+      return TbValue::Loss(0);
+   const CSolvedSlice &solved = *slices[ sliceLookup[MaterialKey(material)] ];
+   return solved.values[ solved.slice.Index(position) ].load(std::memory_order_relaxed);
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function for one round of solving a pair of slices
+//   - In round n, a position is a win in n if one of its turns leads to a loss in n-1 or less (for the opponent), &
+//     a loss in n if all of its turns lead to wins in n-1 or less (round 0 finds the positions with no moves)
+//   - The values are only compared with distances of n-1 or less, so the threads can read the values that other threads
+//     are writing in the same round without the result depending on the order
+//   - Round 0 looks at every position. After that, a position is only looked at again in the round that its turns say
+//     it could be resolved in (its wake round), or in the round after one of the positions that it leads to is resolved
+// --------------------------------------------------------------------------- //
+
+void
+CTablebaseGenerator::Round(const std::vector<CSolvedSlice*> &pair, const unsigned int round, CRoundCounters &counters) const
+{
+   static const unsigned long long CHUNK_SIZE = 4096;
+   const unsigned char thisRound = (unsigned char)(1u << (round & 1));
+   const unsigned char nextRound = (unsigned char)(1u << ((round+1) & 1));
+   std::vector<CTbPosition> turns;
+   std::vector<CTbPosition> previous;
+   unsigned long long threadResolved = 0;
+   unsigned long long threadChanged = 0;
+   unsigned int threadLastWake = 0;
+
+   // The chunks of both slices are numbered one after the other
+   const unsigned long long firstSize = pair[0]->slice.Size();
+   const unsigned long long totalSize = firstSize + ( pair.size() > 1 ? pair[1]->slice.Size() : 0 );
+   for( unsigned long long begin = counters.nextChunk.fetch_add(CHUNK_SIZE) ; begin < totalSize ;
+        begin = counters.nextChunk.fetch_add(CHUNK_SIZE) )
+   {
+      const unsigned long long end = std::min(begin + CHUNK_SIZE, totalSize);
+      for( unsigned long long chunkIndex = begin ; chunkIndex < end ; chunkIndex++ )
+      {
+         CSolvedSlice &solved = *pair[ chunkIndex < firstSize ? 0 : 1 ];
+         const unsigned long long index = ( chunkIndex < firstSize ? chunkIndex : chunkIndex - firstSize );
+         if( solved.values[index].load(std::memory_order_relaxed) != TbValue::DRAW )
+            continue;
+         if( solved.changed[index].load(std::memory_order_relaxed) & thisRound )
+            solved.changed[index].fetch_and( (unsigned char)(~thisRound) );
+         else if( (round > 0) && (solved.wake[index] != round) )
+            continue;
+
+         CTbPosition position;
+         if( !solved.slice.Position(index, position) )
+         {
+            solved.values[index].store(TbValue::INVALID, std::memory_order_relaxed);
+            continue;
+         }
+
+         TbGenerateTurns(position, turns);
+         bool isWin = false;
+         bool allWins = true;
+         unsigned int lossRound = 0;   // Earliest round in which all of the turns could be known to be wins
+         unsigned int wake = CSolvedSlice::NEVER;
+         for( unsigned int turn = 0 ; (turn < turns.size()) && !isWin ; turn++ )
+         {
+            const unsigned char value = Lookup(turns[turn]);
+            if( TbValue::IsLoss(value) )
+            {
+               isWin = (TbValue::Distance(value) < round);
+               wake = std::min(wake, TbValue::Distance(value)+1);
+               allWins = false;
+            }
+            else if( TbValue::IsWin(value) )
+               lossRound = std::max(lossRound, TbValue::Distance(value)+1);
+            else
+               allWins = false;
+         }
+         if( allWins )
+            wake = std::min(wake, lossRound);
+
+         if( isWin )
+            solved.values[index].store(TbValue::Win(round), std::memory_order_relaxed);
+         else if( allWins && (lossRound <= round) )
+            solved.values[index].store(TbValue::Loss(round), std::memory_order_relaxed);
+         else
+         {
+            // Not resolved yet - wait for the round that the turns resolved so far could resolve it in
+            if( wake != CSolvedSlice::NEVER )
+            {
+               solved.wake[index] = (unsigned char)(wake);
+               threadLastWake = std::max(threadLastWake, wake);
+            }
+            continue;
+         }
+         threadResolved++;
+
+         // The positions that can step into this one (the other side of the pair) might be resolved in the next round
+         CSolvedSlice &previousSolved = *pair[ (pair.size() > 1) && (&solved == pair[0]) ? 1 : 0 ];
+         TbGenerateStepsBack(position, previous);
+         for( unsigned int before = 0 ; before < previous.size() ; before++ )
+         {
+            const unsigned long long previousIndex = previousSolved.slice.Index(previous[before]);
+            if( previousSolved.values[previousIndex].load(std::memory_order_relaxed) == TbValue::DRAW )
+            {
+               previousSolved.changed[previousIndex].fetch_or(nextRound);
+               threadChanged++;
+            }
+         }
+      }
+   }
+
+   counters.numResolved += threadResolved;
+   counters.numChanged += threadChanged;
+   unsigned int lastWake = counters.lastWake.load();
+   while( (threadLastWake > lastWake) && !counters.lastWake.compare_exchange_weak(lastWake, threadLastWake) )
+      ;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to solve a slice & its mirror image
+// --------------------------------------------------------------------------- //
+
+void
+CTablebaseGenerator::SolvePair(const CTbMaterial &material)
+{
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+   std::vector<CSolvedSlice*> pair;
+   const CTbMaterial materials[2] = { material, material.Flip() };
+   for( unsigned int side = 0 ; side < (material == material.Flip() ? 1u : 2u) ; side++ )
+   {
+      slices.push_back( std::unique_ptr<CSolvedSlice>( new CSolvedSlice(materials[side]) ) );
+      sliceLookup[MaterialKey(materials[side])] = int(slices.size()) - 1;
+      pair.push_back( slices.back().get() );
+   }
+
+   // Keep going while there are positions flagged for the next round, or waiting for a later round
+   unsigned int round = 0;
+   unsigned int lastWake = 0;
+   for( ; round <= TbValue::MAX_DISTANCE ; round++ )
+   {
+      CRoundCounters counters;
+      counters.lastWake = lastWake;
+      std::vector<std::thread> threads;
+      for( unsigned int thread = 1 ; thread < numThreads ; thread++ )
+         threads.push_back( std::thread( &CTablebaseGenerator::Round, this, std::cref(pair), round, std::ref(counters) ) );
+      Round(pair, round, counters);
+      for( unsigned int thread = 0 ; thread < threads.size() ; thread++ )
+         threads[thread].join();
+
+      lastWake = counters.lastWake;
+      if( (counters.numChanged == 0) && (lastWake <= round) )
+         break;
+   }
+   if( round > TbValue::MAX_DISTANCE )
+      std::cout << "   Warning: distances over " << TbValue::MAX_DISTANCE << " turns have been left as draws\n";
+
+   // The solver's working space is no longer needed
+   for( unsigned int side = 0 ; side < pair.size() ; side++ )
+   {
+      pair[side]->changed.reset();
+      pair[side]->wake.reset();
+   }
+
+   // Report on the slices
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+   unsigned long long numPositions = 0;
+   for( unsigned int side = 0 ; side < pair.size() ; side++ )
+   {
+      unsigned long long numWins = 0, numLosses = 0, numDraws = 0;
+      for( unsigned long long index = 0 ; index < pair[side]->slice.Size() ; index++ )
+      {
+         const unsigned char value = pair[side]->values[index].load(std::memory_order_relaxed);
+         if( TbValue::IsWin(value) )        numWins++;
+         else if( TbValue::IsLoss(value) )  numLosses++;
+         else if( value == TbValue::DRAW )  numDraws++;
+         if( value >= 2 )
+            pair[side]->maxDistance = std::max(pair[side]->maxDistance, TbValue::Distance(value));
+      }
+      numPositions += numWins + numLosses + numDraws;
+      std::cout << "   " << MaterialName(pair[side]->slice.Material()) << ": " << numWins << " wins, " << numLosses << " losses, "
+                << numDraws << " draws, longest win " << pair[side]->maxDistance << " turns\n";
+   }
+   std::cout << "   (" << round << " rounds, " << seconds << "s, " << (seconds > 0.0 ? numPositions/seconds : 0.0) << " positions/s)\n";
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to solve every slice
+// --------------------------------------------------------------------------- //
+
+bool
+MaterialOrder(const CTbMaterial &lhs, const CTbMaterial &rhs)
+{
+   if( lhs.NumPieces() != rhs.NumPieces() )
+      return lhs.NumPieces() < rhs.NumPieces();
+   return (lhs.xMen + lhs.oMen) < (rhs.xMen + rhs.oMen);
+}
+
+void
+CTablebaseGenerator::Generate()
+{
+   // Every material with at least one piece on each side
+   std::vector<CTbMaterial> materials;
+   for( unsigned int xMen = 0 ; xMen <= maxPieces ; xMen++ )
+      for( unsigned int xKings = 0 ; xMen + xKings <= maxPieces ; xKings++ )
+         for( unsigned int oMen = 0 ; xMen + xKings + oMen <= maxPieces ; oMen++ )
+            for( unsigned int oKings = 0 ; xMen + xKings + oMen + oKings <= maxPieces ; oKings++ )
+               if( (xMen + xKings > 0) && (oMen + oKings > 0) )
+                  materials.push_back( CTbMaterial(xMen, xKings, oMen, oKings) );
+   std::stable_sort(materials.begin(), materials.end(), MaterialOrder);
+
+   for( unsigned int material = 0 ; material < materials.size() ; material++ )
+   {
+      if( sliceLookup[MaterialKey(materials[material])] >= 0 )
+         continue;   // Already solved as the mirror image of another slice
+      std::cout << MaterialName(materials[material]) << "\n";
+      SolvePair(materials[material]);
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to write the tablebase file (see CTablebase for the layout)
+// --------------------------------------------------------------------------- //
+
+bool
+CTablebaseGenerator::Write(const std::string &filename) const
+{
+   // Compress each slice into blocks of run-length encoded values
+   std::vector< std::vector<unsigned char> > sliceData(slices.size());
+   std::vector< std::vector<unsigned long long> > blockStarts(slices.size());
+   for( unsigned int slice = 0 ; slice < slices.size() ; slice++ )
+   {
+      const CSolvedSlice &solved = *slices[slice];
+      std::vector<unsigned char> &data = sliceData[slice];
+      unsigned char previous = TbValue::DRAW;
+      for( unsigned long long index = 0 ; index < solved.slice.Size() ; index++ )
+      {
+         if( index % CTablebase::BLOCK_SIZE == 0 )
+            blockStarts[slice].push_back(data.size());
+         unsigned char value = solved.values[index].load(std::memory_order_relaxed);
+         // Any value will do for an index that is not a position, so carry on the current run
+         if( value == TbValue::INVALID )
+            value = previous;
+         previous = value;
+         // Extend the current run if it is the same value, is in the same block & is not full
+         if( (index % CTablebase::BLOCK_SIZE != 0) && (data[data.size()-2] == value) && (data[data.size()-1] < 255) )
+            data[data.size()-1]++;
+         else
+         {
+            data.push_back(value);
+            data.push_back(0);
+         }
+      }
+      blockStarts[slice].push_back(data.size());
+   }
+
+   // Lay out the file: header, slice entries, then each slice's block index followed by its blocks
+   std::vector<char> header(CTablebase::HEADER_SIZE + slices.size()*CTablebase::SLICE_ENTRY_SIZE, 0);
+   const unsigned int headerWords[4] = { CTablebase::VERSION, maxPieces, (unsigned int)(slices.size()), CTablebase::BLOCK_SIZE };
+   std::copy( "DTB1", "DTB1"+4, header.begin() );
+   std::copy( reinterpret_cast<const char*>(headerWords), reinterpret_cast<const char*>(headerWords+4), header.begin()+4 );
+
+   unsigned long long offset = header.size();
+   std::vector<unsigned long long> blockIndexOffsets(slices.size());
+   for( unsigned int slice = 0 ; slice < slices.size() ; slice++ )
+   {
+      blockIndexOffsets[slice] = offset;
+      const unsigned long long dataOffset = offset + blockStarts[slice].size()*sizeof(unsigned long long);
+      for( unsigned int block = 0 ; block < blockStarts[slice].size() ; block++ )
+         blockStarts[slice][block] += dataOffset;
+      offset = dataOffset + sliceData[slice].size();
+
+      const CTbMaterial &material = slices[slice]->slice.Material();
+      char *entry = &header[CTablebase::HEADER_SIZE + slice*CTablebase::SLICE_ENTRY_SIZE];
+      entry[0] = char(material.xMen);
+      entry[1] = char(material.xKings);
+      entry[2] = char(material.oMen);
+      entry[3] = char(material.oKings);
+      const unsigned long long sizes[2] = { slices[slice]->slice.Size(), blockIndexOffsets[slice] };
+      std::copy( reinterpret_cast<const char*>(sizes), reinterpret_cast<const char*>(sizes+2), entry+8 );
+   }
+
+   std::ofstream file(filename.c_str(), std::ios::binary);
+   if( !file )
+      return false;
+   file.write(&header[0], header.size());
+   for( unsigned int slice = 0 ; slice < slices.size() ; slice++ )
+   {
+      file.write(reinterpret_cast<const char*>(&blockStarts[slice][0]), blockStarts[slice].size()*sizeof(unsigned long long));
+      if( !sliceData[slice].empty() )
+         file.write(reinterpret_cast<const char*>(&sliceData[slice][0]), sliceData[slice].size());
+   }
+   std::cout << "Wrote " << offset << " bytes to \"" << filename << "\"\n";
+   return bool(file);
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to write the source of the built-in bitbase (see bitbase.h for the layout)
+// --------------------------------------------------------------------------- //
+
+bool
+CTablebaseGenerator::WriteBitbase(const std::string &filename) const
+{
+   // One bit per position, set if the side to move wins, with the slices one after the other
+   std::vector<unsigned long long> sliceStarts(BITBASE_NUM_MATERIALS, BITBASE_NO_SLICE);
+   std::vector<unsigned long long> bits;
+   unsigned long long numBits = 0;
+   for( unsigned int slice = 0 ; slice < slices.size() ; slice++ )
+   {
+      const CSolvedSlice &solved = *slices[slice];
+      if( solved.slice.Material().NumPieces() > BITBASE_MAX_PIECES )
+         continue;
+      sliceStarts[BitbaseMaterialKey(solved.slice.Material())] = numBits;
+      bits.resize( (numBits + solved.slice.Size() + 63)/64, 0 );
+      for( unsigned long long index = 0 ; index < solved.slice.Size() ; index++, numBits++ )
+         if( TbValue::IsWin(solved.values[index].load(std::memory_order_relaxed)) )
+            bits[numBits/64] |= 1ULL << (numBits%64);
+   }
+
+   std::ofstream file(filename.c_str());
+   if( !file )
+      return false;
+   char word[32];
+   file << "// Built-in bitbase of every position with up to " << std::min(maxPieces, BITBASE_MAX_PIECES) << " pieces (see bitbase.h)\n"
+        << "// Written by tbgen.exe -bitbase - do not edit\n\n"
+        << "#include \"bitbase.h\"\n\n"
+        << "const unsigned long long bitbaseSliceStart[BITBASE_NUM_MATERIALS] =\n{";
+   for( unsigned int material = 0 ; material < sliceStarts.size() ; material++ )
+   {
+      if( sliceStarts[material] == BITBASE_NO_SLICE )
+         std::snprintf(word, sizeof(word), "BITBASE_NO_SLICE,");
+      else
+         std::snprintf(word, sizeof(word), "%lluULL,", sliceStarts[material]);
+      file << ( material % 8 == 0 ? "\n   " : " " ) << word;
+   }
+   file << "\n};\n\nconst unsigned long long bitbaseBits[" << std::max<size_t>(bits.size(), 1) << "] =\n{";
+   for( unsigned int index = 0 ; index < bits.size() ; index++ )
+   {
+      std::snprintf(word, sizeof(word), "0x%016llxULL,", bits[index]);
+      file << ( index % 6 == 0 ? "\n   " : " " ) << word;
+   }
+   file << ( bits.empty() ? "\n   0\n};\n" : "\n};\n" );
+   std::cout << "Wrote " << numBits << " positions to \"" << filename << "\"\n";
+   return bool(file);
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned int maxPieces = 4;
+   unsigned int numThreads = std::thread::hardware_concurrency();
+   std::string outputFilename = "draughts.tb";
+   std::string bitbaseFilename;
+
+   for( int arg = 1 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      const char *value = argv[arg+1];
+      if( option == "-pieces" )         maxPieces = std::atoi(value);
+      else if( option == "-threads" )   numThreads = std::atoi(value);
+      else if( option == "-o" )         outputFilename = value;
+      else if( option == "-bitbase" )   bitbaseFilename = value;
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+   if( numThreads == 0 )
+      numThreads = 1;
+   if( (maxPieces < 2) || (maxPieces > CTablebase::MAX_PIECES) )
+   {
+      std::cout << "The number of pieces must be from 2 to " << CTablebase::MAX_PIECES << "\n";
+      return 1;
+   }
+
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   CTablebaseGenerator generator(maxPieces, numThreads);
+   generator.Generate();
+   std::cout << "Solved in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() << "s\n";
+
+   if( !generator.Write(outputFilename) )
+   {
+      std::cout << "Could not write \"" << outputFilename << "\"\n";
+      return 1;
+   }
+   if( !bitbaseFilename.empty() && !generator.WriteBitbase(bitbaseFilename) )
+   {
+      std::cout << "Could not write \"" << bitbaseFilename << "\"\n";
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,207 @@
+// Timeline tracing of the AI's search, written as Chrome Trace Event JSON (which chrome://tracing & Perfetto can show)
+//   - Tracing is only compiled in with -DDRAUGHTS_TRACE, & then only records while it is turned on (CTracer::Enable),
+//     so the TRACE_SPAN macros cost nothing in a normal build & a load of one flag when tracing is off
+//   - Each thread records the spans that it finishes into its own ring buffer, without locks (once the buffer is full,
+//     the oldest spans are overwritten), & the buffers are flushed to the trace file by CTracer::Flush while no search
+//     is running (e.g. after InvokeAI returns)
+//   - The file is in the JSON array format, which may be left without its closing ']', so each flush simply adds the
+//     new spans to the end of the file
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#ifdef DRAUGHTS_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <memory>    // std::unique_ptr
+#include <mutex>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>    // std::snprintf
+#include <algorithm> // std::stable_sort
+
+
+class CTracer
+{
+   public:
+      // A span of time on one thread: its name, & an optional argument (e.g. the depth of a search iteration)
+      struct CEvent
+      {
+         const char *name;
+         const char *argName;   // 0 = no argument
+         long long argValue;
+         long long startNs;     // Since the tracer was created
+         long long durationNs;
+      };
+
+      // Spans that each thread's buffer keeps between flushes (the most recent ones)
+      static const unsigned int BUFFER_EVENTS = 1 << 14;
+
+      static CTracer &Instance()
+      {
+         static CTracer tracer;
+         return tracer;
+      }
+
+      // Functions to turn the recording on & off
+      void Enable(const bool _enabled) { enabled.store(_enabled, std::memory_order_relaxed); }
+      bool Enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+      long long NowNs() const
+      {
+         return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+      }
+
+      // Function to record a span that the calling thread has finished
+      void Record(const char *name, const char *argName, const long long argValue, const long long startNs)
+      {
+         CBuffer &buffer = ThreadBuffer();
+         const unsigned long long count = buffer.count.load(std::memory_order_relaxed);
+         CEvent &event = buffer.events[count & (BUFFER_EVENTS-1)];
+         event.name = name;
+         event.argName = argName;
+         event.argValue = argValue;
+         event.startNs = startNs;
+         event.durationNs = NowNs() - startNs;
+         buffer.count.store(count+1, std::memory_order_release);
+      }
+
+      // Function to add the spans that each thread has recorded since the last flush to the trace file (the first flush
+      //   starts a new file) & empty the buffers - returns false if the file could not be written. No thread may be
+      //   recording while the spans are flushed
+      bool Flush(const std::string &filename)
+      {
+         std::lock_guard<std::mutex> lock(buffersMutex);
+         std::ofstream out(filename.c_str(), (filename == flushedFilename ? std::ios::app : std::ios::trunc));
+         if( !out )
+            return false;
+         if( filename != flushedFilename )
+         {
+            out << "[";
+            flushedEvents = 0;
+         }
+         flushedFilename = filename;
+
+         for( unsigned int thread = 0 ; thread < buffers.size() ; thread++ )
+         {
+            CBuffer &buffer = *buffers[thread];
+            const unsigned long long count = buffer.count.load(std::memory_order_acquire);
+            // Chrome wants the spans of a thread in order of their start times (a nested span is recorded first, as it
+            //   finishes first)
+            std::vector<const CEvent*> events;
+            for( unsigned long long event = ( count > BUFFER_EVENTS ? count - BUFFER_EVENTS : 0 ) ; event < count ; event++ )
+               events.push_back( &buffer.events[event & (BUFFER_EVENTS-1)] );
+            std::stable_sort( events.begin(), events.end(),
+                              [](const CEvent *a, const CEvent *b) { return a->startNs < b->startNs; } );
+            for( unsigned int event = 0 ; event < events.size() ; event++ )
+            {
+               char line[256];
+               std::snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                             ( flushedEvents > 0 ? "," : "" ), events[event]->name, buffer.tid,
+                             events[event]->startNs / 1000.0, events[event]->durationNs / 1000.0);
+               out << line;
+               if( events[event]->argName != 0 )
+                  out << ",\"args\":{\"" << events[event]->argName << "\":" << events[event]->argValue << "}";
+               out << "}";
+               flushedEvents++;
+            }
+            buffer.count.store(0, std::memory_order_relaxed);
+         }
+         return bool(out);
+      }
+
+   private:
+      CTracer() : enabled(false), startTime(std::chrono::steady_clock::now()), nextTid(0), flushedEvents(0) {}
+
+      struct CBuffer
+      {
+         CBuffer() : count(0), events(new CEvent[BUFFER_EVENTS]), tid(0), finished(false) {}
+
+         std::atomic<unsigned long long> count;   // Spans recorded since the last flush (the buffer holds the last BUFFER_EVENTS)
+         std::unique_ptr<CEvent[]> events;
+         unsigned int tid;                        // Thread id in the trace (each thread that records gets a new one)
+         std::atomic<bool> finished;              // Set when the thread has finished (its buffer can be used by another
+                                                  //   thread once its spans have been flushed)
+      };
+
+      // The thread's buffer, which is marked as finished when the thread finishes
+      struct CThreadBuffer
+      {
+         CThreadBuffer() : buffer(0) {}
+         ~CThreadBuffer()
+         {
+            if( buffer != 0 )
+               buffer->finished.store(true, std::memory_order_release);
+         }
+         CBuffer *buffer;
+      };
+
+      // Function to get the calling thread's buffer, the first time taking one whose thread has finished & whose spans
+      //   have all been flushed (the search starts new threads for every move) or else creating one
+      CBuffer &ThreadBuffer()
+      {
+         static thread_local CThreadBuffer threadBuffer;
+         if( threadBuffer.buffer == 0 )
+         {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            for( unsigned int buffer = 0 ; (buffer < buffers.size()) && (threadBuffer.buffer == 0) ; buffer++ )
+               if( buffers[buffer]->finished.load(std::memory_order_acquire) &&
+                   (buffers[buffer]->count.load(std::memory_order_relaxed) == 0) )
+                  threadBuffer.buffer = buffers[buffer].get();
+            if( threadBuffer.buffer == 0 )
+            {
+               buffers.push_back( std::unique_ptr<CBuffer>(new CBuffer) );
+               threadBuffer.buffer = buffers.back().get();
+            }
+            threadBuffer.buffer->finished.store(false, std::memory_order_relaxed);
+            threadBuffer.buffer->tid = nextTid++;
+         }
+         return *threadBuffer.buffer;
+      }
+
+      std::atomic<bool> enabled;
+      const std::chrono::steady_clock::time_point startTime;
+      std::mutex buffersMutex;
+      std::vector< std::unique_ptr<CBuffer> > buffers;
+      unsigned int nextTid;
+      std::string flushedFilename;   // File that the spans have been flushed to
+      unsigned long long flushedEvents;
+};
+
+
+// Span that lasts until the end of the scope that it is declared in (it is only recorded if tracing was on at its start)
+class CTraceSpan
+{
+   public:
+      explicit CTraceSpan(const char *_name, const char *_argName = 0, const long long _argValue = 0)
+       : name(_name), argName(_argName), argValue(_argValue),
+         startNs( CTracer::Instance().Enabled() ? CTracer::Instance().NowNs() : -1 ) {}
+      ~CTraceSpan()
+      {
+         if( startNs >= 0 )
+            CTracer::Instance().Record(name, argName, argValue, startNs);
+      }
+
+   private:
+      const char *name;
+      const char *argName;
+      long long argValue;
+      long long startNs;
+};
+
+#define TRACE_CONCATENATE_(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_(a, b)
+// Macros to trace the rest of the scope as a span with the given name (a string literal), & optionally an argument
+#define TRACE_SPAN(name) CTraceSpan TRACE_CONCATENATE(traceSpan, __LINE__)(name)
+#define TRACE_SPAN_ARG(name, argName, argValue) CTraceSpan TRACE_CONCATENATE(traceSpan, __LINE__)(name, argName, argValue)
+
+#else
+
+#define TRACE_SPAN(name)
+#define TRACE_SPAN_ARG(name, argName, argValue)
+
+#endif
+
+#endif
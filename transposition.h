@@ -0,0 +1,94 @@
+// Simple transposition table for the AI's tree search
+
+#ifndef _TRANSPOSITION_H
+#define _TRANSPOSITION_H
+
+#include <atomic>
+#include <memory>    // std::unique_ptr
+#include "trace.h"
+
+
+// Table of the scores that the tree search has already worked out, indexed by a hash of the position
+//   - The tree search has no pruning, so every score is exact & can be reused whenever the same position is reached
+//     again at the same depth (including by a later search, e.g. after pondering on the opponent's time)
+//   - Entries are read & written without locks: each entry stores (key ^ data) & data, so an entry that is torn by two
+//     threads writing at once fails the key check & is treated as missing
+class CTranspositionTable
+{
+   public:
+      // Constructors - the number of entries is rounded down to a power of 2
+      explicit CTranspositionTable(const unsigned int _numEntries = 1<<20) { Resize(_numEntries); }
+
+      // Function to change the number of entries (which clears the table - no search may be using the table)
+      void Resize(unsigned int _numEntries)
+      {
+         TRACE_SPAN("ResizeTranspositionTable");
+         numEntries = 1;
+         while( (numEntries*2 <= _numEntries) && (numEntries*2 != 0) )
+            numEntries *= 2;
+         entries.reset( new CEntry[numEntries] );
+         Clear();
+      }
+
+      // Function to empty the table (e.g. when the evaluation weights change, so the stored scores are no longer valid)
+      void Clear()
+      {
+         TRACE_SPAN("ClearTranspositionTable");
+         for( unsigned int entry = 0 ; entry < numEntries ; entry++ )
+         {
+            entries[entry].check.store(0, std::memory_order_relaxed);
+            entries[entry].data.store(0, std::memory_order_relaxed);
+         }
+      }
+
+      // Function to look up the score of a position searched to the given depth (returns false if it is not in the table)
+      bool Probe(const unsigned long long key, const int depth, int &score) const
+      {
+         const unsigned long long depthKey = DepthKey(key, depth);
+         const CEntry &entry = entries[depthKey & (numEntries-1)];
+         const unsigned long long data = entry.data.load(std::memory_order_relaxed);
+         if( ((entry.check.load(std::memory_order_relaxed) ^ data) != depthKey) || (data == 0) || (Depth(data) != depth) )
+            return false;
+         score = int( (unsigned int)(data) );
+         return true;
+      }
+
+      // Function to store the score of a position searched to the given depth (replacing whatever was in its entry)
+      void Store(const unsigned long long key, const int depth, const int score)
+      {
+         const unsigned long long depthKey = DepthKey(key, depth);
+         CEntry &entry = entries[depthKey & (numEntries-1)];
+         // The depth is stored +1 so that an empty entry (data == 0) can never match
+         const unsigned long long data = ( (unsigned long long)(depth+1) << 32 ) | (unsigned int)(score);
+         entry.check.store(depthKey ^ data, std::memory_order_relaxed);
+         entry.data.store(data, std::memory_order_relaxed);
+      }
+
+      unsigned int NumEntries() const { return numEntries; }
+      unsigned long long Bytes() const { return (unsigned long long)numEntries * sizeof(CEntry); }
+
+   private:
+      struct CEntry
+      {
+         std::atomic<unsigned long long> check;   // DepthKey ^ data
+         std::atomic<unsigned long long> data;    // (depth+1) << 32 | score
+      };
+
+      static int Depth(const unsigned long long data) { return int(data >> 32) - 1; }
+      // The same position searched to different depths goes in different entries, so that the shallow searches of
+      //   iterative deepening do not overwrite the scores of deeper searches (e.g. from pondering)
+      static unsigned long long DepthKey(const unsigned long long key, const int depth)
+      {
+         return key ^ ( (unsigned long long)(depth+1) * 0x9E3779B97F4A7C15ULL );
+      }
+
+      std::unique_ptr<CEntry[]> entries;
+      unsigned int numEntries;
+
+      // The table is large, so copying is not allowed
+      CTranspositionTable(const CTranspositionTable &);
+      CTranspositionTable &operator=(const CTranspositionTable &);
+};
+
+
+#endif
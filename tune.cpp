@@ -0,0 +1,368 @@
+// Tuner for the AI's evaluation weights (Texel-style: minimise the logistic loss between the
+// static evaluation of a set of positions & the results of the games that they came from)
+// g++ tune.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp -o tune.exe -std=c++11 -pthread
+//
+// Usage: tune.exe <positions file> [-o weights file] [-init weights file] [-method adam|cd]
+//                 [-iterations N] [-rate R] [-k K] [-scale S] [-threads N]
+//
+// The positions file has one position per line: "<position string> <result>", where the position string is in
+// the format read by CBoard::SetPosition & the result is X's score in the game (1 = X won, 0.5 = draw, 0 = O won)
+
+
+#include <iostream>
+#include <cstdlib>   // std::atof, std::atoi
+#include <cstring>   // std::memchr
+#include <cmath>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "board.h"
+#include "evaluation.h"
+#include "mappedfile.h"
+
+
+// A position from the training set, reduced to its evaluation features (measured for X) & the game result for X
+struct CTrainingPosition
+{
+   signed char features[NUM_EVAL_FEATURES];
+   float result;
+};
+
+// Each thread owns a slice of the training set, so that the evaluation of the positions can be split between threads
+typedef std::vector<CTrainingPosition> TrainingSlice;
+
+
+// --------------------------------------------------------------------------- //
+// Function to parse the lines in [begin,end) of the positions file into a slice of training positions
+// --------------------------------------------------------------------------- //
+
+void
+ParseSlice(const char *begin, const char *end, TrainingSlice &slice, unsigned int &numRejected)
+{
+   CBoard board;
+   numRejected = 0;
+
+   while( begin < end )
+   {
+      const char *lineEnd = static_cast<const char*>(std::memchr(begin, '\n', end-begin));
+      if( lineEnd == 0 )
+         lineEnd = end;
+      std::string line(begin, lineEnd);
+      begin = lineEnd+1;
+
+      // Allow for files with Windows line endings
+      if( !line.empty() && (line[line.size()-1] == '\r') )
+         line.erase(line.size()-1);
+      if( line.empty() || (line[0] == '#') )
+         continue;
+
+      // The result is the last word on the line, everything before it is the position
+      const std::string::size_type lastSpace = line.find_last_of(' ');
+      if( (lastSpace == std::string::npos) || !board.SetPosition(line.substr(0, lastSpace)) )
+      {
+         numRejected++;
+         continue;
+      }
+
+      int features[NUM_EVAL_FEATURES];
+      board.GetEvalFeatures(true, features);
+
+      CTrainingPosition position;
+      for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+         position.features[feature] = static_cast<signed char>(features[feature]);
+      position.result = static_cast<float>(std::atof(line.c_str()+lastSpace+1));
+      slice.push_back(position);
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to calculate the logistic loss (& optionally its gradient) over one slice of the training set
+//   - The prediction for each position is sigmoid(k * evaluation), where evaluation is the weighted sum of the features
+//   - The loss is the cross-entropy between the prediction & the game result
+// --------------------------------------------------------------------------- //
+
+void
+SliceLoss(const TrainingSlice &slice, const std::vector<double> &weights, const double k,
+          double &loss, std::vector<double> *gradient)
+{
+   loss = 0.0;
+   if( gradient )
+      gradient->assign(NUM_EVAL_FEATURES, 0.0);
+
+   for( unsigned int index = 0 ; index < slice.size() ; index++ )
+   {
+      const CTrainingPosition &position = slice[index];
+      double evaluation = 0.0;
+      for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+         evaluation += weights[feature]*position.features[feature];
+
+      const double prediction = 1.0/(1.0 + std::exp(-k*evaluation));
+      // Clamp the prediction so that a confidently wrong prediction does not produce an infinite loss
+      const double clamped = std::min(std::max(prediction, 1e-12), 1.0-1e-12);
+      loss -= position.result*std::log(clamped) + (1.0-position.result)*std::log(1.0-clamped);
+
+      if( gradient )
+      {
+         // d(loss)/d(weight) = (prediction - result) * k * feature
+         const double error = (prediction - position.result)*k;
+         for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+            (*gradient)[feature] += error*position.features[feature];
+      }
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to calculate the mean loss (& optionally its gradient) over the whole training set, using one thread per slice
+//   - Each thread accumulates its own loss & gradient, and these are reduced once all of the threads have finished
+// --------------------------------------------------------------------------- //
+
+double
+TotalLoss(const std::vector<TrainingSlice> &slices, const unsigned int numPositions,
+          const std::vector<double> &weights, const double k, std::vector<double> *gradient)
+{
+   std::vector<double> sliceLoss(slices.size());
+   std::vector< std::vector<double> > sliceGradient(slices.size());
+   std::vector<std::thread> threads;
+
+   for( unsigned int slice = 0 ; slice < slices.size() ; slice++ )
+      threads.push_back( std::thread( SliceLoss, std::cref(slices[slice]), std::cref(weights), k,
+                                      std::ref(sliceLoss[slice]), (gradient ? &sliceGradient[slice] : 0) ) );
+   for( unsigned int thread = 0 ; thread < threads.size() ; thread++ )
+      threads[thread].join();
+
+   double loss = 0.0;
+   if( gradient )
+      gradient->assign(NUM_EVAL_FEATURES, 0.0);
+   for( unsigned int slice = 0 ; slice < slices.size() ; slice++ )
+   {
+      loss += sliceLoss[slice];
+      if( gradient )
+         for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+            (*gradient)[feature] += sliceGradient[slice][feature]/numPositions;
+   }
+
+   return loss/numPositions;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to find the sigmoid scaling k that best fits the initial weights (golden-section search)
+// --------------------------------------------------------------------------- //
+
+double
+FitK(const std::vector<TrainingSlice> &slices, const unsigned int numPositions, const std::vector<double> &weights)
+{
+   const double ratio = (std::sqrt(5.0)-1.0)/2.0;
+   double lower = 0.01, upper = 10.0;
+   for( int iteration = 0 ; iteration < 30 ; iteration++ )
+   {
+      const double k1 = upper - ratio*(upper-lower);
+      const double k2 = lower + ratio*(upper-lower);
+      if( TotalLoss(slices, numPositions, weights, k1, 0) < TotalLoss(slices, numPositions, weights, k2, 0) )
+         upper = k2;
+      else
+         lower = k1;
+   }
+   return (lower+upper)/2.0;
+}
+
+
+int main(int argc, char **argv)
+{
+   if( argc < 2 )
+   {
+      std::cout << "Usage: " << argv[0] << " <positions file> [-o weights file] [-init weights file] [-method adam|cd]\n"
+                << "          [-iterations N] [-rate R] [-k K] [-scale S] [-threads N]\n";
+      return 1;
+   }
+
+   // Default options
+   std::string positionsFilename = argv[1];
+   std::string outputFilename = "weights.txt";
+   std::string method = "adam";
+   unsigned int numIterations = 1000;
+   double learningRate = 0.01;
+   double k = 0.0;        // 0 = fit k to the initial weights
+   double scale = 100.0;  // Engine weights are integers: engine weight = round(scale * tuned weight)
+   unsigned int numThreads = std::thread::hardware_concurrency();
+   CEvalWeights initialWeights = CBoard::GetEvalWeights();
+
+   for( int arg = 2 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      const char *value = argv[arg+1];
+      if( option == "-o" )                outputFilename = value;
+      else if( option == "-method" )      method = value;
+      else if( option == "-iterations" )  numIterations = std::atoi(value);
+      else if( option == "-rate" )        learningRate = std::atof(value);
+      else if( option == "-k" )           k = std::atof(value);
+      else if( option == "-scale" )       scale = std::atof(value);
+      else if( option == "-threads" )     numThreads = std::atoi(value);
+      else if( option == "-init" )
+      {
+         if( !initialWeights.Load(value) )
+         {
+            std::cout << "Could not load the initial weights from \"" << value << "\"\n";
+            return 1;
+         }
+      }
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+   if( numThreads == 0 )
+      numThreads = 1;
+   if( (method != "adam") && (method != "cd") )
+   {
+      std::cout << "Method \"" << method << "\" not recognised (use adam or cd)\n";
+      return 1;
+   }
+
+   // ------------------------------------------------------------------
+   // Load the positions, splitting the mapped file between the threads at line boundaries
+   // ------------------------------------------------------------------
+   CMappedFile positionsFile;
+   if( !positionsFile.Open(positionsFilename) )
+   {
+      std::cout << "Could not open \"" << positionsFilename << "\"\n";
+      return 1;
+   }
+   std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+   const char *fileBegin = positionsFile.Data();
+   const char *fileEnd = fileBegin + positionsFile.Size();
+   std::vector<TrainingSlice> slices(numThreads);
+   std::vector<unsigned int> numRejected(numThreads, 0);
+   std::vector<std::thread> threads;
+   const char *sliceBegin = fileBegin;
+   for( unsigned int thread = 0 ; thread < numThreads ; thread++ )
+   {
+      const char *sliceEnd = fileBegin + (positionsFile.Size()*(thread+1))/numThreads;
+      if( thread+1 == numThreads )
+         sliceEnd = fileEnd;
+      // Move the end of the slice onto the start of the next line
+      while( (sliceEnd < fileEnd) && (sliceEnd > sliceBegin) && (sliceEnd[-1] != '\n') )
+         sliceEnd++;
+      if( sliceEnd < sliceBegin )
+         sliceEnd = sliceBegin;
+      threads.push_back( std::thread( ParseSlice, sliceBegin, sliceEnd, std::ref(slices[thread]), std::ref(numRejected[thread]) ) );
+      sliceBegin = sliceEnd;
+   }
+   unsigned int numPositions = 0;
+   unsigned int totalRejected = 0;
+   for( unsigned int thread = 0 ; thread < numThreads ; thread++ )
+   {
+      threads[thread].join();
+      numPositions += slices[thread].size();
+      totalRejected += numRejected[thread];
+   }
+   positionsFile.Close();
+
+   const double loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+   std::cout << "Loaded " << numPositions << " positions in " << loadTime << "s using " << numThreads << " threads";
+   if( totalRejected > 0 )
+      std::cout << " (" << totalRejected << " invalid lines skipped)";
+   std::cout << "\n";
+   if( numPositions == 0 )
+      return 1;
+
+   // ------------------------------------------------------------------
+   // Tune the weights (in units of the initial weight of a man)
+   // ------------------------------------------------------------------
+   const double initialScale = ( initialWeights.weights[EVAL_MEN] != 0 ? initialWeights.weights[EVAL_MEN] : 1 );
+   std::vector<double> weights(NUM_EVAL_FEATURES);
+   for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+      weights[feature] = initialWeights.weights[feature]/initialScale;
+
+   if( k <= 0.0 )
+   {
+      k = FitK(slices, numPositions, weights);
+      std::cout << "Fitted k = " << k << "\n";
+   }
+
+   double loss = TotalLoss(slices, numPositions, weights, k, 0);
+   std::cout << "Initial loss = " << loss << "\n";
+
+   if( method == "adam" )
+   {
+      const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+      std::vector<double> gradient, m(NUM_EVAL_FEATURES, 0.0), v(NUM_EVAL_FEATURES, 0.0);
+      for( unsigned int iteration = 1 ; iteration <= numIterations ; iteration++ )
+      {
+         loss = TotalLoss(slices, numPositions, weights, k, &gradient);
+         for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+         {
+            m[feature] = beta1*m[feature] + (1.0-beta1)*gradient[feature];
+            v[feature] = beta2*v[feature] + (1.0-beta2)*gradient[feature]*gradient[feature];
+            const double mHat = m[feature]/(1.0-std::pow(beta1, double(iteration)));
+            const double vHat = v[feature]/(1.0-std::pow(beta2, double(iteration)));
+            weights[feature] -= learningRate*mHat/(std::sqrt(vHat)+epsilon);
+         }
+         if( (iteration % 100) == 0 )
+            std::cout << "Iteration " << iteration << ": loss = " << loss << "\n";
+      }
+   }
+   else // method == "cd"
+   {
+      // Coordinate descent: nudge each weight by the smallest step that the engine can represent, keeping improvements
+      const double step = 1.0/scale;
+      bool improved = true;
+      for( unsigned int iteration = 1 ; (iteration <= numIterations) && improved ; iteration++ )
+      {
+         improved = false;
+         for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+         {
+            const double original = weights[feature];
+            const double directions[2] = { step, -step };
+            for( int direction = 0 ; direction < 2 ; direction++ )
+            {
+               weights[feature] = original + directions[direction];
+               const double newLoss = TotalLoss(slices, numPositions, weights, k, 0);
+               if( newLoss < loss )
+               {
+                  loss = newLoss;
+                  improved = true;
+                  break;
+               }
+               weights[feature] = original;
+            }
+         }
+         if( (iteration % 10) == 0 )
+            std::cout << "Iteration " << iteration << ": loss = " << loss << "\n";
+      }
+   }
+   loss = TotalLoss(slices, numPositions, weights, k, 0);
+   std::cout << "Final loss = " << loss << "\n";
+
+   // ------------------------------------------------------------------
+   // Write the weights in the engine's (integer) format
+   // ------------------------------------------------------------------
+   CEvalWeights tunedWeights;
+   for( int feature = 0 ; feature < NUM_EVAL_FEATURES ; feature++ )
+   {
+      tunedWeights.weights[feature] = int(std::floor(weights[feature]*scale + 0.5));
+      std::cout << "   " << CEvalWeights::FeatureName(feature) << " = " << tunedWeights.weights[feature] << "\n";
+   }
+   // Keep the win score at the same multiple of a man's value as it was initially
+   tunedWeights.winScore = int(std::floor((initialWeights.winScore/initialScale)*scale + 0.5));
+
+   if( !tunedWeights.Save(outputFilename) )
+   {
+      std::cout << "Could not write \"" << outputFilename << "\"\n";
+      return 1;
+   }
+   std::cout << "Weights written to \"" << outputFilename << "\"\n";
+
+   return 0;
+}
@@ -0,0 +1,192 @@
+// Definition of class functions for the result database of a solved board variant
+
+#include "variantdb.h"
+
+#include <algorithm> // std::remove
+#include <fstream>
+#include <cstring>   // std::memcmp, std::memcpy
+
+// Definition of the constant that is passed by reference (e.g. to std::vector::assign)
+const unsigned short CVariantDatabase::DRAW;
+
+
+// --------------------------------------------------------------------------- //
+// Function to map a database file & check its header
+// --------------------------------------------------------------------------- //
+
+bool
+CVariantDatabase::Open(const std::string &filename)
+{
+   Close();
+   if( !file.Open(filename) )
+      return false;
+
+   const char *data = file.Data();
+   unsigned int header[4];   // version, board width, board height, pieces per side
+   if( (file.Size() < HEADER_SIZE) || (std::memcmp(data, "DVS1", 4) != 0) )
+   {
+      Close();
+      return false;
+   }
+   std::memcpy(header, data + 4, sizeof(header));
+   std::memcpy(&numPositions, data + 24, sizeof(numPositions));
+   if( (header[0] != VERSION) || (file.Size() != HEADER_SIZE + numPositions*(sizeof(unsigned long long) + sizeof(unsigned short))) )
+   {
+      Close();
+      return false;
+   }
+   width = header[1];
+   height = header[2];
+   pieces = header[3];
+   return true;
+}
+
+void
+CVariantDatabase::Close()
+{
+   file.Close();
+   width = 0;
+   height = 0;
+   pieces = 0;
+   numPositions = 0;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions to get the key & value of a position
+// --------------------------------------------------------------------------- //
+
+unsigned long long
+CVariantDatabase::Key(const unsigned long long index) const
+{
+   unsigned long long key;
+   std::memcpy(&key, file.Data() + HEADER_SIZE + index*sizeof(key), sizeof(key));
+   return key;
+}
+
+unsigned short
+CVariantDatabase::Value(const unsigned long long index) const
+{
+   unsigned short value;
+   std::memcpy(&value, file.Data() + HEADER_SIZE + numPositions*sizeof(unsigned long long) + index*sizeof(value), sizeof(value));
+   return value;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to look up a board (binary search of the keys)
+// --------------------------------------------------------------------------- //
+
+bool
+CVariantDatabase::Probe(const CBoard &board, unsigned short &value) const
+{
+   unsigned long long key = 0;
+   if( !IsOpen() || (board.Width() != width) || (board.Height() != height) || !PositionKey(board, key) )
+      return false;
+
+   unsigned long long low = 0;            // The key is in [low, high) if it is in the database at all
+   unsigned long long high = numPositions;
+   while( low < high )
+   {
+      const unsigned long long middle = low + (high - low)/2;
+      const unsigned long long middleKey = Key(middle);
+      if( middleKey < key )
+         low = middle + 1;
+      else if( middleKey > key )
+         high = middle;
+      else
+      {
+         value = Value(middle);
+         return true;
+      }
+   }
+   return false;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Functions to convert between a board & its key
+//   - The squares are visited in the scan order of layout 1, reading each one from its mirror image if the board is in
+//     layout 0
+// --------------------------------------------------------------------------- //
+
+bool
+CVariantDatabase::PositionKey(const CBoard &board, unsigned long long &key)
+{
+   const unsigned int width = board.Width(), height = board.Height();
+   if( (width*height + 1)/2 > MAX_SQUARES )
+      return false;
+
+   // The position string without the row separators & side to move
+   std::string squares = board.GetPosition();
+   squares.erase( std::remove(squares.begin(), squares.end(), '/'), squares.end() );
+
+   key = 0;
+   unsigned long long power = 1;
+   for( unsigned int y = 0 ; y < height ; y++ )
+      for( unsigned int x = 0 ; x < width ; x++ )
+      {
+         const char square = squares[y*width + (board.Layout() ? x : width-1-x)];
+         if( ((x + y) & 1) == 0 )
+         {
+            // A piece on a square that is not playable cannot be given a key
+            if( square != '.' )
+               return false;
+            continue;
+         }
+         const unsigned int contents = ( square == 'x' ? 1 : square == 'X' ? 2 : square == 'o' ? 3 : square == 'O' ? 4 : 0 );
+         key += contents * power;
+         power *= 5;
+      }
+   key = 2*key + (board.IsXTurn() ? 1 : 0);
+   return true;
+}
+
+std::string
+CVariantDatabase::KeyPosition(unsigned long long key, const unsigned int width, const unsigned int height)
+{
+   const bool isXTurn = (key & 1) != 0;
+   key /= 2;
+
+   std::string position;
+   for( unsigned int y = 0 ; y < height ; y++ )
+   {
+      if( y > 0 )
+         position += '/';
+      for( unsigned int x = 0 ; x < width ; x++ )
+      {
+         char square = '.';
+         if( ((x + y) & 1) != 0 )
+         {
+            square = ".xXoO"[key % 5];
+            key /= 5;
+         }
+         position += square;
+      }
+   }
+   position += ( isXTurn ? " x" : " o" );
+   return position;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to write a database file
+// --------------------------------------------------------------------------- //
+
+bool
+CVariantDatabase::Write(const std::string &filename, const unsigned int width, const unsigned int height,
+                        const unsigned int pieces, const std::vector<unsigned long long> &keys,
+                        const std::vector<unsigned short> &values)
+{
+   std::ofstream file(filename.c_str(), std::ios::binary);
+   if( !file || (keys.size() != values.size()) )
+      return false;
+   const unsigned int header[5] = { VERSION, width, height, pieces, 0 };
+   const unsigned long long numPositions = keys.size();
+   file.write("DVS1", 4);
+   file.write(reinterpret_cast<const char*>(header), sizeof(header));
+   file.write(reinterpret_cast<const char*>(&numPositions), sizeof(numPositions));
+   file.write(reinterpret_cast<const char*>(keys.data()), keys.size()*sizeof(unsigned long long));
+   file.write(reinterpret_cast<const char*>(values.data()), values.size()*sizeof(unsigned short));
+   return bool(file);
+}
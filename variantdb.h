@@ -0,0 +1,87 @@
+// Declaration of class for the result database of a solved board variant (the exact result of every position that can
+//   be reached from the variant's starting position)
+
+#ifndef _VARIANTDB_H
+#define _VARIANTDB_H
+
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+#include "board.h"
+
+
+// Class for looking up positions in a variant's result database (written by varsolve.cpp)
+//   - Each position has an exact key: the playable squares are numbered in scan order, as they are when
+//     CBoard::Layout() is true (the other layout is looked up as its mirror image), & the key is
+//     2 * (sum of 5^square * contents of the square) + (1 if X is to move), where the contents are 0 = empty,
+//     1 = x man, 2 = x king, 3 = o man & 4 = o king - which fits in 64 bits for up to 25 playable squares
+//   - The values are from the point of view of the side to move, in the same scheme as TbValue but with 16 bits
+//
+// File layout (numbers are in the machine's byte order, which is little-endian on every platform that the game runs on):
+//   - Header: "DVS1", then 32-bit version, board width, board height, pieces per side & padding, & the 64-bit number of
+//     positions
+//   - The 64-bit keys of the positions in ascending order, then the 16-bit value of each position in the same order
+class CVariantDatabase
+{
+   public:
+      static const unsigned int VERSION = 1;
+      static const unsigned int HEADER_SIZE = 32;
+      static const unsigned int MAX_SQUARES = 25;
+
+      // Values: 0 = draw (neither side can force a win), 2 + 2*distance = win, 3 + 2*distance = loss, where distance is
+      //   the number of turns until the losing side has no moves
+      static const unsigned short DRAW = 0;
+      static const unsigned int MAX_DISTANCE = 32766;
+      static unsigned short Win(const unsigned int distance) { return (unsigned short)(2 + 2*distance); }
+      static unsigned short Loss(const unsigned int distance) { return (unsigned short)(3 + 2*distance); }
+      static bool IsWin(const unsigned short value) { return (value >= 2) && ((value & 1) == 0); }
+      static bool IsLoss(const unsigned short value) { return (value >= 2) && ((value & 1) == 1); }
+      static unsigned int Distance(const unsigned short value) { return (value >= 2 ? (value-2)/2 : 0); }
+
+      CVariantDatabase() : width(0), height(0), pieces(0), numPositions(0) {}
+
+      // Function to map a database file (returns false if it could not be opened or is not a result database)
+      bool Open(const std::string &filename);
+      void Close();
+      bool IsOpen() const { return file.IsOpen(); }
+
+      // The variant that the database is for
+      unsigned int Width() const { return width; }
+      unsigned int Height() const { return height; }
+      unsigned int Pieces() const { return pieces; }
+      unsigned long long NumPositions() const { return numPositions; }
+
+      // Functions to get the key & value of the position with the given index (from 0 to NumPositions()-1)
+      unsigned long long Key(const unsigned long long index) const;
+      unsigned short Value(const unsigned long long index) const;
+
+      // Function to look up a board between turns: returns false if it is not in the database (e.g. it is a different
+      //   size of board, or the position cannot be reached from the starting position)
+      bool Probe(const CBoard &board, unsigned short &value) const;
+
+      // Functions to convert between a board & its key (PositionKey returns false if the board has too many playable
+      //   squares, & KeyPosition gives the position string for CBoard::SetPosition, with the board in layout 1)
+      static bool PositionKey(const CBoard &board, unsigned long long &key);
+      static std::string KeyPosition(unsigned long long key, const unsigned int width, const unsigned int height);
+
+      // Function to write a database file from the keys (which must be in ascending order) & values - returns false if it
+      //   could not be written
+      static bool Write(const std::string &filename, const unsigned int width, const unsigned int height,
+                        const unsigned int pieces, const std::vector<unsigned long long> &keys,
+                        const std::vector<unsigned short> &values);
+
+   private:
+      CMappedFile file;
+      unsigned int width;
+      unsigned int height;
+      unsigned int pieces;
+      unsigned long long numPositions;
+
+      // The mapping cannot be shared, so copying is not allowed
+      CVariantDatabase(const CVariantDatabase &);
+      CVariantDatabase &operator=(const CVariantDatabase &);
+};
+
+
+#endif
@@ -0,0 +1,439 @@
+// Solver for the small board variants: finds every position that can be reached from the variant's starting position (or
+// from a given position), solves all of them exactly by retrograde analysis, & writes the result of each position to a
+// database - which can then be used to check the AI & the proof-number solver against the exact results
+// g++ varsolve.cpp variantdb.cpp solver.cpp board.cpp evaluation.cpp mcts.cpp bitslice.cpp tablebase.cpp book.cpp -o varsolve.exe -std=c++11 -pthread -O2
+//
+// Usage: varsolve.exe [-variant 6x6/7x7] [-position "<position>"] [-threads N] [-o database file]
+//        varsolve.exe -check <database file> [-positions N] [-depth N] [-nodes N] [-threads N]
+//   -position  solve the positions that can be reached from this position (see CBoard::SetPosition), with X to move
+//              first unless the position says otherwise, instead of from the starting position
+//   -check     pick random positions from a database, & check that the proof-number solver never contradicts their
+//              results (given up to -nodes positions each, default 100000), & how often the AI's turn at search depth
+//              -depth (default 5) keeps a win or a draw
+//
+// The positions are found a turn at a time from the starting position (each turn's new positions are expanded on all of
+// the threads at once), & the turns that lead from each position are linked to the positions they lead to. The results
+// are then worked out backwards from the ends of the games, a round at a time: in round N, every position that has a turn
+// leading to a position lost in N-1 turns is won in N turns, & every position whose turns all lead to positions won in
+// fewer than N turns is lost in N turns. Whatever is left when a round finds nothing new is a draw (neither side can force
+// a win, so the game can go on forever).
+
+
+#include <iostream>
+#include <cstdlib>   // std::atoi, std::strtoull
+#include <string>
+#include <vector>
+#include <algorithm> // std::sort, std::unique, std::set_difference, std::merge, std::lower_bound
+#include <iterator>  // std::back_inserter
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <random>
+#include "board.h"
+#include "solver.h"
+#include "variantdb.h"
+
+
+// --------------------------------------------------------------------------- //
+// Function to get the key of the position that each of the side to move's turns leads to (following each multi-jump to
+//   its end)
+// --------------------------------------------------------------------------- //
+
+static void
+GetTurnKeys(const CBoard &board, std::vector<unsigned long long> &keys)
+{
+   std::vector<CBoard::CMove> moves;
+   board.GetLegalMoves(moves);
+   for( unsigned int move = 0 ; move < moves.size() ; move++ )
+   {
+      CBoard moved = board;
+      moved.MakeMove(moves[move]);
+      if( moved.IsXTurn() == board.IsXTurn() )
+         GetTurnKeys(moved, keys);
+      else
+      {
+         unsigned long long key = 0;
+         CVariantDatabase::PositionKey(moved, key);
+         keys.push_back(key);
+      }
+   }
+}
+
+
+// Class for solving every position that can be reached from a starting position
+class CVariantSolver
+{
+   public:
+      CVariantSolver(const CBoard &_start, const unsigned int _numThreads)
+       : start(_start), numThreads(_numThreads) {}
+
+      // Functions for the three stages of the solve
+      void Enumerate();
+      bool Link();
+      void Solve();
+
+      bool Write(const std::string &filename, const unsigned int pieces) const
+      {
+         return CVariantDatabase::Write(filename, start.Width(), start.Height(), pieces, keys, values);
+      }
+
+      // Function to get the result of a position that has been solved
+      unsigned short Value(const unsigned long long key) const
+      {
+         return values[ std::lower_bound(keys.begin(), keys.end(), key) - keys.begin() ];
+      }
+
+   private:
+      static const unsigned long long CHUNK_SIZE = 1024;
+
+      CBoard start;
+      unsigned int numThreads;
+
+      // Every position (in ascending order of key), the positions that each one's turns lead to (the turns of position i
+      //   are successors[firstSuccessor[i]] to successors[firstSuccessor[i+1]-1], as indices into keys), & the results
+      std::vector<unsigned long long> keys;
+      std::vector<unsigned long long> firstSuccessor;
+      std::vector<unsigned int> successors;
+      std::vector<unsigned short> values;
+
+      // Function to run function(thread, begin, end) on all of the threads, for chunks of [0, count) at a time
+      template<typename Function>
+      void ForEachChunk(const unsigned long long count, Function function) const;
+
+      CBoard Position(const unsigned long long key) const
+      {
+         CBoard board = start;
+         board.SetPosition( CVariantDatabase::KeyPosition(key, start.Width(), start.Height()) );
+         return board;
+      }
+};
+
+
+template<typename Function>
+void
+CVariantSolver::ForEachChunk(const unsigned long long count, Function function) const
+{
+   std::atomic<unsigned long long> nextChunk(0);
+   std::vector<std::thread> threads;
+   for( unsigned int thread = 0 ; thread < numThreads ; thread++ )
+      threads.push_back( std::thread( [&nextChunk, &function, count, thread]()
+                                      {
+                                         for( unsigned long long begin = nextChunk.fetch_add(CHUNK_SIZE) ; begin < count ;
+                                              begin = nextChunk.fetch_add(CHUNK_SIZE) )
+                                            function(thread, begin, std::min(begin + CHUNK_SIZE, count));
+                                      } ) );
+   for( unsigned int thread = 0 ; thread < threads.size() ; thread++ )
+      threads[thread].join();
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to find every position that can be reached from the starting position, a turn at a time
+// --------------------------------------------------------------------------- //
+
+void
+CVariantSolver::Enumerate()
+{
+   unsigned long long startKey = 0;
+   CVariantDatabase::PositionKey(start, startKey);
+   keys.assign(1, startKey);
+   std::vector<unsigned long long> frontier(keys);
+
+   for( unsigned int turn = 1 ; !frontier.empty() ; turn++ )
+   {
+      // Expand the positions that were new last turn, each thread collecting the positions it finds
+      std::vector< std::vector<unsigned long long> > found(numThreads);
+      ForEachChunk( frontier.size(), [this, &frontier, &found](const unsigned int thread, const unsigned long long begin,
+                                                               const unsigned long long end)
+                                     {
+                                        for( unsigned long long position = begin ; position < end ; position++ )
+                                           GetTurnKeys(Position(frontier[position]), found[thread]);
+                                     } );
+
+      // Keep the ones that have not been seen before
+      std::vector<unsigned long long> reached;
+      for( unsigned int thread = 0 ; thread < numThreads ; thread++ )
+      {
+         reached.insert(reached.end(), found[thread].begin(), found[thread].end());
+         std::vector<unsigned long long>().swap(found[thread]);
+      }
+      std::sort(reached.begin(), reached.end());
+      reached.erase( std::unique(reached.begin(), reached.end()), reached.end() );
+      frontier.clear();
+      std::set_difference(reached.begin(), reached.end(), keys.begin(), keys.end(), std::back_inserter(frontier));
+
+      std::vector<unsigned long long> merged(keys.size() + frontier.size());
+      std::merge(keys.begin(), keys.end(), frontier.begin(), frontier.end(), merged.begin());
+      keys.swap(merged);
+      std::cout << "Turn " << turn << ": " << frontier.size() << " new positions, " << keys.size() << " in total\n";
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to link each position to the positions that its turns lead to (returns false if there are too many positions
+//   to index)
+//   - Each chunk of positions is linked separately, & the chunks are then joined together in order
+// --------------------------------------------------------------------------- //
+
+bool
+CVariantSolver::Link()
+{
+   if( keys.size() >= 0xFFFFFFFFULL )
+      return false;
+
+   const unsigned long long numChunks = (keys.size() + CHUNK_SIZE-1) / CHUNK_SIZE;
+   std::vector< std::vector<unsigned int> > chunkSuccessors(numChunks);
+   firstSuccessor.assign(keys.size() + 1, 0);
+   ForEachChunk( keys.size(), [this, &chunkSuccessors](const unsigned int, const unsigned long long begin,
+                                                       const unsigned long long end)
+                              {
+                                 std::vector<unsigned long long> turnKeys;
+                                 std::vector<unsigned int> &chunk = chunkSuccessors[begin / CHUNK_SIZE];
+                                 for( unsigned long long position = begin ; position < end ; position++ )
+                                 {
+                                    turnKeys.clear();
+                                    GetTurnKeys(Position(keys[position]), turnKeys);
+                                    // Two turns can lead to the same position, which only needs to be looked at once
+                                    std::sort(turnKeys.begin(), turnKeys.end());
+                                    turnKeys.erase( std::unique(turnKeys.begin(), turnKeys.end()), turnKeys.end() );
+                                    for( unsigned int turn = 0 ; turn < turnKeys.size() ; turn++ )
+                                       chunk.push_back( std::lower_bound(keys.begin(), keys.end(), turnKeys[turn]) - keys.begin() );
+                                    firstSuccessor[position+1] = turnKeys.size();
+                                 }
+                              } );
+
+   for( unsigned long long position = 0 ; position < keys.size() ; position++ )
+      firstSuccessor[position+1] += firstSuccessor[position];
+   successors.reserve(firstSuccessor.back());
+   for( unsigned long long chunk = 0 ; chunk < numChunks ; chunk++ )
+   {
+      successors.insert(successors.end(), chunkSuccessors[chunk].begin(), chunkSuccessors[chunk].end());
+      std::vector<unsigned int>().swap(chunkSuccessors[chunk]);
+   }
+   std::cout << successors.size() << " turns linked\n";
+   return true;
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to work out the result of every position, a round at a time (see the top of the file)
+//   - The threads only read the results during a round, & the positions they resolve are only written after it, so each
+//     round sees exactly the results of the rounds before it
+// --------------------------------------------------------------------------- //
+
+void
+CVariantSolver::Solve()
+{
+   values.assign(keys.size(), CVariantDatabase::DRAW);
+   for( unsigned int round = 0 ; round <= CVariantDatabase::MAX_DISTANCE ; round++ )
+   {
+      std::vector< std::vector< std::pair<unsigned int, unsigned short> > > resolved(numThreads);
+      ForEachChunk( keys.size(), [this, &resolved, round](const unsigned int thread, const unsigned long long begin,
+                                                          const unsigned long long end)
+                                 {
+                                    for( unsigned long long position = begin ; position < end ; position++ )
+                                    {
+                                       if( values[position] != CVariantDatabase::DRAW )
+                                          continue;
+                                       bool hasLoss = false, allWins = true;
+                                       for( unsigned long long turn = firstSuccessor[position] ; turn < firstSuccessor[position+1] ; turn++ )
+                                       {
+                                          const unsigned short value = values[successors[turn]];
+                                          hasLoss = hasLoss || CVariantDatabase::IsLoss(value);
+                                          allWins = allWins && CVariantDatabase::IsWin(value);
+                                       }
+                                       if( hasLoss )
+                                          resolved[thread].push_back( std::make_pair(position, CVariantDatabase::Win(round)) );
+                                       else if( allWins )
+                                          resolved[thread].push_back( std::make_pair(position, CVariantDatabase::Loss(round)) );
+                                    }
+                                 } );
+
+      unsigned long long numResolved = 0;
+      for( unsigned int thread = 0 ; thread < numThreads ; thread++ )
+      {
+         for( unsigned int position = 0 ; position < resolved[thread].size() ; position++ )
+            values[resolved[thread][position].first] = resolved[thread][position].second;
+         numResolved += resolved[thread].size();
+      }
+      if( numResolved == 0 )
+         break;
+      std::cout << "Round " << round << ": " << numResolved << " positions resolved\n";
+   }
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to describe a result
+// --------------------------------------------------------------------------- //
+
+static std::string
+ResultName(const unsigned short value)
+{
+   if( CVariantDatabase::IsWin(value) )
+      return "win in " + std::to_string(CVariantDatabase::Distance(value)) + " turns";
+   if( CVariantDatabase::IsLoss(value) )
+      return "loss in " + std::to_string(CVariantDatabase::Distance(value)) + " turns";
+   return "draw";
+}
+
+
+// --------------------------------------------------------------------------- //
+// Function to check the proof-number solver & the AI against a database (returns the number of positions where the
+//   solver contradicts the database)
+// --------------------------------------------------------------------------- //
+
+static unsigned int
+CheckDatabase(const CVariantDatabase &database, const CBoard &variant, const unsigned int numPositions,
+              const int depth, const unsigned long long maxNodes, const unsigned int numThreads)
+{
+   std::mt19937_64 rng(12345);   // Fixed seed, so that the same positions are checked each time
+   CProofSolver solver(64, numThreads);
+   unsigned int numProven = 0, numContradicted = 0;
+   unsigned int numWins = 0, numWinsKept = 0, numDraws = 0, numDrawsKept = 0;
+
+   for( unsigned int check = 0 ; check < numPositions ; check++ )
+   {
+      const unsigned long long index = rng() % database.NumPositions();
+      const unsigned short value = database.Value(index);
+      CBoard board = variant;
+      board.SetPosition( CVariantDatabase::KeyPosition(database.Key(index), database.Width(), database.Height()) );
+
+      // The solver may fail to prove a result, but it must never prove the wrong one
+      std::vector<CBoard::CMove> line;
+      const CProofSolver::Results result = solver.Solve(board, maxNodes, 0, line);
+      if( result != CProofSolver::UNKNOWN )
+      {
+         numProven++;
+         if( (result == CProofSolver::WIN) != CVariantDatabase::IsWin(value) ||
+             (result == CProofSolver::LOSS) != CVariantDatabase::IsLoss(value) )
+         {
+            numContradicted++;
+            std::cout << "Solver contradicts the database (" << ResultName(value) << "): " << board.GetPosition() << "\n";
+         }
+      }
+
+      // Let the AI take its turn, & see whether the result is still the same
+      if( CVariantDatabase::IsLoss(value) || (CVariantDatabase::IsWin(value) && CVariantDatabase::Distance(value) == 0) )
+         continue;
+      const bool isXTurn = board.IsXTurn();
+      while( board.IsXTurn() == isXTurn )
+      {
+         const CBoard::CMove move = board.StartAI(CSearchLimits(depth)).Get();
+         if( !move.IsValid() || !board.MakeMove(move) )
+            break;
+      }
+      unsigned short after = CVariantDatabase::DRAW;
+      if( (board.IsXTurn() == isXTurn) || !database.Probe(board, after) )
+         continue;
+      if( CVariantDatabase::IsWin(value) )
+      {
+         numWins++;
+         numWinsKept += ( CVariantDatabase::IsLoss(after) ? 1 : 0 );
+      }
+      else
+      {
+         numDraws++;
+         numDrawsKept += ( CVariantDatabase::IsWin(after) ? 0 : 1 );
+      }
+   }
+
+   std::cout << "Solver: " << numProven << " of " << numPositions << " positions proven, " << numContradicted << " contradicted\n";
+   std::cout << "AI at depth " << depth << ": kept " << numWinsKept << " of " << numWins << " wins & " << numDrawsKept
+             << " of " << numDraws << " draws\n";
+   return numContradicted;
+}
+
+
+int main(int argc, char **argv)
+{
+   std::string variantName = "6x6";
+   std::string position;
+   unsigned int numThreads = std::thread::hardware_concurrency();
+   std::string outputFilename;
+   std::string checkFilename;
+   unsigned int numPositions = 1000;
+   int depth = 5;
+   unsigned long long maxNodes = 100000;
+
+   for( int arg = 1 ; arg < argc ; arg += 2 )
+   {
+      const std::string option = argv[arg];
+      // Every option takes a value, so one without is not an option
+      if( arg+1 == argc )
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+      const char *value = argv[arg+1];
+      if( option == "-variant" )           variantName = value;
+      else if( option == "-position" )     position = value;
+      else if( option == "-threads" )      numThreads = std::atoi(value);
+      else if( option == "-o" )            outputFilename = value;
+      else if( option == "-check" )        checkFilename = value;
+      else if( option == "-positions" )    numPositions = std::atoi(value);
+      else if( option == "-depth" )        depth = std::atoi(value);
+      else if( option == "-nodes" )        maxNodes = std::strtoull(value, nullptr, 10);
+      else
+      {
+         std::cout << "Option \"" << option << "\" not recognised\n";
+         return 1;
+      }
+   }
+   if( numThreads == 0 )
+      numThreads = 1;
+
+   // Check a database that has already been written
+   if( !checkFilename.empty() )
+   {
+      CVariantDatabase database;
+      if( !database.Open(checkFilename) || (database.NumPositions() == 0) )
+      {
+         std::cout << "Could not open the database \"" << checkFilename << "\"\n";
+         return 1;
+      }
+      const CBoard variant( database.Width() == 7 ? CBoard::VARIANT_7X7 : CBoard::VARIANT_6X6 );
+      return ( CheckDatabase(database, variant, numPositions, depth, maxNodes, numThreads) == 0 ? 0 : 1 );
+   }
+
+   CBoard::Variants variant = CBoard::VARIANT_6X6;
+   if( variantName == "7x7" )
+      variant = CBoard::VARIANT_7X7;
+   else if( variantName != "6x6" )
+   {
+      std::cout << "Variant \"" << variantName << "\" not recognised (6x6 or 7x7)\n";
+      return 1;
+   }
+   CBoard start(variant);
+   start.ForceTurn(true);
+   unsigned long long startKey = 0;
+   if( !position.empty() && (!start.SetPosition(position) || !CVariantDatabase::PositionKey(start, startKey)) )
+   {
+      std::cout << "\"" << position << "\" is not a valid " << variantName << " position\n";
+      return 1;
+   }
+   if( outputFilename.empty() )
+      outputFilename = variantName + ".vdb";
+
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   CVariantSolver solver(start, numThreads);
+   solver.Enumerate();
+   if( !solver.Link() )
+   {
+      std::cout << "Too many positions\n";
+      return 1;
+   }
+   solver.Solve();
+   std::cout << "Solved in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() << "s\n";
+
+   CVariantDatabase::PositionKey(start, startKey);
+   std::cout << "Starting position: " << ResultName(solver.Value(startKey)) << " for " << (start.IsXTurn() ? "x" : "o") << "\n";
+
+   if( !solver.Write(outputFilename, CBoard::VariantPieces(variant)) )
+   {
+      std::cout << "Could not write \"" << outputFilename << "\"\n";
+      return 1;
+   }
+   return 0;
+}